@@ -44,6 +44,9 @@ Senders	|	H2------R1------R2-----H5	 |	Receivers
 #include <fstream>
 #include <cstdlib>
 #include <map>
+#include <vector>
+#include <sstream>
+#include <cmath>
 #include "ns3/core-module.h"
 #include "ns3/network-module.h"
 #include "ns3/point-to-point-module.h"
@@ -52,8 +55,18 @@ Senders	|	H2------R1------R2-----H5	 |	Receivers
 #include "ns3/flow-monitor-module.h"
 #include "ns3/ipv4-global-routing-helper.h"
 #include "ns3/gnuplot.h"
-
-typedef uint32_t int;
+#include "bottleneck.h"
+#include "flowTable.h"
+#include "dropAccounting.h"
+#include "flowExport.h"
+#include "flowProbes.h"
+#include "emulation.h"
+#include "parkingLot.h"
+#include "memoryAccounting.h"
+#include "measurementPhases.h"
+#include "ecnMarking.h"
+#include "tcpVariants.h"
+#include "crossTraffic.h"
 
 using namespace ns3;
 
@@ -152,19 +165,12 @@ void APP::ChangeRate(DataRate newrate) {
 	return;
 }
 
-static void CwndChange(Ptr<OutputStreamWrapper> stream, double startTime, int oldCwnd, int newCwnd) {
+static void CwndChange(Ptr<OutputStreamWrapper> stream, double startTime, uint32_t oldCwnd, uint32_t newCwnd) {
+	if(!measuring)
+		return;
 	*stream->GetStream() << Simulator::Now ().GetSeconds () - startTime << "\t" << newCwnd << std::endl;
 }
 
-std::map<int, int> mapDrop;
-static void packetDrop(Ptr<OutputStreamWrapper> stream, double startTime, int myId) {
-	*stream->GetStream() << Simulator::Now ().GetSeconds () - startTime << "\t" << std::endl;
-	if(mapDrop.find(myId) == mapDrop.end()) {
-		mapDrop[myId] = 0;
-	}
-	mapDrop[myId]++;
-}
-
 
 void IncRate(Ptr<APP> app, DataRate rate) {
 	app->ChangeRate(rate);
@@ -177,6 +183,8 @@ static double lastTimePrint = 0, lastTimePrintIPV4 = 0;
 double printGap = 0;
 
 void ReceivedPacket(Ptr<OutputStreamWrapper> stream, double startTime, std::string context, Ptr<const Packet> p, const Address& addr){
+	if(!measuring)
+		return;
 	double timeNow = Simulator::Now().GetSeconds();
 
 	if(mapBytesReceived.find(addr) == mapBytesReceived.end())
@@ -189,7 +197,9 @@ void ReceivedPacket(Ptr<OutputStreamWrapper> stream, double startTime, std::stri
 	}
 }
 
-void ReceivedPacketIPV4(Ptr<OutputStreamWrapper> stream, double startTime, std::string context, Ptr<const Packet> p, Ptr<Ipv4> ipv4, int interface) {
+void ReceivedPacketIPV4(Ptr<OutputStreamWrapper> stream, double startTime, std::string context, Ptr<const Packet> p, Ptr<Ipv4> ipv4, uint32_t interface) {
+	if(!measuring)
+		return;
 	double timeNow = Simulator::Now().GetSeconds();
 
 	if(mapBytesReceivedIPV4.find(context) == mapBytesReceivedIPV4.end())
@@ -221,11 +231,14 @@ Ptr<Socket> uniFlow(Address sinkAddress,
 					double appStopTime) {
 
 	if(tcpVariant.compare("TcpReno") == 0) {
-		Config::SetDefault("ns3::TcpL4Protocol::SocketType", TypeIdValue(TcpReno::GetTypeId()));
+		setTcpVariant(hostNode, TcpReno::GetTypeId());
 	} else if(tcpVariant.compare("TcpWestwood") == 0) {
-		Config::SetDefault("ns3::TcpL4Protocol::SocketType", TypeIdValue(TcpWestwood::GetTypeId()));
+		setTcpVariant(hostNode, TcpWestwood::GetTypeId());
 	} else if(tcpVariant.compare("TcpFack") == 0) {
-		Config::SetDefault("ns3::TcpL4Protocol::SocketType", TypeIdValue(TcpTahoe::GetTypeId()));
+		setTcpVariant(hostNode, TcpTahoe::GetTypeId());
+	} else if(tcpVariant.compare("TcpDctcp") == 0) {
+		setTcpVariant(hostNode, TcpDctcp::GetTypeId());
+		setTcpVariant(sinkNode, TcpDctcp::GetTypeId());
 	} else {
 		fprintf(stderr, "Invalid TCP version\n");
 		exit(EXIT_FAILURE);
@@ -254,6 +267,11 @@ struct TopologyParam
 	std::string bandwidth_routerToRouter;
 	std::string delay_routerToRouter;
 
+	// Per host pair i (sender i and receiver i links); empty means the
+	// *_hostToRouter value for every leaf
+	std::vector<std::string> leafBandwidth;
+	std::vector<std::string> leafDelay;
+
 	int packetSize;
 	int queueSizeHR;
 	int queueSizeRR;
@@ -264,6 +282,23 @@ struct TopologyParam
 
 	double errorP;
 
+	std::string queueDisc;		// None, DropTail, RED, CoDel, FqCoDel or Pie on R1-R2
+	EcnParam ecnParams;			// SACK, ECN marking on R1-R2, DCTCP (ecnMarking.h)
+
+	bool realtime;				// realtime simulator, for emulation with real applications
+	std::string tapSenders;		// senders/receivers (indices, e.g. "0,2") that get a tap endpoint
+	std::string tapReceivers;
+	std::string tapMode;		// TapBridge mode: ConfigureLocal, UseLocal or UseBridge
+
+	bool slimStack;				// IPv4+TCP only on the hosts, no IPv6 anywhere
+	bool memoryReport;			// memory per subsystem and per host pair at the end of the run
+
+	double warmup;				// s before the measure phase, nothing is recorded
+	double measure;				// s of measure phase, -1 until the end (then no cool-down)
+
+	CrossTrafficParam crossParams;	// UDP background traffic on extra leaf pairs (crossTraffic.h)
+	int numCross;				// extra leaf pairs, one per cross-traffic source
+
 	TopologyParam();
 };
 
@@ -274,14 +309,90 @@ TopologyParam::TopologyParam() {
 	this -> delay_routerToRouter = "50ms";
 
 	this -> packetSize = 1.3*1024;		// 1.3KB
-	this -> queueSizeHR = (100*1000*20)/this->packetSize;	// #packets_queue_HR = (100Mbps)*(20ms)/packetSize
-	this -> queueSizeRR = (10*1000*50)/this->packetSize;	// #packets_queue_RR = (10Mbps)*(50ms)/packetSize
+	// One bandwidth-delay product of each link: rate*delay/(8*packetSize) packets
+	this -> queueSizeHR = bdpPackets(this->bandwidth_hostToRouter, Time(this->delay_hostToRouter), this->packetSize);
+	this -> queueSizeRR = bdpPackets(this->bandwidth_routerToRouter, Time(this->delay_routerToRouter), this->packetSize);
 
 	this -> numSender = 3;
 	this -> numRecv = 3;
 	this -> numRouters = 2;
 
 	this -> errorP = ERROR;
+
+	this -> queueDisc = "None";
+
+	this -> realtime = false;
+	this -> tapSenders = "";
+	this -> tapReceivers = "";
+	this -> tapMode = "ConfigureLocal";
+
+	this -> slimStack = false;
+	this -> memoryReport = false;
+
+	this -> warmup = 0;
+	this -> measure = -1;
+
+	this -> numCross = 0;
+}
+
+/*
+	Per-leaf link parameters from a file, one host pair per line:
+		<bandwidth> <delay>		e.g. "100Mbps 20ms"
+	Lines starting with # are skipped.
+*/
+void loadLeafParams(TopologyParam &topologyParams, std::string fileName) {
+	std::ifstream in(fileName.c_str());
+	if(!in) {
+		fprintf(stderr, "Cannot open %s\n", fileName.c_str());
+		exit(EXIT_FAILURE);
+	}
+	topologyParams.leafBandwidth.clear();
+	topologyParams.leafDelay.clear();
+	std::string line;
+	while(std::getline(in, line)) {
+		if(line.empty() || line[0] == '#')
+			continue;
+		std::stringstream ss(line);
+		std::string bandwidth, delay;
+		if(!(ss >> bandwidth >> delay)) {
+			fprintf(stderr, "Invalid leaf parameters: %s\n", line.c_str());
+			exit(EXIT_FAILURE);
+		}
+		topologyParams.leafBandwidth.push_back(bandwidth);
+		topologyParams.leafDelay.push_back(delay);
+	}
+	if((int)topologyParams.leafDelay.size() < topologyParams.numSender) {
+		fprintf(stderr, "%s has %u leaves, %d needed\n", fileName.c_str(), (uint32_t)topologyParams.leafDelay.size(), topologyParams.numSender);
+		exit(EXIT_FAILURE);
+	}
+}
+
+/*
+	Per-leaf delays drawn from `distribution` between minDelay and maxDelay
+	(ms), all leaves keeping bandwidth_hostToRouter.
+	Uniform: uniform in [min, max]
+	LogUniform: uniform in log scale, so a 10x spread covers every decade
+	evenly.
+	Delays are rounded to whole ms so that leaves can share a helper (see
+	DumbbellTopology::setNetDevices). Draws come from the ns-3 RNG, so they
+	follow --seed/--run.
+*/
+void generateLeafDelays(TopologyParam &topologyParams, std::string distribution, double minDelay, double maxDelay) {
+	Ptr<UniformRandomVariable> uniform = CreateObject<UniformRandomVariable>();
+	topologyParams.leafBandwidth.assign(topologyParams.numSender, topologyParams.bandwidth_hostToRouter);
+	topologyParams.leafDelay.clear();
+	for (int i = 0; i < topologyParams.numSender; ++i) {
+		double delay;
+		if(distribution.compare("Uniform") == 0) {
+			delay = uniform->GetValue(minDelay, maxDelay);
+		} else if(distribution.compare("LogUniform") == 0) {
+			delay = std::exp(uniform->GetValue(std::log(minDelay), std::log(maxDelay)));
+		} else {
+			fprintf(stderr, "Invalid delay distribution\n");
+			exit(EXIT_FAILURE);
+		}
+		topologyParams.leafDelay.push_back(std::to_string((int)std::lround(delay)) + "ms");
+	}
 }
 
 class DumbbellTopology
@@ -296,6 +407,16 @@ private:
 	InternetStackHelper stack;
 	Ipv4AddressHelper routerIP, senderIP, receiverIP;
 	Ipv4InterfaceContainer routerIFC, senderIFCs, receiverIFCs, leftRouterIFCs, rightRouterIFCs;
+	NodeContainer crossSenders, crossReceivers;
+	NetDeviceContainer crossRouterDevices, crossSenderDevices, crossReceiverDevices;
+	Ipv4InterfaceContainer crossReceiverIFCs;
+	std::vector<std::string> crossSources;
+	ApplicationContainer crossSinks;
+	NodeContainer tapNodes;
+	std::map<std::pair<std::string, std::string>, PointToPointHelper> leafHelpers;
+
+	PointToPointHelper &getLeafHelper(TopologyParam topologyParams, int i);
+	void installSlimStack(NodeContainer nodes);
 
 public:
 	void setConnections(TopologyParam topologyParams);
@@ -304,7 +425,20 @@ public:
 	void installInternetStack(TopologyParam topologyParams);
 	void addIpAddrToNodes(TopologyParam topologyParams);
 	void addIpAddrToNetDevices(TopologyParam topologyParams);
-}
+	void setErrorRate(TopologyParam topologyParams);
+	void setQueueDisc(TopologyParam topologyParams);
+	Ptr<NetDevice> getBottleneckDevice();
+	NetDeviceContainer getNetDevices();
+	Ptr<Node> getSender(uint32_t i);
+	Ptr<Node> getReceiver(uint32_t i);
+	Ipv4Address getReceiverAddress(uint32_t i);
+	void addFlows(TopologyParam topologyParams, FlowTable &flowTable);
+	Ptr<FlowMonitor> installFlowMonitor(FlowMonitorHelper &flowmonHelper, FlowProbeConfig probeConfig);
+	void setRealtime(TopologyParam topologyParams);
+	void addTapEndpoints(TopologyParam topologyParams);
+	void addCrossTraffic(TopologyParam topologyParams, int port, double startTime, double stopTime);
+	void reportCrossTraffic(std::ostream &os, double duration);
+};
 
 //Creating channel without IP address
 /*
@@ -315,16 +449,19 @@ public:
 	Delay: Transmission delay through the channel
 
 	SetQueue: sets attribute of a queue say droptailqueue
-	MaxPackets: The maximum number of packets accepted by this DropTailQueue.
+	MaxSize: The maximum number of packets ("<n>p") accepted by this DropTailQueue.
 */
 void DumbbellTopology::setConnections(TopologyParam topologyParams) {
 	this->pointToPointRouter.SetDeviceAttribute("DataRate", StringValue(topologyParams.bandwidth_hostToRouter));
 	this->pointToPointRouter.SetChannelAttribute("Delay", StringValue(topologyParams.delay_hostToRouter));
-	this->pointToPointRouter.SetQueue("ns3::DropTailQueue", "MaxPackets", UintegerValue(topologyParams.queueSizeHR));
+	this->pointToPointRouter.SetQueue("ns3::DropTailQueue", "MaxSize", StringValue(std::to_string(topologyParams.queueSizeHR)+"p"));
 
 	this->pointToPointLeaf.SetDeviceAttribute("DataRate", StringValue(topologyParams.bandwidth_routerToRouter));
 	this->pointToPointLeaf.SetChannelAttribute("Delay", StringValue(topologyParams.delay_routerToRouter));
-	this->pointToPointLeaf.SetQueue("ns3::DropTailQueue", "MaxPackets", UintegerValue(topologyParams.queueSizeRR));
+	if(isQueueDiscEnabled(topologyParams.queueDisc))
+		this->pointToPointLeaf.SetQueue("ns3::DropTailQueue", "MaxSize", StringValue(BOTTLENECK_DEVICE_QUEUE));
+	else
+		this->pointToPointLeaf.SetQueue("ns3::DropTailQueue", "MaxSize", StringValue(std::to_string(topologyParams.queueSizeRR)+"p"));
 }
 
 void DumbbellTopology::createNodes(TopologyParam topologyParams) {
@@ -332,6 +469,9 @@ void DumbbellTopology::createNodes(TopologyParam topologyParams) {
 	this->routers.Create(topologyParams.numRouters);
 	this->senders.Create(topologyParams.numSender);
 	this->receivers.Create(topologyParams.numRecv);
+	//After the receivers, so that they keep their place in the NodeList
+	this->crossSenders.Create(topologyParams.numCross);
+	this->crossReceivers.Create(topologyParams.numCross);
 }
 
 /*
@@ -348,17 +488,52 @@ void DumbbellTopology::setNetDevices(TopologyParam topologyParams) {
 	
 	//Adding links
 	std::cout << "Adding links" << std::endl;
-	for (int i = 0; i < this->numSender; ++i) {
-		NetDeviceContainer cleft = this->pointToPointRouter.Install(this->routers.Get(0), this->senders.Get(i));
+	for (int i = 0; i < topologyParams.numSender; ++i) {
+		PointToPointHelper &leafHelper = this->getLeafHelper(topologyParams, i);
+		NetDeviceContainer cleft = leafHelper.Install(this->routers.Get(0), this->senders.Get(i));
 		this->leftRouterDevices.Add(cleft.Get(0));
 		this->senderDevices.Add(cleft.Get(1));
 		cleft.Get(0)->SetAttribute("ReceiveErrorModel", PointerValue(this->errorModel));
 
-		NetDeviceContainer cright = this->pointToPointRouter.Install(this->routers.Get(1), this->receivers.Get(i));
+		NetDeviceContainer cright = leafHelper.Install(this->routers.Get(1), this->receivers.Get(i));
 		this->rightRouterDevices.Add(cright.Get(0));
 		this->receiverDevices.Add(cright.Get(1));
 		cright.Get(0)->SetAttribute("ReceiveErrorModel", PointerValue(this->errorModel));
 	}
+	//Cross-traffic leaves: default host-to-router links
+	for (int i = 0; i < topologyParams.numCross; ++i) {
+		NetDeviceContainer cleft = this->pointToPointRouter.Install(this->routers.Get(0), this->crossSenders.Get(i));
+		this->crossRouterDevices.Add(cleft.Get(0));
+		this->crossSenderDevices.Add(cleft.Get(1));
+		cleft.Get(0)->SetAttribute("ReceiveErrorModel", PointerValue(this->errorModel));
+
+		NetDeviceContainer cright = this->pointToPointRouter.Install(this->routers.Get(1), this->crossReceivers.Get(i));
+		this->crossRouterDevices.Add(cright.Get(0));
+		this->crossReceiverDevices.Add(cright.Get(1));
+		cright.Get(0)->SetAttribute("ReceiveErrorModel", PointerValue(this->errorModel));
+	}
+}
+
+/*
+	Helper for the links of host pair i.
+	Leaves with the same (bandwidth, delay) share one configured helper, so
+	with heterogeneous leaves the attribute setup is done once per distinct
+	pair, not once per link.
+*/
+PointToPointHelper &DumbbellTopology::getLeafHelper(TopologyParam topologyParams, int i) {
+	if(topologyParams.leafDelay.empty())
+		return this->pointToPointRouter;
+
+	std::pair<std::string, std::string> key(topologyParams.leafBandwidth[i], topologyParams.leafDelay[i]);
+	std::map<std::pair<std::string, std::string>, PointToPointHelper>::iterator it = this->leafHelpers.find(key);
+	if(it != this->leafHelpers.end())
+		return it->second;
+
+	PointToPointHelper &leafHelper = this->leafHelpers[key];
+	leafHelper.SetDeviceAttribute("DataRate", StringValue(key.first));
+	leafHelper.SetChannelAttribute("Delay", StringValue(key.second));
+	leafHelper.SetQueue("ns3::DropTailQueue", "MaxSize", StringValue(std::to_string(topologyParams.queueSizeHR)+"p"));
+	return leafHelper;
 }
 
 //Install Internet Stack
@@ -369,9 +544,123 @@ void DumbbellTopology::setNetDevices(TopologyParam topologyParams) {
 void DumbbellTopology::installInternetStack(TopologyParam topologyParams) {
 	std::cout << "Install internet stack" << std::endl;
 
+	if(topologyParams.slimStack) {
+		this->stack.SetIpv6StackInstall(false);
+		this->stack.Install(this->routers);
+		this->installSlimStack(this->senders);
+		this->installSlimStack(this->receivers);
+		//Cross traffic is UDP
+		this->stack.Install(this->crossSenders);
+		this->stack.Install(this->crossReceivers);
+		return;
+	}
 	this->stack.Install(this->routers);
 	this->stack.Install(this->senders);
 	this->stack.Install(this->receivers);
+	this->stack.Install(this->crossSenders);
+	this->stack.Install(this->crossReceivers);
+}
+
+/*
+	What a TCP host needs and nothing else: IPv4 with ARP and ICMP, the same
+	static + global routing list InternetStackHelper sets up, traffic
+	control and TCP. No IPv6 (with its ND and ICMPv6), UDP or packet
+	sockets, which are most of a full stack's per-node footprint.
+*/
+void DumbbellTopology::installSlimStack(NodeContainer nodes) {
+	Ipv4StaticRoutingHelper staticRouting;
+	Ipv4GlobalRoutingHelper globalRouting;
+	Ipv4ListRoutingHelper listRouting;
+	listRouting.Add(staticRouting, 0);
+	listRouting.Add(globalRouting, -10);
+
+	const char *protocols[] = {"ns3::ArpL3Protocol", "ns3::Ipv4L3Protocol", "ns3::Icmpv4L4Protocol", "ns3::TrafficControlLayer", "ns3::TcpL4Protocol"};
+	for (NodeContainer::Iterator it = nodes.Begin(); it != nodes.End(); ++it) {
+		Ptr<Node> node = *it;
+		for (uint32_t i = 0; i < sizeof(protocols)/sizeof(protocols[0]); ++i) {
+			ObjectFactory factory;
+			factory.SetTypeId(protocols[i]);
+			node->AggregateObject(factory.Create<Object>());
+		}
+		node->GetObject<Ipv4>()->SetRoutingProtocol(listRouting.Create(node));
+	}
+}
+
+//Queue disc on the bottleneck, to be called between installInternetStack and addIpAddrToNetDevices
+void DumbbellTopology::setQueueDisc(TopologyParam topologyParams) {
+	if(!isQueueDiscEnabled(topologyParams.queueDisc))
+		return;
+	setEcnMarking(topologyParams.ecnParams);
+	installBottleneckQueueDisc(this->routerDevices, topologyParams.queueDisc, std::to_string(topologyParams.queueSizeRR)+"p");
+}
+
+//R1 side of the R1-R2 link, i.e. where the bottleneck queue builds up
+Ptr<NetDevice> DumbbellTopology::getBottleneckDevice() {
+	return this->routerDevices.Get(0);
+}
+
+//Every device of the topology, e.g. to hook drop traces once per device
+NetDeviceContainer DumbbellTopology::getNetDevices() {
+	NetDeviceContainer devices;
+	devices.Add(this->routerDevices);
+	devices.Add(this->leftRouterDevices);
+	devices.Add(this->rightRouterDevices);
+	devices.Add(this->senderDevices);
+	devices.Add(this->receiverDevices);
+	devices.Add(this->crossRouterDevices);
+	devices.Add(this->crossSenderDevices);
+	devices.Add(this->crossReceiverDevices);
+	return devices;
+}
+
+Ptr<Node> DumbbellTopology::getSender(uint32_t i) {
+	return this->senders.Get(i);
+}
+
+Ptr<Node> DumbbellTopology::getReceiver(uint32_t i) {
+	return this->receivers.Get(i);
+}
+
+Ipv4Address DumbbellTopology::getReceiverAddress(uint32_t i) {
+	return this->receiverIFCs.GetAddress(i);
+}
+
+//One flow per host pair: sender i -> receiver i
+void DumbbellTopology::addFlows(TopologyParam topologyParams, FlowTable &flowTable) {
+	for (int i = 0; i < topologyParams.numSender; ++i) {
+		flowTable.add("H"+std::to_string(i+1), this->senderIFCs.GetAddress(i), this->receiverIFCs.GetAddress(i));
+	}
+}
+
+//FlowMonitor on every node, or only on R1/R2 and the chosen host pairs
+Ptr<FlowMonitor> DumbbellTopology::installFlowMonitor(FlowMonitorHelper &flowmonHelper, FlowProbeConfig probeConfig) {
+	return ::installFlowMonitor(flowmonHelper, probeConfig, this->routers, this->senders, this->receivers);
+}
+
+//Emulation mode, to be called before anything else touches the simulator
+void DumbbellTopology::setRealtime(TopologyParam topologyParams) {
+	if(!topologyParams.realtime)
+		return;
+	std::cout << "Realtime simulator" << std::endl;
+	enableRealtimeSimulator(false, 0.1);
+}
+
+/*
+	Tap endpoints behind the chosen senders (tap-left<i>, 10.4.i.0/24)
+	and receivers (tap-right<i>, 10.5.i.0/24), to be called after
+	addIpAddrToNetDevices and before the routing tables are populated.
+*/
+void DumbbellTopology::addTapEndpoints(TopologyParam topologyParams) {
+	Ipv4AddressHelper leftTapIP("10.4.0.0", "255.255.255.0");
+	Ipv4AddressHelper rightTapIP("10.5.0.0", "255.255.255.0");
+	std::vector<uint32_t> tapSenders = parseIndexList(topologyParams.tapSenders);
+	std::vector<uint32_t> tapReceivers = parseIndexList(topologyParams.tapReceivers);
+	for (uint32_t i = 0; i < tapSenders.size(); ++i) {
+		this->tapNodes.Add(attachTapEndpoint(this->senders.Get(tapSenders[i]), "tap-left" + std::to_string(tapSenders[i]), topologyParams.tapMode, leftTapIP));
+	}
+	for (uint32_t i = 0; i < tapReceivers.size(); ++i) {
+		this->tapNodes.Add(attachTapEndpoint(this->receivers.Get(tapReceivers[i]), "tap-right" + std::to_string(tapReceivers[i]), topologyParams.tapMode, rightTapIP));
+	}
 }
 
 //Adding IP addresses
@@ -399,7 +688,7 @@ void DumbbellTopology::addIpAddrToNetDevices(TopologyParam topologyParams) {
 	//based on the current network prefix and address base
 	this->routerIFC = this->routerIP.Assign(this->routerDevices);
 
-	for (int i = 0; i < this->numSender; ++i) {
+	for (int i = 0; i < topologyParams.numSender; ++i) {
 		NetDeviceContainer senderDevice;
 		senderDevice.Add(this->senderDevices.Get(i));
 		senderDevice.Add(this->leftRouterDevices.Get(i));
@@ -418,6 +707,46 @@ void DumbbellTopology::addIpAddrToNetDevices(TopologyParam topologyParams) {
 		this->rightRouterIFCs.Add(receiverIFC.Get(1));
 		this->receiverIP.NewNetwork();
 	}
+
+	//Cross-traffic leaf pair i: 10.6.i.0/24 on R1, 10.7.i.0/24 on R2
+	Ipv4AddressHelper crossSenderIP("10.6.0.0", "255.255.255.0");
+	Ipv4AddressHelper crossReceiverIP("10.7.0.0", "255.255.255.0");
+	for (int i = 0; i < topologyParams.numCross; ++i) {
+		NetDeviceContainer senderDevice;
+		senderDevice.Add(this->crossSenderDevices.Get(i));
+		senderDevice.Add(this->crossRouterDevices.Get(2*i));
+		crossSenderIP.Assign(senderDevice);
+		crossSenderIP.NewNetwork();
+
+		NetDeviceContainer receiverDevice;
+		receiverDevice.Add(this->crossReceiverDevices.Get(i));
+		receiverDevice.Add(this->crossRouterDevices.Get(2*i+1));
+		this->crossReceiverIFCs.Add(crossReceiverIP.Assign(receiverDevice).Get(0));
+		crossReceiverIP.NewNetwork();
+	}
+}
+
+/*
+	One cross-traffic source per extra leaf pair (crossTraffic.h), from the
+	R1-side leaf to a UDP sink on the R2-side leaf, between startTime and
+	stopTime. Crosses the bottleneck alongside the TCP flows.
+*/
+void DumbbellTopology::addCrossTraffic(TopologyParam topologyParams, int port, double startTime, double stopTime) {
+	this->crossSources = parseCrossSources(topologyParams.crossParams);
+	PacketSinkHelper sinkHelper("ns3::UdpSocketFactory", InetSocketAddress(Ipv4Address::GetAny(), port));
+	for (int i = 0; i < topologyParams.numCross; ++i) {
+		std::cout << "Cross traffic " << this->crossSources[i] << " on leaf pair X" << i+1 << std::endl;
+		ApplicationContainer sink = sinkHelper.Install(this->crossReceivers.Get(i));
+		sink.Start(Seconds(startTime));
+		sink.Stop(Seconds(stopTime));
+		this->crossSinks.Add(sink);
+		installCrossSource(this->crossSources[i], this->crossSenders.Get(i), InetSocketAddress(this->crossReceiverIFCs.GetAddress(i), port),
+			topologyParams.crossParams, startTime, stopTime);
+	}
+}
+
+void DumbbellTopology::reportCrossTraffic(std::ostream &os, double duration) {
+	::reportCrossTraffic(this->crossSinks, this->crossSources, duration, os);
 }
 
 void partAC() {
@@ -425,15 +754,22 @@ void partAC() {
 
 	TopologyParam topologyParams;
 	DumbbellTopology dumbbellTopology;
+	MemoryAccounting memory;
 
 	dumbbellTopology.setConnections(topologyParams);
 	dumbbellTopology.setErrorRate(topologyParams);
 	dumbbellTopology.createNodes(topologyParams);
 	dumbbellTopology.setNetDevices(topologyParams);
 	dumbbellTopology.installInternetStack(topologyParams);
+	dumbbellTopology.setQueueDisc(topologyParams);
 	dumbbellTopology.addIpAddrToNodes(topologyParams);
 	dumbbellTopology.addIpAddrToNetDevices(topologyParams);
 
+	FlowTable flowTable;
+	dumbbellTopology.addFlows(topologyParams, flowTable);
+	DropAccounting dropAccounting(&flowTable);
+	dropAccounting.installDevices(dumbbellTopology.getNetDevices());
+
 	/*
 		Measuring Performance of each TCP variant
 	*/
@@ -452,6 +788,8 @@ void partAC() {
 	int port = 9000;
 	int numPackets = 10000000;
 	std::string transferSpeed = "400Mbps";	
+	//Receivers follow the routers and the senders in the NodeList
+	int firstReceiver = topologyParams.numRouters + topologyParams.numSender;
 
 	//TCP Reno from H1 to H4
 	AsciiTraceHelper asciiTraceHelper;
@@ -459,15 +797,15 @@ void partAC() {
 	Ptr<OutputStreamWrapper> stream1PD = asciiTraceHelper.CreateFileStream("application_6_h1_h4_a.congestion_loss");
 	Ptr<OutputStreamWrapper> stream1TP = asciiTraceHelper.CreateFileStream("application_6_h1_h4_a.tp");
 	Ptr<OutputStreamWrapper> stream1GP = asciiTraceHelper.CreateFileStream("application_6_h1_h4_a.gp");
-	Ptr<Socket> ns3TcpSocket1 = uniFlow(InetSocketAddress(receiverIFCs.GetAddress(0), port), port, "TcpReno", senders.Get(0), receivers.Get(0), netDuration, netDuration+durationGap, packetSize, numPackets, transferSpeed, netDuration, netDuration+durationGap);
+	Ptr<Socket> ns3TcpSocket1 = uniFlow(InetSocketAddress(dumbbellTopology.getReceiverAddress(0), port), port, "TcpReno", dumbbellTopology.getSender(0), dumbbellTopology.getReceiver(0), netDuration, netDuration+durationGap, topologyParams.packetSize, numPackets, transferSpeed, netDuration, netDuration+durationGap);
 	ns3TcpSocket1->TraceConnectWithoutContext("CongestionWindow", MakeBoundCallback (&CwndChange, stream1CWND, netDuration));
-	ns3TcpSocket1->TraceConnectWithoutContext("Drop", MakeBoundCallback (&packetDrop, stream1PD, netDuration, 1));
+	dropAccounting.installSocket(ns3TcpSocket1, 0);
 
 	// Measure PacketSinks
-	std::string sink = "/NodeList/5/ApplicationList/0/$ns3::PacketSink/Rx";
+	std::string sink = "/NodeList/"+std::to_string(firstReceiver+0)+"/ApplicationList/0/$ns3::PacketSink/Rx";
 	Config::Connect(sink, MakeBoundCallback(&ReceivedPacket, stream1GP, netDuration));
 
-	std::string sink_ = "/NodeList/5/$ns3::Ipv4L3Protocol/Rx";
+	std::string sink_ = "/NodeList/"+std::to_string(firstReceiver+0)+"/$ns3::Ipv4L3Protocol/Rx";
 	Config::Connect(sink_, MakeBoundCallback(&ReceivedPacketIPV4, stream1TP, netDuration));
 
 	netDuration += durationGap;
@@ -478,13 +816,13 @@ void partAC() {
 	Ptr<OutputStreamWrapper> stream2PD = asciiTraceHelper.CreateFileStream("application_6_h2_h5_a.congestion_loss");
 	Ptr<OutputStreamWrapper> stream2TP = asciiTraceHelper.CreateFileStream("application_6_h2_h5_a.tp");
 	Ptr<OutputStreamWrapper> stream2GP = asciiTraceHelper.CreateFileStream("application_6_h2_h5_a.gp");
-	Ptr<Socket> ns3TcpSocket2 = uniFlow(InetSocketAddress(receiverIFCs.GetAddress(1), port), port, "TcpWestwood", senders.Get(1), receivers.Get(1), netDuration, netDuration+durationGap, packetSize, numPackets, transferSpeed, netDuration, netDuration+durationGap);
+	Ptr<Socket> ns3TcpSocket2 = uniFlow(InetSocketAddress(dumbbellTopology.getReceiverAddress(1), port), port, "TcpWestwood", dumbbellTopology.getSender(1), dumbbellTopology.getReceiver(1), netDuration, netDuration+durationGap, topologyParams.packetSize, numPackets, transferSpeed, netDuration, netDuration+durationGap);
 	ns3TcpSocket2->TraceConnectWithoutContext("CongestionWindow", MakeBoundCallback (&CwndChange, stream2CWND, netDuration));
-	ns3TcpSocket2->TraceConnectWithoutContext("Drop", MakeBoundCallback (&packetDrop, stream2PD, netDuration, 2));
+	dropAccounting.installSocket(ns3TcpSocket2, 1);
 
-	sink = "/NodeList/6/ApplicationList/0/$ns3::PacketSink/Rx";
+	sink = "/NodeList/"+std::to_string(firstReceiver+1)+"/ApplicationList/0/$ns3::PacketSink/Rx";
 	Config::Connect(sink, MakeBoundCallback(&ReceivedPacket, stream2GP, netDuration));
-	sink_ = "/NodeList/6/$ns3::Ipv4L3Protocol/Rx";
+	sink_ = "/NodeList/"+std::to_string(firstReceiver+1)+"/$ns3::Ipv4L3Protocol/Rx";
 	Config::Connect(sink_, MakeBoundCallback(&ReceivedPacketIPV4, stream2TP, netDuration));
 	netDuration += durationGap;
 
@@ -493,13 +831,13 @@ void partAC() {
 	Ptr<OutputStreamWrapper> stream3PD = asciiTraceHelper.CreateFileStream("application_6_h3_h6_a.congestion_loss");
 	Ptr<OutputStreamWrapper> stream3TP = asciiTraceHelper.CreateFileStream("application_6_h3_h6_a.tp");
 	Ptr<OutputStreamWrapper> stream3GP = asciiTraceHelper.CreateFileStream("application_6_h3_h6_a.gp");
-	Ptr<Socket> ns3TcpSocket3 = uniFlow(InetSocketAddress(receiverIFCs.GetAddress(2), port), port, "TcpFack", senders.Get(2), receivers.Get(2), netDuration, netDuration+durationGap, packetSize, numPackets, transferSpeed, netDuration, netDuration+durationGap);
+	Ptr<Socket> ns3TcpSocket3 = uniFlow(InetSocketAddress(dumbbellTopology.getReceiverAddress(2), port), port, "TcpFack", dumbbellTopology.getSender(2), dumbbellTopology.getReceiver(2), netDuration, netDuration+durationGap, topologyParams.packetSize, numPackets, transferSpeed, netDuration, netDuration+durationGap);
 	ns3TcpSocket3->TraceConnectWithoutContext("CongestionWindow", MakeBoundCallback (&CwndChange, stream3CWND, netDuration));
-	ns3TcpSocket3->TraceConnectWithoutContext("Drop", MakeBoundCallback (&packetDrop, stream3PD, netDuration, 3));
+	dropAccounting.installSocket(ns3TcpSocket3, 2);
 
-	sink = "/NodeList/7/ApplicationList/0/$ns3::PacketSink/Rx";
+	sink = "/NodeList/"+std::to_string(firstReceiver+2)+"/ApplicationList/0/$ns3::PacketSink/Rx";
 	Config::Connect(sink, MakeBoundCallback(&ReceivedPacket, stream3GP, netDuration));
-	sink_ = "/NodeList/7/$ns3::Ipv4L3Protocol/Rx";
+	sink_ = "/NodeList/"+std::to_string(firstReceiver+2)+"/$ns3::Ipv4L3Protocol/Rx";
 	Config::Connect(sink_, MakeBoundCallback(&ReceivedPacketIPV4, stream3TP, netDuration));
 	netDuration += durationGap;
 
@@ -511,48 +849,35 @@ void partAC() {
 
 	Ptr<FlowMonitor> flowmon;
 	FlowMonitorHelper flowmonHelper;
-	flowmon = flowmonHelper.InstallAll();
+	flowmon = dumbbellTopology.installFlowMonitor(flowmonHelper, FlowProbeConfig());
 	Simulator::Stop(Seconds(netDuration));
 	Simulator::Run();
+	memory.mark("simulation run (events, buffers, flow records)");
 	flowmon->CheckForLostPackets();
 
-	//Ptr<OutputStreamWrapper> streamTP = asciiTraceHelper.CreateFileStream("application_6_a.tp");
 	Ptr<Ipv4FlowClassifier> classifier = DynamicCast<Ipv4FlowClassifier>(flowmonHelper.GetClassifier());
-	std::map<FlowId, FlowMonitor::FlowStats> stats = flowmon->GetFlowStats();
-	for (std::map<FlowId, FlowMonitor::FlowStats>::const_iterator i = stats.begin(); i != stats.end(); ++i) {
-		Ipv4FlowClassifier::FiveTuple t = classifier->FindFlow (i->first);
-		/*
-		*streamTP->GetStream()  << "Flow " << i->first  << " (" << t.sourceAddress << " -> " << t.destinationAddress << ")\n";
-		*streamTP->GetStream()  << "  Tx Bytes:   " << i->second.txBytes << "\n";
-		*streamTP->GetStream()  << "  Rx Bytes:   " << i->second.rxBytes << "\n";
-		*streamTP->GetStream()  << "  Time        " << i->second.timeLastRxPacket.GetSeconds() - i->second.timeFirstTxPacket.GetSeconds() << "\n";
-		*streamTP->GetStream()  << "  Throughput: " << i->second.rxBytes * 8.0 / (i->second.timeLastRxPacket.GetSeconds() - i->second.timeFirstTxPacket.GetSeconds())/1024/1024  << " Mbps\n";	
-		*/
-		if(t.sourceAddress == "10.1.0.1") {
-			if(mapDrop.find(1)==mapDrop.end())
-				mapDrop[1] = 0;
-			*stream1PD->GetStream() << "TcpReno Flow " << i->first  << " (" << t.sourceAddress << " -> " << t.destinationAddress << ")\n";
-			*stream1PD->GetStream()  << "Net Packet Lost: " << i->second.lostPackets << "\n";
-			*stream1PD->GetStream()  << "Packet Lost due to buffer overflow: " << mapDrop[1] << "\n";
-			*stream1PD->GetStream()  << "Packet Lost due to Congestion: " << i->second.lostPackets - mapDrop[1] << "\n";
-			*stream1PD->GetStream() << "Max throughput: " << mapMaxThroughput["/NodeList/5/$ns3::Ipv4L3Protocol/Rx"] << std::endl;
-		} else if(t.sourceAddress == "10.1.1.1") {
-			if(mapDrop.find(2)==mapDrop.end())
-				mapDrop[2] = 0;
-			*stream2PD->GetStream() << "Tcp Westwood Flow " << i->first  << " (" << t.sourceAddress << " -> " << t.destinationAddress << ")\n";
-			*stream2PD->GetStream()  << "Net Packet Lost: " << i->second.lostPackets << "\n";
-			*stream2PD->GetStream()  << "Packet Lost due to buffer overflow: " << mapDrop[2] << "\n";
-			*stream2PD->GetStream()  << "Packet Lost due to Congestion: " << i->second.lostPackets - mapDrop[2] << "\n";
-			*stream2PD->GetStream() << "Max throughput: " << mapMaxThroughput["/NodeList/6/$ns3::Ipv4L3Protocol/Rx"] << std::endl;
-		} else if(t.sourceAddress == "10.1.2.1") {
-			if(mapDrop.find(3)==mapDrop.end())
-				mapDrop[3] = 0;
-			*stream3PD->GetStream() << "Tcp Fack Flow " << i->first  << " (" << t.sourceAddress << " -> " << t.destinationAddress << ")\n";
-			*stream3PD->GetStream()  << "Net Packet Lost: " << i->second.lostPackets << "\n";
-			*stream3PD->GetStream()  << "Packet Lost due to buffer overflow: " << mapDrop[3] << "\n";
-			*stream3PD->GetStream()  << "Packet Lost due to Congestion: " << i->second.lostPackets - mapDrop[3] << "\n";
-			*stream3PD->GetStream() << "Max throughput: " << mapMaxThroughput["/NodeList/7/$ns3::Ipv4L3Protocol/Rx"] << std::endl;
-		}
+	FlowExporter flowExporter(&flowTable);
+	flowExporter.collect(flowmon, classifier);
+	flowExporter.attachDrops(&dropAccounting);
+	for(uint32_t i = 0; i < flowTable.size(); ++i) {
+		Ptr<PacketSink> sinkApp = DynamicCast<PacketSink>(NodeList::GetNode(firstReceiver+i)->GetApplication(0));
+		flowExporter.setAppBytes(i, sinkApp->GetTotalRx());
+	}
+	flowExporter.writeCsv("application_6_a.csv");
+
+	std::string tcpVariants[] = {"TcpReno", "TcpWestwood", "TcpFack"};
+	Ptr<OutputStreamWrapper> streamsPD[] = {stream1PD, stream2PD, stream3PD};
+	for(uint32_t i = 0; i < flowTable.size(); ++i) {
+		const FlowEntry &e = flowTable.get(i);
+		const FlowResult &r = flowExporter.get(i);
+		if(!r.found)
+			continue;
+		std::string context = "/NodeList/"+std::to_string(firstReceiver+i)+"/$ns3::Ipv4L3Protocol/Rx";
+		*streamsPD[i]->GetStream() << tcpVariants[i] << " Flow " << r.flowId << " (" << e.source << " -> " << e.destination << ")\n";
+		*streamsPD[i]->GetStream() << "Net Packet Lost: " << r.lostPackets << "\n";
+		dropAccounting.report(i, *streamsPD[i]->GetStream());
+		*streamsPD[i]->GetStream() << "Goodput (Kbps): " << r.goodput << "\n";
+		*streamsPD[i]->GetStream() << "Max throughput: " << mapMaxThroughput[context] << std::endl;
 	}
 
 	//flowmon->SerializeToXmlFile("application_6_a.flowmon", true, true);
@@ -561,27 +886,37 @@ void partAC() {
 }
 
 
-void partBC() {
+void partBC(TopologyParam topologyParams) {
 
 	/*
-	 *	Initialize constraints : Bandwidth-delay, #hosts, DropTailQueue
+	 *	Constraints (Bandwidth-delay, #hosts, DropTailQueue) come from main
 	 * */
-	
-	TopologyParam topologyParams;
 
 	/*
 	 *	Create Dumbbell topology
 	 * */
 	DumbbellTopology dumbbellTopology;
-	Config::SetDefault("ns3::DropTailQueue::Mode", StringValue("QUEUE_MODE_PACKETS"));
+	MemoryAccounting memory;
 
+	dumbbellTopology.setRealtime(topologyParams);
 	dumbbellTopology.setConnections(topologyParams);
 	dumbbellTopology.setErrorRate(topologyParams);
 	dumbbellTopology.createNodes(topologyParams);
+	memory.mark("nodes");
 	dumbbellTopology.setNetDevices(topologyParams);
+	memory.mark("devices, channels and queues");
 	dumbbellTopology.installInternetStack(topologyParams);
+	dumbbellTopology.setQueueDisc(topologyParams);
 	dumbbellTopology.addIpAddrToNodes(topologyParams);
 	dumbbellTopology.addIpAddrToNetDevices(topologyParams);
+	dumbbellTopology.addTapEndpoints(topologyParams);
+	memory.mark("internet stack and addresses");
+
+	FlowTable flowTable;
+	dumbbellTopology.addFlows(topologyParams, flowTable);
+	DropAccounting dropAccounting(&flowTable);
+	dropAccounting.installDevices(dumbbellTopology.getNetDevices());
+	memory.mark("drop accounting");
 	
 	/********************************************************************
 	PART (b)
@@ -597,8 +932,25 @@ void partBC() {
 	int port = 9000;
 	int numPackets = 10000000;
 	std::string transferSpeed = "400Mbps";
+	//Receivers follow the routers and the senders in the NodeList
+	int firstReceiver = topologyParams.numRouters + topologyParams.numSender;
+	//Traces, drops, queue samples and FlowMonitor only cover the measure phase
+	MeasurementPhases phases;
+	phases.set(topologyParams.warmup, topologyParams.measure);
+	double measureStart = phases.getMeasureStart();
+	double measureStop = phases.getMeasureStop(durationGap+otherFlowStart);
 		
 	
+	std::string tcpVariants[] = {"TcpReno", "TcpWestwood", "TcpFack"};
+	//Flows run on the first three host pairs, the others stay idle
+	uint32_t numFlows = 3;
+	setTcpOptions(topologyParams.ecnParams);
+	if(topologyParams.ecnParams.dctcp) {
+		std::cout << "DCTCP on every flow" << std::endl;
+		for(uint32_t i = 0; i < numFlows; ++i)
+			tcpVariants[i] = "TcpDctcp";
+	}
+
 	//TCP Reno from H1 to H4
 	std::cout << "TCP Reno from H1 to H4" << std::endl;
 	AsciiTraceHelper asciiTraceHelper;
@@ -606,15 +958,17 @@ void partBC() {
 	Ptr<OutputStreamWrapper> stream1PD = asciiTraceHelper.CreateFileStream("application_6_h1_h4_b.congestion_loss");
 	Ptr<OutputStreamWrapper> stream1TP = asciiTraceHelper.CreateFileStream("application_6_h1_h4_b.tp");
 	Ptr<OutputStreamWrapper> stream1GP = asciiTraceHelper.CreateFileStream("application_6_h1_h4_b.gp");
-	Ptr<Socket> ns3TcpSocket1 = uniFlow(InetSocketAddress(receiverIFCs.GetAddress(0), port), port, "TcpReno", senders.Get(0), receivers.Get(0), oneFlowStart, oneFlowStart+durationGap, packetSize, numPackets, transferSpeed, oneFlowStart, oneFlowStart+durationGap);
-	ns3TcpSocket1->TraceConnectWithoutContext("CongestionWindow", MakeBoundCallback (&CwndChange, stream1CWND, 0));
-	ns3TcpSocket1->TraceConnectWithoutContext("Drop", MakeBoundCallback (&packetDrop, stream1PD, 0, 1));
+	memory.mark("trace streams");
+	Ptr<Socket> ns3TcpSocket1 = uniFlow(InetSocketAddress(dumbbellTopology.getReceiverAddress(0), port), port, tcpVariants[0], dumbbellTopology.getSender(0), dumbbellTopology.getReceiver(0), oneFlowStart, oneFlowStart+durationGap, topologyParams.packetSize, numPackets, transferSpeed, oneFlowStart, oneFlowStart+durationGap);
+	ns3TcpSocket1->TraceConnectWithoutContext("CongestionWindow", MakeBoundCallback (&CwndChange, stream1CWND, measureStart));
+	dropAccounting.installSocket(ns3TcpSocket1, 0);
+	memory.mark("sockets and applications");
 
 
-	std::string sink = "/NodeList/5/ApplicationList/0/$ns3::PacketSink/Rx";
-	Config::Connect(sink, MakeBoundCallback(&ReceivedPacket, stream1GP, 0));
-	std::string sink_ = "/NodeList/5/$ns3::Ipv4L3Protocol/Rx";
-	Config::Connect(sink_, MakeBoundCallback(&ReceivedPacketIPV4, stream1TP, 0));
+	std::string sink = "/NodeList/"+std::to_string(firstReceiver+0)+"/ApplicationList/0/$ns3::PacketSink/Rx";
+	Config::Connect(sink, MakeBoundCallback(&ReceivedPacket, stream1GP, measureStart));
+	std::string sink_ = "/NodeList/"+std::to_string(firstReceiver+0)+"/$ns3::Ipv4L3Protocol/Rx";
+	Config::Connect(sink_, MakeBoundCallback(&ReceivedPacketIPV4, stream1TP, measureStart));
 
 	//TCP Westwood from H2 to H5
 	std::cout << "TCP Westwood from H2 to H5" << std::endl;
@@ -622,14 +976,16 @@ void partBC() {
 	Ptr<OutputStreamWrapper> stream2PD = asciiTraceHelper.CreateFileStream("application_6_h2_h5_b.congestion_loss");
 	Ptr<OutputStreamWrapper> stream2TP = asciiTraceHelper.CreateFileStream("application_6_h2_h5_b.tp");
 	Ptr<OutputStreamWrapper> stream2GP = asciiTraceHelper.CreateFileStream("application_6_h2_h5_b.gp");
-	Ptr<Socket> ns3TcpSocket2 = uniFlow(InetSocketAddress(receiverIFCs.GetAddress(1), port), port, "TcpWestwood", senders.Get(1), receivers.Get(1), otherFlowStart, otherFlowStart+durationGap, packetSize, numPackets, transferSpeed, otherFlowStart, otherFlowStart+durationGap);
-	ns3TcpSocket2->TraceConnectWithoutContext("CongestionWindow", MakeBoundCallback (&CwndChange, stream2CWND, 0));
-	ns3TcpSocket2->TraceConnectWithoutContext("Drop", MakeBoundCallback (&packetDrop, stream2PD, 0, 2));
+	memory.mark("trace streams");
+	Ptr<Socket> ns3TcpSocket2 = uniFlow(InetSocketAddress(dumbbellTopology.getReceiverAddress(1), port), port, tcpVariants[1], dumbbellTopology.getSender(1), dumbbellTopology.getReceiver(1), otherFlowStart, otherFlowStart+durationGap, topologyParams.packetSize, numPackets, transferSpeed, otherFlowStart, otherFlowStart+durationGap);
+	ns3TcpSocket2->TraceConnectWithoutContext("CongestionWindow", MakeBoundCallback (&CwndChange, stream2CWND, measureStart));
+	dropAccounting.installSocket(ns3TcpSocket2, 1);
+	memory.mark("sockets and applications");
 
-	sink = "/NodeList/6/ApplicationList/0/$ns3::PacketSink/Rx";
-	Config::Connect(sink, MakeBoundCallback(&ReceivedPacket, stream2GP, 0));
-	sink_ = "/NodeList/6/$ns3::Ipv4L3Protocol/Rx";
-	Config::Connect(sink_, MakeBoundCallback(&ReceivedPacketIPV4, stream2TP, 0));
+	sink = "/NodeList/"+std::to_string(firstReceiver+1)+"/ApplicationList/0/$ns3::PacketSink/Rx";
+	Config::Connect(sink, MakeBoundCallback(&ReceivedPacket, stream2GP, measureStart));
+	sink_ = "/NodeList/"+std::to_string(firstReceiver+1)+"/$ns3::Ipv4L3Protocol/Rx";
+	Config::Connect(sink_, MakeBoundCallback(&ReceivedPacketIPV4, stream2TP, measureStart));
 
 	//TCP Fack from H3 to H6
 	std::cout << "TCP Fack from H3 to H6" << std::endl;
@@ -637,77 +993,200 @@ void partBC() {
 	Ptr<OutputStreamWrapper> stream3PD = asciiTraceHelper.CreateFileStream("application_6_h3_h6_b.congestion_loss");
 	Ptr<OutputStreamWrapper> stream3TP = asciiTraceHelper.CreateFileStream("application_6_h3_h6_b.tp");
 	Ptr<OutputStreamWrapper> stream3GP = asciiTraceHelper.CreateFileStream("application_6_h3_h6_b.gp");
-	Ptr<Socket> ns3TcpSocket3 = uniFlow(InetSocketAddress(receiverIFCs.GetAddress(2), port), port, "TcpFack", senders.Get(2), receivers.Get(2), otherFlowStart, otherFlowStart+durationGap, packetSize, numPackets, transferSpeed, otherFlowStart, otherFlowStart+durationGap);
-	ns3TcpSocket3->TraceConnectWithoutContext("CongestionWindow", MakeBoundCallback (&CwndChange, stream3CWND, 0));
-	ns3TcpSocket3->TraceConnectWithoutContext("Drop", MakeBoundCallback (&packetDrop, stream3PD, 0, 3));
+	memory.mark("trace streams");
+	Ptr<Socket> ns3TcpSocket3 = uniFlow(InetSocketAddress(dumbbellTopology.getReceiverAddress(2), port), port, tcpVariants[2], dumbbellTopology.getSender(2), dumbbellTopology.getReceiver(2), otherFlowStart, otherFlowStart+durationGap, topologyParams.packetSize, numPackets, transferSpeed, otherFlowStart, otherFlowStart+durationGap);
+	ns3TcpSocket3->TraceConnectWithoutContext("CongestionWindow", MakeBoundCallback (&CwndChange, stream3CWND, measureStart));
+	dropAccounting.installSocket(ns3TcpSocket3, 2);
+	memory.mark("sockets and applications");
 
-	sink = "/NodeList/7/ApplicationList/0/$ns3::PacketSink/Rx";
-	Config::Connect(sink, MakeBoundCallback(&ReceivedPacket, stream3GP, 0));
-	sink_ = "/NodeList/7/$ns3::Ipv4L3Protocol/Rx";
-	Config::Connect(sink_, MakeBoundCallback(&ReceivedPacketIPV4, stream3TP, 0));
+	sink = "/NodeList/"+std::to_string(firstReceiver+2)+"/ApplicationList/0/$ns3::PacketSink/Rx";
+	Config::Connect(sink, MakeBoundCallback(&ReceivedPacket, stream3GP, measureStart));
+	sink_ = "/NodeList/"+std::to_string(firstReceiver+2)+"/$ns3::Ipv4L3Protocol/Rx";
+	Config::Connect(sink_, MakeBoundCallback(&ReceivedPacketIPV4, stream3TP, measureStart));
 
 	//pointToPointRouter.EnablePcapAll("application_6_HR_a");
 	//pointToPointLeaf.EnablePcapAll("application_6_RR_a");
 
+	dumbbellTopology.addCrossTraffic(topologyParams, port, oneFlowStart, durationGap+otherFlowStart);
+	memory.mark("cross traffic");
+
 	//Turning on Static Global Routing
 	std::cout << "Turning on Static Global Routing" << std::endl;
 	Ipv4GlobalRoutingHelper::PopulateRoutingTables();
+	memory.mark("routing tables");
+
+	Ptr<OutputStreamWrapper> bottleneckQs = asciiTraceHelper.CreateFileStream("application_6_b.qs");
+	QueueMonitor bottleneckMonitor;
+	bottleneckMonitor.install(dumbbellTopology.getBottleneckDevice(), bottleneckQs, 0.01, measureStart, measureStop);
 
 	std::cout << "Monitoring flows..." << std::endl;
 	Ptr<FlowMonitor> flowmon;
 	FlowMonitorHelper flowmonHelper;
-	flowmon = flowmonHelper.InstallAll();
+	FlowProbeConfig probeConfig;
+	probeConfig.startTime = measureStart;
+	probeConfig.stopTime = measureStop;
+	flowmon = dumbbellTopology.installFlowMonitor(flowmonHelper, probeConfig);
+	memory.mark("FlowMonitor");
+	std::vector<uint32_t> sinkCounters;
+	for(uint32_t i = 0; i < numFlows; ++i) {
+		Ptr<PacketSink> sinkApp = DynamicCast<PacketSink>(NodeList::GetNode(firstReceiver+i)->GetApplication(0));
+		sinkCounters.push_back(phases.addCounter(MakeCallback(&PacketSink::GetTotalRx, sinkApp)));
+	}
+	phases.schedule();
 	Simulator::Stop(Seconds(durationGap+otherFlowStart));
+	RealtimeLagMonitor lagMonitor;
+	if(topologyParams.realtime)
+		lagMonitor.start(0.01, 0.001, durationGap+otherFlowStart);
 	Simulator::Run();
+	std::cout << "Simulator events: " << Simulator::GetEventCount() << std::endl;
+	memory.mark("simulation run (events, buffers, flow records)");
 	flowmon->CheckForLostPackets();
 
-	//Ptr<OutputStreamWrapper> streamTP = asciiTraceHelper.CreateFileStream("application_6_b.tp");
 	Ptr<Ipv4FlowClassifier> classifier = DynamicCast<Ipv4FlowClassifier>(flowmonHelper.GetClassifier());
-	std::map<FlowId, FlowMonitor::FlowStats> stats = flowmon->GetFlowStats();
-	for (std::map<FlowId, FlowMonitor::FlowStats>::const_iterator i = stats.begin(); i != stats.end(); ++i) {
-		Ipv4FlowClassifier::FiveTuple t = classifier->FindFlow (i->first);
-		/*
-		*streamTP->GetStream()  << "Flow " << i->first  << " (" << t.sourceAddress << " -> " << t.destinationAddress << ")\n";
-		*streamTP->GetStream()  << "  Tx Bytes:   " << i->second.txBytes << "\n";
-		*streamTP->GetStream()  << "  Rx Bytes:   " << i->second.rxBytes << "\n";
-		*streamTP->GetStream()  << "  Time        " << i->second.timeLastRxPacket.GetSeconds() - i->second.timeFirstTxPacket.GetSeconds() << "\n";
-		*streamTP->GetStream()  << "  Throughput: " << i->second.rxBytes * 8.0 / (i->second.timeLastRxPacket.GetSeconds() - i->second.timeFirstTxPacket.GetSeconds())/1024/1024  << " Mbps\n";	
-		*/
-		if(t.sourceAddress == "10.1.0.1") {
-			if(mapDrop.find(1)==mapDrop.end())
-				mapDrop[1] = 0;
-			*stream1PD->GetStream() << "TcpReno Flow " << i->first  << " (" << t.sourceAddress << " -> " << t.destinationAddress << ")\n";
-			*stream1PD->GetStream()  << "Net Packet Lost: " << i->second.lostPackets << "\n";
-			*stream1PD->GetStream()  << "Packet Lost due to buffer overflow: " << mapDrop[1] << "\n";
-			*stream1PD->GetStream()  << "Packet Lost due to Congestion: " << i->second.lostPackets - mapDrop[1] << "\n";
-			*stream1PD->GetStream() << "Max throughput: " << mapMaxThroughput["/NodeList/5/$ns3::Ipv4L3Protocol/Rx"] << std::endl;
-		} else if(t.sourceAddress == "10.1.1.1") {
-			if(mapDrop.find(2)==mapDrop.end())
-				mapDrop[2] = 0;
-			*stream2PD->GetStream() << "TcpWestwood Flow " << i->first  << " (" << t.sourceAddress << " -> " << t.destinationAddress << ")\n";
-			*stream2PD->GetStream()  << "Net Packet Lost: " << i->second.lostPackets << "\n";
-			*stream2PD->GetStream()  << "Packet Lost due to buffer overflow: " << mapDrop[2] << "\n";
-			*stream2PD->GetStream()  << "Packet Lost due to Congestion: " << i->second.lostPackets - mapDrop[2] << "\n";
-			*stream2PD->GetStream() << "Max throughput: " << mapMaxThroughput["/NodeList/6/$ns3::Ipv4L3Protocol/Rx"] << std::endl;
-		} else if(t.sourceAddress == "10.1.2.1") {
-			if(mapDrop.find(3)==mapDrop.end())
-				mapDrop[3] = 0;
-			*stream3PD->GetStream() << "TcpFack Flow " << i->first  << " (" << t.sourceAddress << " -> " << t.destinationAddress << ")\n";
-			*stream3PD->GetStream()  << "Net Packet Lost: " << i->second.lostPackets << "\n";
-			*stream3PD->GetStream()  << "Packet Lost due to buffer overflow: " << mapDrop[3] << "\n";
-			*stream3PD->GetStream()  << "Packet Lost due to Congestion: " << i->second.lostPackets - mapDrop[3] << "\n";
-			*stream3PD->GetStream() << "Max throughput: " << mapMaxThroughput["/NodeList/7/$ns3::Ipv4L3Protocol/Rx"] << std::endl;
-		}
+	FlowExporter flowExporter(&flowTable);
+	flowExporter.collect(flowmon, classifier);
+	flowExporter.attachDrops(&dropAccounting);
+	//Bytes of the measure phase only, warm-up and cool-down excluded
+	for(uint32_t i = 0; i < numFlows; ++i)
+		flowExporter.setAppBytes(i, phases.getMeasured(sinkCounters[i]));
+	flowExporter.writeCsv("application_6_b.csv");
+
+	Ptr<OutputStreamWrapper> streamsPD[] = {stream1PD, stream2PD, stream3PD};
+	for(uint32_t i = 0; i < numFlows; ++i) {
+		const FlowEntry &e = flowTable.get(i);
+		const FlowResult &r = flowExporter.get(i);
+		if(!r.found)
+			continue;
+		std::string context = "/NodeList/"+std::to_string(firstReceiver+i)+"/$ns3::Ipv4L3Protocol/Rx";
+		*streamsPD[i]->GetStream() << tcpVariants[i] << " Flow " << r.flowId << " (" << e.source << " -> " << e.destination << ")\n";
+		*streamsPD[i]->GetStream() << "Net Packet Lost: " << r.lostPackets << "\n";
+		dropAccounting.report(i, *streamsPD[i]->GetStream());
+		*streamsPD[i]->GetStream() << "Goodput (Kbps): " << r.goodput << "\n";
+		*streamsPD[i]->GetStream() << "Max throughput: " << mapMaxThroughput[context] << std::endl;
 	}
 
+	if(topologyParams.realtime)
+		lagMonitor.report(std::cout);
+	bottleneckMonitor.report(std::cout);
+	dumbbellTopology.reportCrossTraffic(std::cout, durationGap+otherFlowStart-oneFlowStart);
+	if(topologyParams.memoryReport)
+		memory.report(std::cout, topologyParams.numSender);
+
 	//flowmon->SerializeToXmlFile("application_6_b.flowmon", true, true);
 	std::cout << "Simulation finished" << std::endl;
 	Simulator::Destroy();
 
 }
 
+/*
+	Long flows across every hop of a parking lot plus cross traffic on each
+	hop; all flows start within the first second and run for durationGap.
+	Per-flow results go to application_6_parking_lot.csv.
+*/
+void partParkingLot(ParkingLotParam params) {
+	double durationGap = 100;
+	int port = 9000;
+	int numPackets = 10000000;
+	std::string transferSpeed = "400Mbps";
+	std::string tcpVariants[] = {"TcpReno", "TcpWestwood", "TcpFack"};
+
+	ParkingLotTopology parkingLot;
+	parkingLot.build(params);
+
+	FlowTable flowTable;
+	parkingLot.addFlows(flowTable);
+	DropAccounting dropAccounting(&flowTable);
+	dropAccounting.installDevices(parkingLot.getNetDevices());
+
+	Ptr<UniformRandomVariable> startJitter = CreateObject<UniformRandomVariable>();
+	for(uint32_t i = 0; i < parkingLot.getNumFlows(); ++i) {
+		double start = startJitter->GetValue(0, 1);
+		Ptr<Socket> ns3TcpSocket = uniFlow(InetSocketAddress(parkingLot.getReceiverAddress(i), port), port, tcpVariants[i%3], parkingLot.getSender(i), parkingLot.getReceiver(i), start, start+durationGap, params.packetSize, numPackets, transferSpeed, start, start+durationGap);
+		dropAccounting.installSocket(ns3TcpSocket, i);
+	}
+
+	Ptr<FlowMonitor> flowmon;
+	FlowMonitorHelper flowmonHelper;
+	flowmon = flowmonHelper.InstallAll();
+	Simulator::Stop(Seconds(durationGap+1));
+	Simulator::Run();
+	flowmon->CheckForLostPackets();
+
+	FlowExporter flowExporter(&flowTable);
+	flowExporter.collect(flowmon, DynamicCast<Ipv4FlowClassifier>(flowmonHelper.GetClassifier()));
+	flowExporter.attachDrops(&dropAccounting);
+	flowExporter.writeCsv("application_6_parking_lot.csv");
+	std::cout << "Simulation finished" << std::endl;
+	Simulator::Destroy();
+}
+
 int main(int argc, char **argv) {
-	
+	TopologyParam topologyParams;
+
+	CommandLine cmd;
+	cmd.AddValue("queueDisc", "Bottleneck queue discipline: None, DropTail, RED, CoDel, FqCoDel or Pie", topologyParams.queueDisc);
+	cmd.AddValue("sack", "Selective acknowledgements on every TCP socket", topologyParams.ecnParams.sack);
+	cmd.AddValue("ecn", "ECN on every TCP socket and marking at the bottleneck AQM", topologyParams.ecnParams.ecn);
+	cmd.AddValue("dctcp", "DCTCP on every flow with step marking (RED) at the bottleneck, implies ecn", topologyParams.ecnParams.dctcp);
+	cmd.AddValue("markThreshold", "DCTCP marking threshold K (packets)", topologyParams.ecnParams.markThreshold);
+	cmd.AddValue("realtime", "Run on the realtime simulator (emulation)", topologyParams.realtime);
+	cmd.AddValue("tapSenders", "Senders that get a tap endpoint, e.g. 0,2", topologyParams.tapSenders);
+	cmd.AddValue("tapReceivers", "Receivers that get a tap endpoint, e.g. 0,2", topologyParams.tapReceivers);
+	cmd.AddValue("tapMode", "TapBridge mode: ConfigureLocal, UseLocal or UseBridge", topologyParams.tapMode);
+	cmd.AddValue("numHostPairs", "Sender/receiver pairs of the dumbbell (flows run on the first three)", topologyParams.numSender);
+	cmd.AddValue("slimStack", "IPv4+TCP only on the hosts, no IPv6 anywhere", topologyParams.slimStack);
+	cmd.AddValue("memoryReport", "Report memory per subsystem and per host pair", topologyParams.memoryReport);
+	cmd.AddValue("warmup", "Warm-up before the measure phase (s), nothing is recorded", topologyParams.warmup);
+	cmd.AddValue("measure", "Length of the measure phase (s), -1 until the end; the rest is cool-down", topologyParams.measure);
+	uint32_t seed = 1;
+	uint64_t run = 1;
+	cmd.AddValue("seed", "RNG seed", seed);
+	cmd.AddValue("run", "RNG run number", run);
+	cmd.AddValue("crossTraffic", "UDP cross-traffic sources on extra leaf pairs, e.g. CBR,Pareto,Trace", topologyParams.crossParams.sources);
+	cmd.AddValue("crossRate", "Cross-traffic CBR rate, Pareto rate while on", topologyParams.crossParams.rate);
+	cmd.AddValue("crossPacketSize", "Cross-traffic CBR and Pareto datagram payload (bytes)", topologyParams.crossParams.packetSize);
+	cmd.AddValue("crossOnMean", "Mean Pareto on time (s)", topologyParams.crossParams.onMean);
+	cmd.AddValue("crossOffMean", "Mean Pareto off time (s)", topologyParams.crossParams.offMean);
+	cmd.AddValue("crossShape", "Pareto shape of the on and off times", topologyParams.crossParams.shape);
+	cmd.AddValue("crossTrace", "Trace cross traffic: \"<bytes> <inter-arrival s>\" lines", topologyParams.crossParams.traceFile);
+	cmd.AddValue("crossTraceLoop", "Start the trace over at its end", topologyParams.crossParams.traceLoop);
+	std::string leafParamsFile = "";
+	std::string leafDelayDistribution = "";
+	double leafDelayMin = 10, leafDelayMax = 100;
+	cmd.AddValue("leafParamsFile", "Per-leaf \"<bandwidth> <delay>\" lines, one per host pair", leafParamsFile);
+	cmd.AddValue("leafDelayDistribution", "Per-leaf delays drawn from Uniform or LogUniform", leafDelayDistribution);
+	cmd.AddValue("leafDelayMin", "Smallest per-leaf delay (ms)", leafDelayMin);
+	cmd.AddValue("leafDelayMax", "Largest per-leaf delay (ms)", leafDelayMax);
+	std::string topology = "Dumbbell";
+	ParkingLotParam parkingLotParams;
+	cmd.AddValue("topology", "Dumbbell or ParkingLot", topology);
+	cmd.AddValue("numRouters", "Routers in the parking lot chain", parkingLotParams.numRouters);
+	cmd.AddValue("numLongFlows", "Parking lot flows crossing every hop", parkingLotParams.numLongFlows);
+	cmd.AddValue("numCrossFlows", "Parking lot cross-traffic flows per hop", parkingLotParams.numCrossFlows);
+	cmd.AddValue("routing", "Parking lot routing: Static or Global", parkingLotParams.routing);
+	cmd.Parse(argc, argv);
+	//Before anything draws: leaf delays, error models, parking lot start times
+	RngSeedManager::SetSeed(seed);
+	RngSeedManager::SetRun(run);
+
+	if(topology.compare("ParkingLot") == 0) {
+		partParkingLot(parkingLotParams);
+		return 0;
+	}
+
+	if(topologyParams.numSender < 3) {
+		fprintf(stderr, "The dumbbell needs at least 3 host pairs\n");
+		exit(EXIT_FAILURE);
+	}
+	topologyParams.numRecv = topologyParams.numSender;
+	topologyParams.numCross = parseCrossSources(topologyParams.crossParams).size();
+	topologyParams.queueDisc = checkEcnParam(topologyParams.ecnParams, topologyParams.queueDisc);
+
+	if(!leafParamsFile.empty())
+		loadLeafParams(topologyParams, leafParamsFile);
+	else if(!leafDelayDistribution.empty())
+		generateLeafDelays(topologyParams, leafDelayDistribution, leafDelayMin, leafDelayMax);
+
 		//partAC();
-		partBC();
+		partBC(topologyParams);
 }
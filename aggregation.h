@@ -0,0 +1,409 @@
+#ifndef AGGREGATION_H
+#define AGGREGATION_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <atomic>
+#include <limits>
+#include <fstream>
+#include <cmath>
+#include <cstring>
+#include <cstdio>
+#include <cstdint>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*
+	Live aggregation of a sweep.
+	The parent of a sweep (runScenarios) creates a POSIX shared-memory
+	table of groups, one per (sweep point, flow label); each child run adds
+	the per-flow summary of its run (the metrics below) to its group when it
+	finishes, and the parent rewrites the sweep table after every exit, so
+	the table is there as soon as the last run ends instead of after a
+	separate pass over all the CSVs.
+	Children merge straight into the shared table, without a lock and
+	without the parent's help:
+	- count, sum, min and max of each metric are atomics (fetch_add, and
+	  compare-and-swap loops for the doubles),
+	- percentiles come from a log-bucketed sketch (DDSketch, Masson et al.,
+	  VLDB 2019): bucket i counts the values in (gamma^(i-1), gamma^i] with
+	  gamma = (1+a)/(1-a), so any quantile is within a relative error a,
+	  and merging is adding bucket counts, hence an atomic add per value.
+	A group is claimed with a compare-and-swap of its state; the only wait
+	is another process copying the key of the group it is claiming.
+	No ns-3 dependency.
+*/
+#define AGG_MAGIC 0x52474741u		// "AGGR"
+#define AGG_VERSION 1
+#define AGG_GROUPS 512
+#define AGG_KEY_SIZE 248
+#define AGG_METRICS 5
+#define AGG_BUCKETS 1024
+#define AGG_ACCURACY 0.02			// relative error of the percentiles
+#define AGG_MIN_VALUE 1e-8			// smaller values (and zero) are counted apart
+
+static const char *aggMetricNames[AGG_METRICS] = {"throughput_kbps", "goodput_kbps", "loss_rate", "delay_ms", "jitter_ms"};
+
+struct AggMetric
+{
+	std::atomic<uint64_t> count;
+	std::atomic<uint64_t> sum;			// bits of a double
+	std::atomic<uint64_t> min;			// bits of a double
+	std::atomic<uint64_t> max;			// bits of a double
+	std::atomic<uint64_t> zeros;		// values below AGG_MIN_VALUE
+	std::atomic<uint64_t> buckets[AGG_BUCKETS];
+};
+
+struct AggGroup
+{
+	std::atomic<uint32_t> state;		// 0 free, 1 being claimed, 2 in use
+	uint32_t pad;
+	char key[AGG_KEY_SIZE];				// point '\t' label
+	AggMetric metrics[AGG_METRICS];
+};
+
+struct AggHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	std::atomic<uint64_t> records;		// flow summaries added
+	std::atomic<uint64_t> dropped;		// ... that found no free group
+};
+
+size_t aggSize() {
+	return sizeof(AggHeader) + AGG_GROUPS*sizeof(AggGroup);
+}
+
+AggGroup *aggGroups(AggHeader *header) {
+	return (AggGroup *)(header + 1);
+}
+
+uint64_t aggBits(double value) {
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+double aggValue(uint64_t bits) {
+	double value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+void aggAdd(std::atomic<uint64_t> &target, double value) {
+	uint64_t old = target.load(std::memory_order_relaxed);
+	while(!target.compare_exchange_weak(old, aggBits(aggValue(old) + value), std::memory_order_relaxed))
+		;
+}
+
+void aggMin(std::atomic<uint64_t> &target, double value) {
+	uint64_t old = target.load(std::memory_order_relaxed);
+	while(value < aggValue(old) && !target.compare_exchange_weak(old, aggBits(value), std::memory_order_relaxed))
+		;
+}
+
+void aggMax(std::atomic<uint64_t> &target, double value) {
+	uint64_t old = target.load(std::memory_order_relaxed);
+	while(value > aggValue(old) && !target.compare_exchange_weak(old, aggBits(value), std::memory_order_relaxed))
+		;
+}
+
+double aggLogGamma() {
+	return std::log((1 + AGG_ACCURACY)/(1 - AGG_ACCURACY));
+}
+
+//Bucket of a value >= AGG_MIN_VALUE, the largest values share the last one
+uint32_t aggBucket(double value) {
+	double i = std::ceil(std::log(value/AGG_MIN_VALUE)/aggLogGamma());
+	if(i < 0)
+		return 0;
+	return i >= AGG_BUCKETS ? AGG_BUCKETS - 1 : (uint32_t)i;
+}
+
+//Representative value of a bucket, within AGG_ACCURACY of all its values
+double aggBucketValue(uint32_t bucket) {
+	double gamma = std::exp(aggLogGamma());
+	return AGG_MIN_VALUE*std::pow(gamma, bucket)*2/(gamma + 1);
+}
+
+void aggInsert(AggMetric &metric, double value) {
+	if(std::isnan(value))
+		return;
+	metric.count.fetch_add(1, std::memory_order_relaxed);
+	aggAdd(metric.sum, value);
+	aggMin(metric.min, value);
+	aggMax(metric.max, value);
+	if(value < AGG_MIN_VALUE)
+		metric.zeros.fetch_add(1, std::memory_order_relaxed);
+	else
+		metric.buckets[aggBucket(value)].fetch_add(1, std::memory_order_relaxed);
+}
+
+//q-quantile from the sketch; values below AGG_MIN_VALUE count as 0
+double aggQuantile(const AggMetric &metric, double q) {
+	uint64_t zeros = metric.zeros.load(std::memory_order_relaxed);
+	std::vector<uint64_t> counts(AGG_BUCKETS);
+	uint64_t total = zeros;
+	for(uint32_t i = 0; i < AGG_BUCKETS; ++i) {
+		counts[i] = metric.buckets[i].load(std::memory_order_relaxed);
+		total += counts[i];
+	}
+	if(total == 0)
+		return 0;
+	uint64_t rank = (uint64_t)(q*(total - 1));
+	if(rank < zeros)
+		return 0;
+	uint64_t seen = zeros;
+	for(uint32_t i = 0; i < AGG_BUCKETS; ++i) {
+		seen += counts[i];
+		if(seen > rank)
+			return aggBucketValue(i);
+	}
+	return aggBucketValue(AGG_BUCKETS - 1);
+}
+
+uint64_t aggHash(const std::string &key) {
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	for(size_t i = 0; i < key.size(); ++i) {
+		hash ^= (unsigned char)key[i];
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+//Group of a key, claimed if it is not there yet; null when the table is full
+AggGroup *aggFindGroup(AggHeader *header, std::string key) {
+	if(key.size() >= AGG_KEY_SIZE)
+		key.resize(AGG_KEY_SIZE - 1);
+	AggGroup *groups = aggGroups(header);
+	uint64_t start = aggHash(key);
+	for(uint32_t n = 0; n < AGG_GROUPS; ++n) {
+		AggGroup &group = groups[(start + n) % AGG_GROUPS];
+		uint32_t state = group.state.load(std::memory_order_acquire);
+		if(state == 0) {
+			if(group.state.compare_exchange_strong(state, 1, std::memory_order_acq_rel)) {
+				strncpy(group.key, key.c_str(), AGG_KEY_SIZE - 1);
+				for(uint32_t m = 0; m < AGG_METRICS; ++m) {
+					group.metrics[m].min.store(aggBits(std::numeric_limits<double>::infinity()), std::memory_order_relaxed);
+					group.metrics[m].max.store(aggBits(-std::numeric_limits<double>::infinity()), std::memory_order_relaxed);
+				}
+				group.state.store(2, std::memory_order_release);
+				return &group;
+			}
+		}
+		while(state == 1)
+			state = group.state.load(std::memory_order_acquire);
+		if(strncmp(group.key, key.c_str(), AGG_KEY_SIZE) == 0)
+			return &group;
+	}
+	return 0;
+}
+
+//One flow of one run: values in the order of aggMetricNames
+void aggAddFlow(AggHeader *header, std::string point, std::string label, const double *values) {
+	AggGroup *group = aggFindGroup(header, point + "\t" + label);
+	if(!group) {
+		header->dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	for(uint32_t m = 0; m < AGG_METRICS; ++m)
+		aggInsert(group->metrics[m], values[m]);
+	header->records.fetch_add(1, std::memory_order_release);
+}
+
+//Sweep point as a group key: its options without the replica-specific ones
+std::string aggPointKey(const std::vector<std::string> &point) {
+	std::string key;
+	for(uint32_t i = 0; i < point.size(); ++i) {
+		std::string arg = point[i];
+		if(arg.compare(0, 6, "--run=") == 0 || arg.compare(0, 11, "--replicas=") == 0 || arg.compare(0, 9, "--outDir=") == 0)
+			continue;
+		if(arg.compare(0, 2, "--") == 0)
+			arg = arg.substr(2);
+		key += (key.empty() ? "" : " ") + arg;
+	}
+	return key.empty() ? "base" : key;
+}
+
+AggHeader *aggMap(std::string name, int flags) {
+	int fd = shm_open(name.c_str(), flags, 0644);
+	if(fd < 0) {
+		perror("shm_open");
+		return 0;
+	}
+	if((flags & O_CREAT) && ftruncate(fd, aggSize()) != 0) {
+		perror("ftruncate");
+		close(fd);
+		return 0;
+	}
+	void *mem = mmap(NULL, aggSize(), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if(mem == MAP_FAILED) {
+		perror("mmap");
+		return 0;
+	}
+	return (AggHeader *)mem;
+}
+
+//Child side: adds the flows of a finished run to the table of the parent
+class AggregatorClient
+{
+private:
+	AggHeader *header;
+
+public:
+	AggregatorClient();
+	~AggregatorClient();
+	bool open(std::string name);
+	void addFlow(std::string point, std::string label, const double *values);
+};
+
+AggregatorClient::AggregatorClient() {
+	this->header = 0;
+}
+
+AggregatorClient::~AggregatorClient() {
+	if(this->header)
+		munmap(this->header, aggSize());
+}
+
+bool AggregatorClient::open(std::string name) {
+	this->header = aggMap(name, O_RDWR);
+	if(this->header && (this->header->magic != AGG_MAGIC || this->header->version != AGG_VERSION)) {
+		munmap(this->header, aggSize());
+		this->header = 0;
+	}
+	return this->header != 0;
+}
+
+void AggregatorClient::addFlow(std::string point, std::string label, const double *values) {
+	if(this->header)
+		aggAddFlow(this->header, point, label, values);
+}
+
+/*
+	Parent side: owns the table (/sweep_<pid>, removed with the object) and
+	writes it out as tableFile, one row per group, sorted by point:
+		point,label,runs,<metric>_mean,_min,_p50,_p95,_max ...
+	csvName is the per-flow CSV of a run, read back for the runs the
+	results cache answers instead of a child.
+*/
+class SweepAggregator
+{
+private:
+	std::string name;
+	AggHeader *header;
+	std::string tableFile;
+	std::string csvName;
+
+public:
+	SweepAggregator();
+	~SweepAggregator();
+	void setOutput(std::string tableFile, std::string csvName);
+	bool open();
+	bool isOpen();
+	std::string getName();
+	std::string getCsvName();
+	void addFlow(std::string point, std::string label, const double *values);
+	uint64_t getRecords();
+	bool writeTable();
+};
+
+SweepAggregator::SweepAggregator() {
+	this->header = 0;
+}
+
+SweepAggregator::~SweepAggregator() {
+	if(this->header) {
+		munmap(this->header, aggSize());
+		shm_unlink(this->name.c_str());
+	}
+}
+
+void SweepAggregator::setOutput(std::string tableFile, std::string csvName) {
+	this->tableFile = tableFile;
+	this->csvName = csvName;
+}
+
+bool SweepAggregator::open() {
+	this->name = "/sweep_" + std::to_string(getpid());
+	this->header = aggMap(this->name, O_CREAT | O_RDWR | O_TRUNC);
+	if(!this->header)
+		return false;
+	this->header->records.store(0, std::memory_order_relaxed);
+	this->header->dropped.store(0, std::memory_order_relaxed);
+	this->header->version = AGG_VERSION;
+	std::atomic_thread_fence(std::memory_order_release);
+	this->header->magic = AGG_MAGIC;
+	return true;
+}
+
+bool SweepAggregator::isOpen() {
+	return this->header != 0;
+}
+
+std::string SweepAggregator::getName() {
+	return this->name;
+}
+
+std::string SweepAggregator::getCsvName() {
+	return this->csvName;
+}
+
+void SweepAggregator::addFlow(std::string point, std::string label, const double *values) {
+	aggAddFlow(this->header, point, label, values);
+}
+
+uint64_t SweepAggregator::getRecords() {
+	return this->header ? this->header->records.load(std::memory_order_acquire) : 0;
+}
+
+//Written to a temporary file and renamed, so a reader never sees half a table
+bool SweepAggregator::writeTable() {
+	if(!this->header)
+		return false;
+	std::map<std::string, AggGroup *> sorted;
+	AggGroup *groups = aggGroups(this->header);
+	for(uint32_t i = 0; i < AGG_GROUPS; ++i) {
+		if(groups[i].state.load(std::memory_order_acquire) == 2)
+			sorted[groups[i].key] = &groups[i];
+	}
+	std::string tmp = this->tableFile + ".tmp";
+	std::ofstream out(tmp.c_str());
+	if(!out)
+		return false;
+	out << "point,label,runs";
+	for(uint32_t m = 0; m < AGG_METRICS; ++m) {
+		std::string n = aggMetricNames[m];
+		out << "," << n << "_mean," << n << "_min," << n << "_p50," << n << "_p95," << n << "_max";
+	}
+	out << "\n";
+	for(std::map<std::string, AggGroup *>::iterator it = sorted.begin(); it != sorted.end(); ++it) {
+		size_t tab = it->first.find('\t');
+		const AggGroup &group = *it->second;
+		uint64_t runs = group.metrics[0].count.load(std::memory_order_relaxed);
+		out << "\"" << it->first.substr(0, tab) << "\"," << it->first.substr(tab + 1) << "," << runs;
+		for(uint32_t m = 0; m < AGG_METRICS; ++m) {
+			const AggMetric &metric = group.metrics[m];
+			uint64_t count = metric.count.load(std::memory_order_relaxed);
+			if(count == 0) {
+				out << ",,,,,";
+				continue;
+			}
+			out << "," << aggValue(metric.sum.load(std::memory_order_relaxed))/count
+				<< "," << aggValue(metric.min.load(std::memory_order_relaxed))
+				<< "," << aggQuantile(metric, 0.5) << "," << aggQuantile(metric, 0.95)
+				<< "," << aggValue(metric.max.load(std::memory_order_relaxed));
+		}
+		out << "\n";
+	}
+	out.close();
+	if(this->header->dropped.load(std::memory_order_relaxed))
+		fprintf(stderr, "Sweep table full: %llu flow summaries dropped\n", (unsigned long long)this->header->dropped.load());
+	return rename(tmp.c_str(), this->tableFile.c_str()) == 0;
+}
+
+#endif
@@ -0,0 +1,184 @@
+#ifndef BOTTLENECK_H
+#define BOTTLENECK_H
+
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/traffic-control-module.h"
+#include "measurementPhases.h"
+
+using namespace ns3;
+
+/*
+	Queue discipline on the bottleneck (R1-R2) link.
+	"None" keeps the old behaviour: the only buffer is the DropTailQueue
+	of the PointToPointNetDevice, sized by the bandwidth-delay formula.
+	Any other value installs a root queue disc through the traffic-control
+	layer. The device queue is then shrunk to BOTTLENECK_DEVICE_QUEUE so that
+	the backlog builds up in the queue disc, where the AQM can act on it.
+*/
+#define BOTTLENECK_DEVICE_QUEUE "1p"
+
+bool isQueueDiscEnabled(std::string queueDisc) {
+	return queueDisc.compare("None") != 0;
+}
+
+std::string queueDiscTypeName(std::string queueDisc) {
+	if(queueDisc.compare("DropTail") == 0) {
+		return "ns3::FifoQueueDisc";
+	} else if(queueDisc.compare("RED") == 0) {
+		return "ns3::RedQueueDisc";
+	} else if(queueDisc.compare("CoDel") == 0) {
+		return "ns3::CoDelQueueDisc";
+	} else if(queueDisc.compare("FqCoDel") == 0) {
+		return "ns3::FqCoDelQueueDisc";
+	} else if(queueDisc.compare("Pie") == 0) {
+		return "ns3::PieQueueDisc";
+	}
+	fprintf(stderr, "Invalid queue discipline\n");
+	exit(EXIT_FAILURE);
+}
+
+/*
+	Bandwidth-delay product in packets of packetSize bytes, at least one:
+	rate (bits/s) * delay (s) / (8 * packetSize).
+*/
+uint32_t bdpPackets(std::string rate, Time delay, uint32_t packetSize) {
+	double packets = DataRate(rate).GetBitRate()*delay.GetSeconds()/(8.0*packetSize);
+	return packets < 1 ? 1 : (uint32_t)(packets + 0.5);
+}
+
+/*
+	TrafficControlHelper::Install must run after the internet stack is
+	installed (it needs the TrafficControlLayer of the node) and before
+	Ipv4AddressHelper::Assign, which otherwise installs a default
+	pfifo_fast queue disc on every device that has none.
+*/
+QueueDiscContainer installBottleneckQueueDisc(NetDeviceContainer devices, std::string queueDisc, std::string maxSize) {
+	std::cout << "Bottleneck queue disc: " << queueDisc << " (" << maxSize << ")" << std::endl;
+	TrafficControlHelper tch;
+	tch.SetRootQueueDisc(queueDiscTypeName(queueDisc), "MaxSize", QueueSizeValue(QueueSize(maxSize)));
+	return tch.Install(devices);
+}
+
+/*
+	Samples the queue occupancy of one device every `interval` seconds and
+	accumulates the sojourn time of every packet leaving its root queue disc.
+	The per-packet work is a sum and a max; everything else happens in one
+	scheduled event per interval, so the overhead does not depend on the
+	packet rate.
+	Output columns: time, queue disc packets, queue disc bytes,
+	device queue packets, mean and max sojourn time (ms) over the interval.
+*/
+class QueueMonitor
+{
+private:
+	Ptr<QueueDisc> queueDisc;
+	Ptr<Queue<Packet> > deviceQueue;
+	Ptr<OutputStreamWrapper> stream;
+	double interval;
+	double startTime;
+	double stopTime;
+
+	double sojournSum, sojournMax;
+	uint64_t sojournCount;
+	double totalSojournSum, totalSojournMax;
+	uint64_t totalSojournCount;
+	uint64_t totalSamples, totalQueuedPackets;
+
+	void sample();
+	void sojournTime(Time sojourn);
+
+public:
+	QueueMonitor();
+	void install(Ptr<NetDevice> device, Ptr<OutputStreamWrapper> stream, double interval, double startTime, double stopTime);
+	void report(std::ostream &os);
+};
+
+QueueMonitor::QueueMonitor() {
+	this->interval = 0;
+	this->startTime = 0;
+	this->stopTime = 0;
+	this->sojournSum = this->sojournMax = 0;
+	this->sojournCount = 0;
+	this->totalSojournSum = this->totalSojournMax = 0;
+	this->totalSojournCount = 0;
+	this->totalSamples = this->totalQueuedPackets = 0;
+}
+
+/*
+	Must be called after IP addresses are assigned, since that is when the
+	default queue disc shows up on devices without an explicit one.
+*/
+void QueueMonitor::install(Ptr<NetDevice> device, Ptr<OutputStreamWrapper> stream, double interval, double startTime, double stopTime) {
+	this->stream = stream;
+	this->interval = interval;
+	this->startTime = startTime;
+	this->stopTime = stopTime;
+
+	Ptr<PointToPointNetDevice> p2pDevice = DynamicCast<PointToPointNetDevice>(device);
+	if(p2pDevice) {
+		this->deviceQueue = p2pDevice->GetQueue();
+	}
+	Ptr<TrafficControlLayer> tc = device->GetNode()->GetObject<TrafficControlLayer>();
+	if(tc) {
+		this->queueDisc = tc->GetRootQueueDiscOnDevice(device);
+	}
+	if(this->queueDisc) {
+		this->queueDisc->TraceConnectWithoutContext("SojournTime", MakeCallback(&QueueMonitor::sojournTime, this));
+	}
+	Simulator::Schedule(Seconds(startTime + interval), &QueueMonitor::sample, this);
+}
+
+void QueueMonitor::sojournTime(Time sojourn) {
+	if(!measuring)
+		return;
+	double ms = sojourn.GetSeconds()*1000;
+	this->sojournSum += ms;
+	this->sojournCount++;
+	if(ms > this->sojournMax)
+		this->sojournMax = ms;
+}
+
+void QueueMonitor::sample() {
+	double timeNow = Simulator::Now().GetSeconds();
+	uint32_t qdPackets = this->queueDisc ? this->queueDisc->GetNPackets() : 0;
+	uint32_t qdBytes = this->queueDisc ? this->queueDisc->GetNBytes() : 0;
+	uint32_t devPackets = this->deviceQueue ? this->deviceQueue->GetNPackets() : 0;
+	double meanSojourn = this->sojournCount ? this->sojournSum/this->sojournCount : 0;
+
+	//Outside the measure phase the samples are neither written nor counted
+	if(measuring) {
+		*this->stream->GetStream() << timeNow - this->startTime << "\t" << qdPackets << "\t" << qdBytes << "\t" << devPackets
+			<< "\t" << meanSojourn << "\t" << this->sojournMax << "\n";
+
+		this->totalSojournSum += this->sojournSum;
+		this->totalSojournCount += this->sojournCount;
+		if(this->sojournMax > this->totalSojournMax)
+			this->totalSojournMax = this->sojournMax;
+		this->totalSamples++;
+		this->totalQueuedPackets += qdPackets + devPackets;
+	}
+	this->sojournSum = this->sojournMax = 0;
+	this->sojournCount = 0;
+
+	if(timeNow + this->interval <= this->stopTime)
+		Simulator::Schedule(Seconds(this->interval), &QueueMonitor::sample, this);
+}
+
+void QueueMonitor::report(std::ostream &os) {
+	os << "Mean queue length (packets): " << (this->totalSamples ? (double)this->totalQueuedPackets/this->totalSamples : 0) << "\n";
+	os << "Mean sojourn time (ms): " << (this->totalSojournCount ? this->totalSojournSum/this->totalSojournCount : 0) << "\n";
+	os << "Max sojourn time (ms): " << this->totalSojournMax << "\n";
+	if(this->queueDisc) {
+		QueueDisc::Stats st = this->queueDisc->GetStats();
+		os << "Queue disc dropped packets: " << st.nTotalDroppedPackets << "\n";
+		os << "Queue disc marked packets: " << st.nTotalMarkedPackets << "\n";
+	}
+	os << std::flush;
+}
+
+#endif
@@ -0,0 +1,165 @@
+#ifndef BUFFER_SIZING_H
+#define BUFFER_SIZING_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include "replicas.h"
+
+/*
+	Bottleneck buffer sizing explorer.
+	For each TCP variant (run on every sender), searches the bottleneck
+	buffer between minBdp and maxBdp times the bandwidth-delay product for
+	the knee of the throughput/delay curve, i.e. the buffer that maximises
+	the power throughput/delay (Kleinrock): below it the link idles, above
+	it the extra buffer only adds queueing delay.
+	The search is a k-section search on log(buffer): each round runs k
+	evenly spaced candidates inside the current bracket for every variant
+	at once (runScenarios, `parallel` at a time, cached when cacheDir is
+	set) and narrows the bracket to the neighbours of the best one, so it
+	shrinks by 2/(k+1) per round; k = max(3, parallel). Each candidate is a
+	short run of `duration` seconds (--duration) with
+	--bottleneckBuffer=<packets>, in outDir/<variant>/buffer_<packets>/.
+	The power is computed from the per-flow CSV of each run (csvName): sum
+	of the flow throughputs over their mean one-way delay, weighted by the
+	packets received.
+	- outDir/sizing_runs.csv: every candidate, with its utilisation of the
+	  bottleneck (bottleneckKbps) and mean delay,
+	- outDir/sizing_knee.csv: the knee per variant.
+	The flow count is not swept: every run has the scenario's numSenders
+	flows (three in part23, which wires the traces of each host pair by
+	hand), so the `flows` column only records it. A knee per flow count
+	needs a scenario whose number of senders is an option.
+	Assumes power is unimodal in the buffer size, which holds for loss-based
+	TCP on a single bottleneck; the full candidate list is kept to check it.
+*/
+struct SizingPoint
+{
+	uint32_t buffer;			// packets
+	double throughput;			// Kbps, all flows
+	double delay;				// ms, mean one-way
+	double power;				// -1 when the run failed
+};
+
+//Throughput and mean delay over the flows of one run, from its per-flow CSV
+SizingPoint readSizingPoint(std::string csvFile, uint32_t buffer) {
+	SizingPoint point;
+	point.buffer = buffer;
+	point.throughput = point.delay = 0;
+	point.power = -1;
+	std::vector<std::map<std::string, std::string> > rows = readCsv(csvFile);
+	double packets = 0;
+	for(uint32_t i = 0; i < rows.size(); ++i) {
+		if(rows[i]["found"] != "1")
+			continue;
+		double rx = std::stod(rows[i]["rxPackets"]);
+		point.throughput += std::stod(rows[i]["throughput_kbps"]);
+		point.delay += std::stod(rows[i]["delay_ms"])*rx;
+		packets += rx;
+	}
+	if(packets > 0) {
+		point.delay /= packets;
+		point.power = point.delay > 0 ? point.throughput/point.delay : 0;
+	}
+	return point;
+}
+
+int runBufferSizing(int argc, char **argv, std::vector<std::string> variants, uint32_t numSenders, uint32_t bdp, double bottleneckKbps,
+		double minBdp, double maxBdp, uint32_t rounds, double duration, uint32_t parallel, std::string outDir, std::string csvName, std::string cacheDir) {
+	if(minBdp <= 0 || maxBdp <= minBdp || rounds == 0 || duration <= 0) {
+		fprintf(stderr, "Invalid buffer sizing range\n");
+		exit(EXIT_FAILURE);
+	}
+	std::vector<std::string> args = stripOptions(argc, argv, {"sizing", "sizingMin", "sizingMax", "sizingRounds", "sizingDuration",
+		"variants", "bottleneckBuffer", "duration", "replicas", "parallel", "outDir", "cacheDir"});
+	uint32_t k = parallel > 3 ? parallel : 3;
+	uint32_t v = variants.size();
+	//Brackets in log(buffer/bdp); every buffer tried so far, per variant
+	std::vector<double> lo(v, std::log(minBdp)), hi(v, std::log(maxBdp));
+	std::vector<std::map<uint32_t, SizingPoint> > tried(v);
+	SystemPath::MakeDirectories(outDir);
+
+	std::ofstream runs((outDir + "sizing_runs.csv").c_str());
+	runs << "variant,flows,round,buffer_packets,buffer_bdp,throughput_kbps,utilization,delay_ms,power\n";
+	uint32_t failed = 0;
+	for(uint32_t round = 0; round < rounds; ++round) {
+		std::vector<std::vector<uint32_t> > candidates(v);
+		std::vector<std::vector<std::string> > points;
+		std::vector<std::string> dirs;
+		std::vector<std::pair<uint32_t, uint32_t> > owner;		// (variant, buffer) of each point
+		for(uint32_t i = 0; i < v; ++i) {
+			std::string list;
+			for(uint32_t s = 0; s < numSenders; ++s)
+				list += (s ? "," : "") + variants[i];
+			for(uint32_t c = 1; c <= k; ++c) {
+				double x = lo[i] + (hi[i] - lo[i])*c/(k + 1);
+				uint32_t buffer = (uint32_t)std::lround(bdp*std::exp(x));
+				if(buffer < 1)
+					buffer = 1;
+				candidates[i].push_back(buffer);
+				if(tried[i].count(buffer))
+					continue;
+				tried[i][buffer] = SizingPoint();
+				std::string dir = outDir + variants[i] + "/buffer_" + std::to_string(buffer) + "/";
+				points.push_back({"--replicas=1", "--variants=" + list, "--bottleneckBuffer=" + std::to_string(buffer),
+					"--duration=" + std::to_string(duration)});
+				dirs.push_back(dir);
+				owner.push_back(std::make_pair(i, buffer));
+			}
+		}
+		std::cout << "Buffer sizing round " << round + 1 << "/" << rounds << ": " << points.size() << " runs" << std::endl;
+		failed += runScenarios(args, points, dirs, parallel, cacheDir);
+
+		for(uint32_t p = 0; p < points.size(); ++p) {
+			uint32_t i = owner[p].first;
+			SizingPoint point = readSizingPoint(dirs[p] + csvName, owner[p].second);
+			tried[i][point.buffer] = point;
+			runs << variants[i] << "," << numSenders << "," << round + 1 << "," << point.buffer << "," << (double)point.buffer/bdp << ","
+				<< point.throughput << "," << point.throughput/bottleneckKbps << "," << point.delay << "," << point.power << "\n";
+		}
+
+		//New bracket: the neighbours of this round's best candidate
+		for(uint32_t i = 0; i < v; ++i) {
+			uint32_t best = 0;
+			for(uint32_t c = 1; c < k; ++c) {
+				if(tried[i][candidates[i][c]].power > tried[i][candidates[i][best]].power)
+					best = c;
+			}
+			double width = (hi[i] - lo[i])/(k + 1);
+			double newLo = lo[i] + width*best;
+			hi[i] = lo[i] + width*(best + 2);
+			lo[i] = newLo;
+		}
+	}
+	runs.close();
+
+	std::ofstream knee((outDir + "sizing_knee.csv").c_str());
+	knee << "variant,flows,bdp_packets,knee_packets,knee_bdp,throughput_kbps,utilization,delay_ms,power\n";
+	std::cout << "Buffer at the knee (BDP = " << bdp << " packets)" << std::endl;
+	std::cout << std::setw(14) << "variant" << std::setw(10) << "packets" << std::setw(8) << "BDP"
+		<< std::setw(12) << "util" << std::setw(12) << "delay(ms)" << std::endl;
+	for(uint32_t i = 0; i < v; ++i) {
+		SizingPoint best;
+		best.power = -1;
+		for(std::map<uint32_t, SizingPoint>::iterator it = tried[i].begin(); it != tried[i].end(); ++it) {
+			if(it->second.power > best.power)
+				best = it->second;
+		}
+		if(best.power < 0) {
+			std::cout << std::setw(14) << variants[i] << "  no successful run" << std::endl;
+			continue;
+		}
+		knee << variants[i] << "," << numSenders << "," << bdp << "," << best.buffer << "," << (double)best.buffer/bdp << ","
+			<< best.throughput << "," << best.throughput/bottleneckKbps << "," << best.delay << "," << best.power << "\n";
+		std::cout << std::setw(14) << variants[i] << std::setw(10) << best.buffer << std::setw(8) << std::setprecision(3) << (double)best.buffer/bdp
+			<< std::setw(12) << best.throughput/bottleneckKbps << std::setw(12) << best.delay << std::endl;
+	}
+	std::cout << "Find the knee points in " << outDir << "sizing_knee.csv" << std::endl;
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+#endif
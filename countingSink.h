@@ -0,0 +1,169 @@
+#ifndef COUNTING_SINK_H
+#define COUNTING_SINK_H
+
+#include <vector>
+#include <limits>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/applications-module.h"
+#include "measurementPhases.h"
+
+using namespace ns3;
+
+/*
+	TCP sink that only counts bytes.
+	PacketSink reads with RecvFrom, looks the sender up in an Address-keyed
+	map and fires its Rx trace with an Address copy for every packet. This
+	sink keeps one byte counter per accepted connection in a flat array and
+	is read by sampling (GetTotalRx, GetRx) instead of per-packet callbacks.
+	readSize: bytes taken per Recv call, 0 to drain the whole receive buffer
+	at once. The data itself is discarded.
+*/
+class CountingSink: public Application {
+	private:
+		virtual void StartApplication(void);
+		virtual void StopApplication(void);
+
+		void HandleAccept(Ptr<Socket> socket, const Address &from);
+		static void HandleRead(CountingSink *sink, uint32_t connection, Ptr<Socket> socket);
+
+		Ptr<Socket>                 mListenSocket;
+		std::vector<Ptr<Socket> >   mSockets;
+		std::vector<uint64_t>       mRx;
+		uint64_t                    mTotalRx;
+		uint16_t                    mPort;
+		uint32_t                    mReadSize;
+
+	public:
+		CountingSink();
+		virtual ~CountingSink();
+
+		void Setup(uint16_t port, uint32_t readSize);
+		uint64_t GetTotalRx() const;
+		uint32_t GetConnections() const;
+		uint64_t GetRx(uint32_t connection) const;
+		Ptr<Socket> GetListeningSocket() const;
+};
+
+CountingSink::CountingSink(): mListenSocket(0),
+		    mTotalRx(0),
+		    mPort(0),
+		    mReadSize(0) {
+}
+
+CountingSink::~CountingSink() {
+	mListenSocket = 0;
+}
+
+void CountingSink::Setup(uint16_t port, uint32_t readSize) {
+	mPort = port;
+	mReadSize = readSize ? readSize : std::numeric_limits<uint32_t>::max();
+}
+
+void CountingSink::StartApplication() {
+	if(!mListenSocket) {
+		mListenSocket = Socket::CreateSocket(GetNode(), TcpSocketFactory::GetTypeId());
+		mListenSocket->Bind(InetSocketAddress(Ipv4Address::GetAny(), mPort));
+		mListenSocket->Listen();
+	}
+	mListenSocket->SetAcceptCallback(MakeNullCallback<bool, Ptr<Socket>, const Address &>(),
+		MakeCallback(&CountingSink::HandleAccept, this));
+}
+
+void CountingSink::StopApplication() {
+	for(uint32_t i = 0; i < mSockets.size(); ++i) {
+		mSockets[i]->Close();
+		mSockets[i]->SetRecvCallback(MakeNullCallback<void, Ptr<Socket> >());
+	}
+	if(mListenSocket) {
+		mListenSocket->Close();
+		mListenSocket->SetAcceptCallback(MakeNullCallback<bool, Ptr<Socket>, const Address &>(),
+			MakeNullCallback<void, Ptr<Socket>, const Address &>());
+	}
+}
+
+//Connections are numbered in accept order
+void CountingSink::HandleAccept(Ptr<Socket> socket, const Address &from) {
+	uint32_t connection = mSockets.size();
+	mSockets.push_back(socket);
+	mRx.push_back(0);
+	socket->SetRecvCallback(MakeBoundCallback(&CountingSink::HandleRead, this, connection));
+}
+
+void CountingSink::HandleRead(CountingSink *sink, uint32_t connection, Ptr<Socket> socket) {
+	Ptr<Packet> packet;
+	while((packet = socket->Recv(sink->mReadSize, 0)) && packet->GetSize() > 0) {
+		sink->mRx[connection] += packet->GetSize();
+		sink->mTotalRx += packet->GetSize();
+	}
+}
+
+uint64_t CountingSink::GetTotalRx() const {
+	return mTotalRx;
+}
+
+uint32_t CountingSink::GetConnections() const {
+	return mSockets.size();
+}
+
+uint64_t CountingSink::GetRx(uint32_t connection) const {
+	return mRx[connection];
+}
+
+//Null until the application has started
+Ptr<Socket> CountingSink::GetListeningSocket() const {
+	return mListenSocket;
+}
+
+//Bytes received by a PacketSink or a CountingSink
+uint64_t sinkTotalRx(Ptr<Application> app) {
+	Ptr<CountingSink> counting = DynamicCast<CountingSink>(app);
+	if(counting)
+		return counting->GetTotalRx();
+	Ptr<PacketSink> sink = DynamicCast<PacketSink>(app);
+	if(sink)
+		return sink->GetTotalRx();
+	return 0;
+}
+
+//Listening socket of a PacketSink or a CountingSink, null before it starts
+Ptr<Socket> sinkListeningSocket(Ptr<Application> app) {
+	Ptr<CountingSink> counting = DynamicCast<CountingSink>(app);
+	if(counting)
+		return counting->GetListeningSocket();
+	Ptr<PacketSink> sink = DynamicCast<PacketSink>(app);
+	if(sink)
+		return sink->GetListeningSocket();
+	return 0;
+}
+
+/*
+	Goodput trace of a CountingSink, the sampled counterpart of the
+	ReceivedPacket callback: every interval until stopTime, the average rate
+	of the bytes received since startTime (Kbps), in the same two columns.
+	Samples outside the measure phase (measurementPhases.h) are not written.
+*/
+static void sampleSinkRate(Ptr<CountingSink> sink, Ptr<OutputStreamWrapper> stream, double startTime, uint64_t baseRx, double interval, double stopTime) {
+	double timeNow = Simulator::Now().GetSeconds();
+	if(measuring && timeNow > startTime)
+		*stream->GetStream() << timeNow-startTime << "\t" << (((sink->GetTotalRx() - baseRx) * 8.0) / 1024)/(timeNow-startTime) << std::endl;
+	if(timeNow + interval <= stopTime)
+		Simulator::Schedule(Seconds(interval), &sampleSinkRate, sink, stream, startTime, baseRx, interval, stopTime);
+}
+
+//Bytes already received at startTime (e.g. during a warm-up) are left out of the rate
+static void beginSinkSampling(Ptr<CountingSink> sink, Ptr<OutputStreamWrapper> stream, double startTime, double interval, double stopTime) {
+	Simulator::Schedule(Seconds(interval), &sampleSinkRate, sink, stream, startTime, sink->GetTotalRx(), interval, stopTime);
+}
+
+void startSinkSampling(Ptr<Node> node, Ptr<OutputStreamWrapper> stream, double startTime, double interval, double stopTime) {
+	Ptr<CountingSink> sink = DynamicCast<CountingSink>(node->GetApplication(0));
+	if(!sink) {
+		fprintf(stderr, "Node %u has no CountingSink\n", node->GetId());
+		exit(EXIT_FAILURE);
+	}
+	Simulator::Schedule(Seconds(startTime), &beginSinkSampling, sink, stream, startTime, interval, stopTime);
+}
+
+#endif
@@ -0,0 +1,383 @@
+#ifndef CROSS_TRAFFIC_H
+#define CROSS_TRAFFIC_H
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/applications-module.h"
+
+using namespace ns3;
+
+/*
+	Background UDP traffic on the bottleneck, one source per extra leaf pair
+	of the dumbbell (sender side on R1, a UDP PacketSink on R2):
+	CBR: constant bit rate at `rate` in packetSize-byte datagrams
+	Pareto: on/off source sending at `rate` while on, with Pareto on and off
+	  times of means onMean and offMean (s) and the given shape; heavy tailed
+	  for shape < 2, the usual self-similar aggregate model
+	Trace: replay of a packet trace (TraceReplay below)
+	None of it is in the FlowTable: the TCP flows' CSVs are unchanged and the
+	cross traffic is reported on its own (reportCrossTraffic).
+*/
+#define MAX_UDP_PAYLOAD 1472		// 1500-byte MTU less the IP and UDP headers, no fragmentation
+
+struct CrossTrafficParam
+{
+	std::string sources;		// one per extra leaf pair, e.g. "CBR,Pareto,Trace"; empty for none
+	std::string rate;			// CBR rate, Pareto rate while on
+	uint32_t packetSize;		// bytes of UDP payload, CBR and Pareto
+	double onMean;				// s, Pareto
+	double offMean;				// s, Pareto
+	double shape;				// Pareto shape, > 1
+	std::string traceFile;		// Trace
+	bool traceLoop;				// start the trace over at its end
+
+	CrossTrafficParam();
+};
+
+CrossTrafficParam::CrossTrafficParam() {
+	this -> sources = "";
+	this -> rate = "1Mbps";
+	this -> packetSize = 1000;
+	this -> onMean = 0.5;
+	this -> offMean = 0.5;
+	this -> shape = 1.5;
+	this -> traceFile = "";
+	this -> traceLoop = true;
+}
+
+std::vector<std::string> parseCrossSources(const CrossTrafficParam &params) {
+	std::vector<std::string> sources;
+	std::stringstream ss(params.sources);
+	std::string item;
+	while(std::getline(ss, item, ',')) {
+		if(item.compare("CBR") != 0 && item.compare("Pareto") != 0 && item.compare("Trace") != 0) {
+			fprintf(stderr, "Invalid cross-traffic source %s (CBR, Pareto or Trace)\n", item.c_str());
+			exit(EXIT_FAILURE);
+		}
+		if(item.compare("Trace") == 0 && params.traceFile.empty()) {
+			fprintf(stderr, "Trace cross traffic needs a trace file\n");
+			exit(EXIT_FAILURE);
+		}
+		sources.push_back(item);
+	}
+	if(params.packetSize == 0 || params.packetSize > MAX_UDP_PAYLOAD || params.shape <= 1 || params.onMean <= 0 || params.offMean < 0) {
+		fprintf(stderr, "Invalid cross-traffic parameters\n");
+		exit(EXIT_FAILURE);
+	}
+	return sources;
+}
+
+/*
+	Packet trace, one packet per line:
+		<bytes> <inter-arrival (s)>		e.g. "1200 0.000125"
+	Lines starting with # are skipped. The inter-arrival is the time since
+	the previous packet (since the start of the source for the first one);
+	bytes are UDP payload, capped at MAX_UDP_PAYLOAD.
+	The file is memory mapped and decoded a block of records at a time. As a
+	block is decoded, the next prefetchBytes of the file are requested with
+	MADV_WILLNEED, so the kernel reads them in while the simulation runs
+	through the block, and the pages already decoded are dropped with
+	MADV_DONTNEED. A million-packet trace thus costs one small block of
+	records in memory, and no page fault waits on the disk in the event loop.
+*/
+struct TraceRecord
+{
+	uint32_t size;
+	double gap;
+};
+
+class TraceReader
+{
+private:
+	int fd;
+	const char *data;
+	size_t length;
+	size_t offset;				// next byte to decode
+	size_t advised;				// end of the range asked for with MADV_WILLNEED
+	size_t released;			// start of the pages still mapped in
+	size_t pageSize;
+	size_t prefetchBytes;
+	bool loop;
+	uint64_t records;			// decoded so far, over every pass
+	std::vector<TraceRecord> block;
+	uint32_t blockRecords;
+	uint32_t blockPos;
+	std::string fileName;
+
+	TraceReader(const TraceReader &);
+	TraceReader &operator=(const TraceReader &);
+	bool fill();
+	void prefetch();
+	void release();
+
+public:
+	TraceReader();
+	~TraceReader();
+	void open(std::string fileName, bool loop, uint32_t blockRecords = 4096, size_t prefetchBytes = 1 << 20);
+	void close();
+	bool next(TraceRecord &record);
+	uint64_t getRecords() const;
+};
+
+TraceReader::TraceReader() {
+	this->fd = -1;
+	this->data = 0;
+	this->length = 0;
+	this->offset = 0;
+	this->advised = 0;
+	this->released = 0;
+	this->pageSize = sysconf(_SC_PAGESIZE);
+	this->prefetchBytes = 0;
+	this->loop = false;
+	this->records = 0;
+	this->blockRecords = 0;
+	this->blockPos = 0;
+}
+
+TraceReader::~TraceReader() {
+	this->close();
+}
+
+void TraceReader::open(std::string fileName, bool loop, uint32_t blockRecords, size_t prefetchBytes) {
+	this->close();
+	this->fileName = fileName;
+	this->loop = loop;
+	this->blockRecords = blockRecords ? blockRecords : 1;
+	this->prefetchBytes = prefetchBytes;
+	this->fd = ::open(fileName.c_str(), O_RDONLY);
+	if(this->fd < 0) {
+		fprintf(stderr, "Cannot open %s\n", fileName.c_str());
+		exit(EXIT_FAILURE);
+	}
+	struct stat st;
+	fstat(this->fd, &st);
+	this->length = st.st_size;
+	if(this->length > 0) {
+		void *mem = mmap(NULL, this->length, PROT_READ, MAP_PRIVATE, this->fd, 0);
+		if(mem == MAP_FAILED) {
+			perror("mmap");
+			exit(EXIT_FAILURE);
+		}
+		this->data = (const char *)mem;
+		madvise(mem, this->length, MADV_SEQUENTIAL);
+	}
+	//The first block is decoded before the simulation starts
+	this->fill();
+}
+
+void TraceReader::close() {
+	if(this->data)
+		munmap((void *)this->data, this->length);
+	if(this->fd >= 0)
+		::close(this->fd);
+	this->fd = -1;
+	this->data = 0;
+	this->length = 0;
+	this->offset = 0;
+	this->advised = 0;
+	this->released = 0;
+	this->records = 0;
+	this->block.clear();
+	this->blockPos = 0;
+}
+
+//The next prefetchBytes after the decode position, in whole pages
+void TraceReader::prefetch() {
+	size_t end = std::min(this->length, this->offset + this->prefetchBytes);
+	if(end <= this->advised)
+		return;
+	size_t from = std::max(this->advised, this->offset) & ~(this->pageSize - 1);
+	madvise((void *)(this->data + from), end - from, MADV_WILLNEED);
+	this->advised = end;
+}
+
+//Pages wholly behind the decode position are not read again in this pass
+void TraceReader::release() {
+	size_t upTo = this->offset & ~(this->pageSize - 1);
+	if(upTo <= this->released)
+		return;
+	madvise((void *)(this->data + this->released), upTo - this->released, MADV_DONTNEED);
+	this->released = upTo;
+}
+
+bool TraceReader::fill() {
+	this->block.clear();
+	this->blockPos = 0;
+	char line[64];
+	while(this->block.size() < this->blockRecords) {
+		if(this->offset >= this->length) {
+			//An empty trace would loop forever
+			if(!this->loop || this->records == 0)
+				break;
+			this->offset = 0;
+			this->advised = 0;
+			this->released = 0;
+		}
+		const char *start = this->data + this->offset;
+		const char *newline = (const char *)memchr(start, '\n', this->length - this->offset);
+		size_t n = (newline ? newline : this->data + this->length) - start;
+		this->offset += n + 1;
+		if(n == 0 || start[0] == '#' || start[0] == '\r')
+			continue;
+		if(n >= sizeof(line)) {
+			fprintf(stderr, "%s: line too long at byte %zu\n", this->fileName.c_str(), (size_t)(start - this->data));
+			exit(EXIT_FAILURE);
+		}
+		memcpy(line, start, n);
+		line[n] = '\0';
+		//Both fields must parse: a line with only a size is an error, not gap 0
+		char *sizeEnd, *gapEnd;
+		TraceRecord record;
+		unsigned long size = strtoul(line, &sizeEnd, 10);
+		record.gap = strtod(sizeEnd, &gapEnd);
+		if(sizeEnd == line || gapEnd == sizeEnd || size == 0 || record.gap < 0) {
+			fprintf(stderr, "%s: invalid record: %s\n", this->fileName.c_str(), line);
+			exit(EXIT_FAILURE);
+		}
+		record.size = std::min(size, (unsigned long)MAX_UDP_PAYLOAD);
+		this->block.push_back(record);
+		this->records++;
+	}
+	if(this->data) {
+		this->release();
+		this->prefetch();
+	}
+	return !this->block.empty();
+}
+
+bool TraceReader::next(TraceRecord &record) {
+	if(this->blockPos >= this->block.size() && !this->fill())
+		return false;
+	record = this->block[this->blockPos++];
+	return true;
+}
+
+uint64_t TraceReader::getRecords() const {
+	return this->records;
+}
+
+//UDP source replaying a TraceReader: one datagram per record, after its inter-arrival
+class TraceReplay: public Application {
+	private:
+		virtual void StartApplication(void);
+		virtual void StopApplication(void);
+
+		void ScheduleNext(void);
+		void SendPacket(uint32_t size);
+
+		Ptr<Socket>     mSocket;
+		Address         mPeer;
+		TraceReader     mTrace;
+		EventId         mSendEvent;
+		bool            mRunning;
+		uint64_t        mPacketsSent;
+
+	public:
+		TraceReplay();
+		virtual ~TraceReplay();
+
+		void Setup(Address address, std::string fileName, bool loop);
+		uint64_t GetPacketsSent() const;
+};
+
+TraceReplay::TraceReplay(): mSocket(0),
+		    mPeer(),
+		    mSendEvent(),
+		    mRunning(false),
+		    mPacketsSent(0) {
+}
+
+TraceReplay::~TraceReplay() {
+	mSocket = 0;
+}
+
+void TraceReplay::Setup(Address address, std::string fileName, bool loop) {
+	mPeer = address;
+	mTrace.open(fileName, loop);
+}
+
+void TraceReplay::StartApplication() {
+	mRunning = true;
+	mPacketsSent = 0;
+	mSocket = Socket::CreateSocket(GetNode(), UdpSocketFactory::GetTypeId());
+	mSocket->Bind();
+	mSocket->Connect(mPeer);
+	ScheduleNext();
+}
+
+void TraceReplay::StopApplication() {
+	mRunning = false;
+	if(mSendEvent.IsRunning()) {
+		Simulator::Cancel(mSendEvent);
+	}
+	if(mSocket) {
+		mSocket->Close();
+	}
+}
+
+void TraceReplay::ScheduleNext() {
+	TraceRecord record;
+	if(!mRunning || !mTrace.next(record))
+		return;
+	mSendEvent = Simulator::Schedule(Seconds(record.gap), &TraceReplay::SendPacket, this, record.size);
+}
+
+void TraceReplay::SendPacket(uint32_t size) {
+	mSocket->Send(Create<Packet>(size));
+	mPacketsSent++;
+	ScheduleNext();
+}
+
+uint64_t TraceReplay::GetPacketsSent() const {
+	return mPacketsSent;
+}
+
+//Source of type `source` on sender, towards sinkAddress
+ApplicationContainer installCrossSource(std::string source, Ptr<Node> sender, Address sinkAddress, const CrossTrafficParam &params,
+		double startTime, double stopTime) {
+	ApplicationContainer apps;
+	if(source.compare("Trace") == 0) {
+		Ptr<TraceReplay> app = CreateObject<TraceReplay>();
+		app->Setup(sinkAddress, params.traceFile, params.traceLoop);
+		sender->AddApplication(app);
+		apps.Add(app);
+	} else {
+		OnOffHelper onOff("ns3::UdpSocketFactory", sinkAddress);
+		onOff.SetConstantRate(DataRate(params.rate), params.packetSize);
+		if(source.compare("Pareto") == 0) {
+			//Pareto mean = scale*shape/(shape - 1)
+			std::ostringstream on, off;
+			on << "ns3::ParetoRandomVariable[Scale=" << params.onMean*(params.shape - 1)/params.shape << "|Shape=" << params.shape << "]";
+			off << "ns3::ParetoRandomVariable[Scale=" << params.offMean*(params.shape - 1)/params.shape << "|Shape=" << params.shape << "]";
+			onOff.SetAttribute("OnTime", StringValue(on.str()));
+			onOff.SetAttribute("OffTime", StringValue(off.str()));
+		}
+		apps = onOff.Install(sender);
+	}
+	apps.Start(Seconds(startTime));
+	apps.Stop(Seconds(stopTime));
+	return apps;
+}
+
+//Delivered rate of each cross-traffic sink over `duration` seconds
+void reportCrossTraffic(ApplicationContainer sinks, std::vector<std::string> sources, double duration, std::ostream &os) {
+	for(uint32_t i = 0; i < sinks.GetN(); ++i) {
+		Ptr<PacketSink> sink = DynamicCast<PacketSink>(sinks.Get(i));
+		os << "Cross traffic X" << i+1 << " (" << sources[i] << "): " << ((sink->GetTotalRx() * 8.0) / 1024)/duration << " Kbps delivered" << std::endl;
+	}
+}
+
+#endif
@@ -0,0 +1,191 @@
+#ifndef DROP_ACCOUNTING_H
+#define DROP_ACCOUNTING_H
+
+#include <vector>
+#include <ostream>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/traffic-control-module.h"
+#include "flowTable.h"
+#include "measurementPhases.h"
+
+using namespace ns3;
+
+/*
+	Where a packet was lost.
+	DROP_QUEUE_OVERFLOW: tail drop in the DropTailQueue of a net device
+	DROP_QUEUE_DISC: dropped by the queue disc (AQM decision or overflow)
+	DROP_RANDOM_ERROR: corrupted by the RateErrorModel of the receiving device
+*/
+enum DropCause
+{
+	DROP_QUEUE_OVERFLOW,
+	DROP_QUEUE_DISC,
+	DROP_RANDOM_ERROR,
+	DROP_CAUSES
+};
+
+/*
+	Exact per-flow drop counters.
+	The drop traces are connected once per device, not per flow; each drop
+	is attributed to its flow through the FlowTable, and so is every ECN
+	mark of the queue discs (data direction only; ACKs are not ECT, so
+	they are dropped, never marked). Retransmissions are
+	counted from the Tx trace of each sender socket: a segment whose
+	sequence number is below the highest one already sent is a retransmission.
+*/
+class DropAccounting
+{
+private:
+	const FlowTable *flows;
+	std::vector<uint64_t> dataDrops[DROP_CAUSES];
+	std::vector<uint64_t> ackDrops[DROP_CAUSES];
+	std::vector<uint64_t> marks;
+	std::vector<uint64_t> retransmissions;
+	std::vector<SequenceNumber32> highestTxSeq;
+	std::vector<bool> txStarted;
+	uint64_t unclassified[DROP_CAUSES];
+
+	void count(DropCause cause, bool found, uint32_t flow, bool reverse);
+	static void devicePacketDrop(DropAccounting *accounting, DropCause cause, Ptr<const Packet> p);
+	static void queueDiscDrop(DropAccounting *accounting, Ptr<const QueueDiscItem> item);
+	static void queueDiscMark(DropAccounting *accounting, Ptr<const QueueDiscItem> item, const char *reason);
+	static void socketTx(DropAccounting *accounting, uint32_t flow, Ptr<const Packet> p, const TcpHeader &header, Ptr<const TcpSocketBase> socket);
+
+public:
+	DropAccounting(const FlowTable *flows);
+	void installDevice(Ptr<NetDevice> device);
+	void installDevices(NetDeviceContainer devices);
+	void installSocket(Ptr<Socket> socket, uint32_t flow);
+
+	uint64_t getDataDrops(uint32_t flow, DropCause cause) const;
+	uint64_t getAckDrops(uint32_t flow, DropCause cause) const;
+	uint64_t getMarks(uint32_t flow) const;
+	uint64_t getRetransmissions(uint32_t flow) const;
+	void report(uint32_t flow, std::ostream &os) const;
+};
+
+//Flows must all be added to the table before the accounting is created
+DropAccounting::DropAccounting(const FlowTable *flows) {
+	this->flows = flows;
+	for(int c = 0; c < DROP_CAUSES; ++c) {
+		this->dataDrops[c].assign(flows->size(), 0);
+		this->ackDrops[c].assign(flows->size(), 0);
+		this->unclassified[c] = 0;
+	}
+	this->marks.assign(flows->size(), 0);
+	this->retransmissions.assign(flows->size(), 0);
+	this->highestTxSeq.assign(flows->size(), SequenceNumber32(0));
+	this->txStarted.assign(flows->size(), false);
+}
+
+/*
+	Must be called after IP addresses are assigned so that the root queue
+	disc of the device (explicit or the default pfifo_fast) is in place.
+*/
+void DropAccounting::installDevice(Ptr<NetDevice> device) {
+	Ptr<PointToPointNetDevice> p2pDevice = DynamicCast<PointToPointNetDevice>(device);
+	if(p2pDevice) {
+		p2pDevice->GetQueue()->TraceConnectWithoutContext("Drop", MakeBoundCallback(&DropAccounting::devicePacketDrop, this, DROP_QUEUE_OVERFLOW));
+	}
+	device->TraceConnectWithoutContext("PhyRxDrop", MakeBoundCallback(&DropAccounting::devicePacketDrop, this, DROP_RANDOM_ERROR));
+
+	Ptr<TrafficControlLayer> tc = device->GetNode()->GetObject<TrafficControlLayer>();
+	Ptr<QueueDisc> queueDisc = tc ? tc->GetRootQueueDiscOnDevice(device) : 0;
+	if(queueDisc) {
+		queueDisc->TraceConnectWithoutContext("Drop", MakeBoundCallback(&DropAccounting::queueDiscDrop, this));
+		queueDisc->TraceConnectWithoutContext("Mark", MakeBoundCallback(&DropAccounting::queueDiscMark, this));
+	}
+}
+
+void DropAccounting::installDevices(NetDeviceContainer devices) {
+	for(uint32_t i = 0; i < devices.GetN(); ++i) {
+		this->installDevice(devices.Get(i));
+	}
+}
+
+void DropAccounting::installSocket(Ptr<Socket> socket, uint32_t flow) {
+	socket->TraceConnectWithoutContext("Tx", MakeBoundCallback(&DropAccounting::socketTx, this, flow));
+}
+
+void DropAccounting::count(DropCause cause, bool found, uint32_t flow, bool reverse) {
+	if(!found)
+		this->unclassified[cause]++;
+	else if(reverse)
+		this->ackDrops[cause][flow]++;
+	else
+		this->dataDrops[cause][flow]++;
+}
+
+void DropAccounting::devicePacketDrop(DropAccounting *accounting, DropCause cause, Ptr<const Packet> p) {
+	if(!measuring)
+		return;
+	uint32_t flow = 0;
+	bool reverse = false;
+	bool found = classifyP2PPacket(*accounting->flows, p, flow, reverse);
+	accounting->count(cause, found, flow, reverse);
+}
+
+void DropAccounting::queueDiscDrop(DropAccounting *accounting, Ptr<const QueueDiscItem> item) {
+	if(!measuring)
+		return;
+	uint32_t flow = 0;
+	bool reverse = false;
+	bool found = classifyQueueDiscItem(*accounting->flows, item, flow, reverse);
+	accounting->count(DROP_QUEUE_DISC, found, flow, reverse);
+}
+
+void DropAccounting::queueDiscMark(DropAccounting *accounting, Ptr<const QueueDiscItem> item, const char *reason) {
+	if(!measuring)
+		return;
+	uint32_t flow = 0;
+	bool reverse = false;
+	if(classifyQueueDiscItem(*accounting->flows, item, flow, reverse) && !reverse)
+		accounting->marks[flow]++;
+}
+
+void DropAccounting::socketTx(DropAccounting *accounting, uint32_t flow, Ptr<const Packet> p, const TcpHeader &header, Ptr<const TcpSocketBase> socket) {
+	if(p->GetSize() == 0)
+		return;
+	SequenceNumber32 seq = header.GetSequenceNumber();
+	if(!accounting->txStarted[flow]) {
+		accounting->txStarted[flow] = true;
+		accounting->highestTxSeq[flow] = seq;
+	} else if(seq < accounting->highestTxSeq[flow]) {
+		//The highest sequence is tracked in every phase, only the count is gated
+		if(measuring)
+			accounting->retransmissions[flow]++;
+		return;
+	}
+	accounting->highestTxSeq[flow] = seq + p->GetSize();
+}
+
+uint64_t DropAccounting::getDataDrops(uint32_t flow, DropCause cause) const {
+	return this->dataDrops[cause][flow];
+}
+
+uint64_t DropAccounting::getAckDrops(uint32_t flow, DropCause cause) const {
+	return this->ackDrops[cause][flow];
+}
+
+uint64_t DropAccounting::getMarks(uint32_t flow) const {
+	return this->marks[flow];
+}
+
+uint64_t DropAccounting::getRetransmissions(uint32_t flow) const {
+	return this->retransmissions[flow];
+}
+
+void DropAccounting::report(uint32_t flow, std::ostream &os) const {
+	os << "Packet Lost due to buffer overflow: " << this->dataDrops[DROP_QUEUE_OVERFLOW][flow] << "\n";
+	os << "Packet Lost in queue disc: " << this->dataDrops[DROP_QUEUE_DISC][flow] << "\n";
+	os << "Packet Lost due to random error: " << this->dataDrops[DROP_RANDOM_ERROR][flow] << "\n";
+	os << "ACKs Lost (overflow/queue disc/random error): " << this->ackDrops[DROP_QUEUE_OVERFLOW][flow]
+		<< "/" << this->ackDrops[DROP_QUEUE_DISC][flow] << "/" << this->ackDrops[DROP_RANDOM_ERROR][flow] << "\n";
+	os << "Packets ECN-marked instead of dropped: " << this->marks[flow] << "\n";
+	os << "Retransmitted segments: " << this->retransmissions[flow] << "\n";
+}
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef ECN_MARKING_H
+#define ECN_MARKING_H
+
+#include <string>
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/traffic-control-module.h"
+
+using namespace ns3;
+
+/*
+	SACK, ECN and DCTCP.
+	Sockets: the options are set as TcpSocketBase defaults rather than on
+	each sender socket, so that the sockets a sink forks from its listening
+	socket negotiate the same way.
+	Bottleneck: with ECN on, the AQM marks ECT packets instead of dropping
+	them (UseEcn of RED, CoDel, FqCoDel and Pie); non-ECT packets and
+	overflows are still dropped. DropTail and the bare device queue cannot
+	mark, so ECN needs one of the AQMs.
+	DCTCP (Alizadeh et al., SIGCOMM 2010) implies ECN; every flow runs
+	TcpDctcp, on the receiver too for its per-packet CE echo (uniFlow sets
+	it on both nodes), and the bottleneck is RED turned into the step marker DCTCP
+	expects: instantaneous queue (QW = 1), MinTh = MaxTh = markThreshold
+	packets, not gentle, and marking instead of a hard drop above MaxTh.
+*/
+struct EcnParam
+{
+	bool sack;
+	bool ecn;
+	bool dctcp;
+	double markThreshold;		// packets, DCTCP's K
+
+	EcnParam();
+};
+
+EcnParam::EcnParam() {
+	this -> sack = true;		// the ns-3 default
+	this -> ecn = false;
+	this -> dctcp = false;
+	this -> markThreshold = 20;
+}
+
+/*
+	Checks the options against the bottleneck queue disc and returns the
+	queue disc to use: DCTCP switches it to RED.
+*/
+std::string checkEcnParam(EcnParam &params, std::string queueDisc) {
+	if(params.dctcp) {
+		params.ecn = true;
+		if(queueDisc.compare("RED") != 0) {
+			std::cout << "DCTCP: bottleneck queue disc " << queueDisc << " replaced by RED step marking" << std::endl;
+			queueDisc = "RED";
+		}
+	}
+	if(params.ecn && (queueDisc.compare("None") == 0 || queueDisc.compare("DropTail") == 0)) {
+		fprintf(stderr, "ECN needs a marking queue disc on the bottleneck: RED, CoDel, FqCoDel or Pie\n");
+		exit(EXIT_FAILURE);
+	}
+	if(params.markThreshold <= 0) {
+		fprintf(stderr, "Invalid marking threshold\n");
+		exit(EXIT_FAILURE);
+	}
+	return queueDisc;
+}
+
+//Socket defaults, to be set before the first socket (or sink) is created
+void setTcpOptions(const EcnParam &params) {
+	Config::SetDefault("ns3::TcpSocketBase::Sack", BooleanValue(params.sack));
+	Config::SetDefault("ns3::TcpSocketBase::UseEcn", EnumValue(params.ecn ? TcpSocketState::On : TcpSocketState::Off));
+}
+
+//Queue disc defaults, to be set before installBottleneckQueueDisc
+void setEcnMarking(const EcnParam &params) {
+	if(!params.ecn)
+		return;
+	Config::SetDefault("ns3::RedQueueDisc::UseEcn", BooleanValue(true));
+	Config::SetDefault("ns3::CoDelQueueDisc::UseEcn", BooleanValue(true));
+	Config::SetDefault("ns3::FqCoDelQueueDisc::UseEcn", BooleanValue(true));
+	Config::SetDefault("ns3::PieQueueDisc::UseEcn", BooleanValue(true));
+	if(params.dctcp) {
+		Config::SetDefault("ns3::RedQueueDisc::QW", DoubleValue(1));
+		Config::SetDefault("ns3::RedQueueDisc::MinTh", DoubleValue(params.markThreshold));
+		Config::SetDefault("ns3::RedQueueDisc::MaxTh", DoubleValue(params.markThreshold));
+		Config::SetDefault("ns3::RedQueueDisc::Gentle", BooleanValue(false));
+		Config::SetDefault("ns3::RedQueueDisc::UseHardDrop", BooleanValue(false));
+	}
+}
+
+#endif
@@ -0,0 +1,136 @@
+#ifndef EMULATION_H
+#define EMULATION_H
+
+#include <string>
+#include <chrono>
+#include <iostream>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/csma-module.h"
+#include "ns3/tap-bridge-module.h"
+
+using namespace ns3;
+
+/*
+	Real-time emulation.
+	The simulator is switched to ns3::RealtimeSimulatorImpl, which holds every
+	event back until the wall clock reaches its timestamp, and checksums are
+	turned on since real stacks check them. Must be called before anything
+	touches the Simulator (i.e. before creating nodes).
+	hardLimit: abort the run once the simulator is more than `limit` seconds
+	behind the wall clock instead of silently falling behind.
+*/
+void enableRealtimeSimulator(bool hardLimit, double limit) {
+	GlobalValue::Bind("SimulatorImplementationType", StringValue("ns3::RealtimeSimulatorImpl"));
+	GlobalValue::Bind("ChecksumEnabled", BooleanValue(true));
+	Config::SetDefault("ns3::RealtimeSimulatorImpl::SynchronizationMode", StringValue(hardLimit ? "HardLimit" : "BestEffort"));
+	Config::SetDefault("ns3::RealtimeSimulatorImpl::HardLimit", TimeValue(Seconds(limit)));
+}
+
+/*
+	Tap endpoint behind a dumbbell host.
+	A ghost node is hung off `host` by a CSMA segment and its CSMA device is
+	bridged to the Linux tap device `tapName`. Traffic of the Linux side enters
+	the topology at `host` and is routed through R1-R2 like any simulated flow.
+	tapMode:
+		ConfigureLocal: ns-3 creates the tap device and gives it the ghost
+			node's address (needs root).
+		UseLocal: the tap device already exists and is up
+			(`ip tuntap add mode tap tap-left0`); ns-3 only opens it.
+		UseBridge: as UseLocal, but the tap is enslaved to a Linux bridge
+			together with a veth whose peer lives in a network namespace,
+			so each application gets its own stack. The namespace side
+			takes the ghost node's address.
+	On the Linux side, route the far subnet (10.1.0.0/16 or 10.2.0.0/16)
+	through the host's CSMA address, which is printed here.
+*/
+Ptr<Node> attachTapEndpoint(Ptr<Node> host, std::string tapName, std::string tapMode, Ipv4AddressHelper &address) {
+	Ptr<Node> ghost = CreateObject<Node>();
+	InternetStackHelper stack;
+	stack.Install(ghost);
+
+	CsmaHelper csma;
+	csma.SetChannelAttribute("DataRate", StringValue("1Gbps"));
+	csma.SetChannelAttribute("Delay", TimeValue(MicroSeconds(1)));
+	NodeContainer segment(ghost, host);
+	NetDeviceContainer devices = csma.Install(segment);
+	Ipv4InterfaceContainer ifcs = address.Assign(devices);
+	address.NewNetwork();
+
+	TapBridgeHelper tapBridge;
+	tapBridge.SetAttribute("Mode", StringValue(tapMode));
+	tapBridge.SetAttribute("DeviceName", StringValue(tapName));
+	tapBridge.Install(ghost, devices.Get(0));
+
+	std::cout << "Tap " << tapName << ": " << ifcs.GetAddress(0) << " via host " << ifcs.GetAddress(1) << std::endl;
+	return ghost;
+}
+
+/*
+	How far the realtime simulator runs behind the wall clock.
+	One event per interval measures (wall clock - simulation time) since
+	the monitor started; any sample above `deadline` is a missed deadline,
+	i.e. the host could not keep up with the emulated network at that point.
+*/
+class RealtimeLagMonitor
+{
+private:
+	std::chrono::steady_clock::time_point wallStart;
+	double simStart;
+	double interval;
+	double deadline;
+	double stopTime;
+	double maxLag, sumLag;
+	uint64_t samples, missedDeadlines;
+
+	void sample();
+
+public:
+	RealtimeLagMonitor();
+	void start(double interval, double deadline, double stopTime);
+	void report(std::ostream &os);
+};
+
+RealtimeLagMonitor::RealtimeLagMonitor() {
+	this->simStart = 0;
+	this->interval = 0;
+	this->deadline = 0;
+	this->stopTime = 0;
+	this->maxLag = this->sumLag = 0;
+	this->samples = this->missedDeadlines = 0;
+}
+
+//To be called right before Simulator::Run()
+void RealtimeLagMonitor::start(double interval, double deadline, double stopTime) {
+	this->interval = interval;
+	this->deadline = deadline;
+	this->stopTime = stopTime;
+	this->wallStart = std::chrono::steady_clock::now();
+	this->simStart = Simulator::Now().GetSeconds();
+	Simulator::Schedule(Seconds(interval), &RealtimeLagMonitor::sample, this);
+}
+
+void RealtimeLagMonitor::sample() {
+	double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - this->wallStart).count();
+	double sim = Simulator::Now().GetSeconds() - this->simStart;
+	double lag = wall - sim;
+	this->samples++;
+	this->sumLag += lag;
+	if(lag > this->maxLag)
+		this->maxLag = lag;
+	if(lag > this->deadline) {
+		this->missedDeadlines++;
+		std::cerr << "Realtime lag " << lag*1000 << " ms at " << Simulator::Now().GetSeconds() << " s" << std::endl;
+	}
+	if(Simulator::Now().GetSeconds() + this->interval <= this->stopTime)
+		Simulator::Schedule(Seconds(this->interval), &RealtimeLagMonitor::sample, this);
+}
+
+void RealtimeLagMonitor::report(std::ostream &os) {
+	os << "Realtime lag (ms): mean " << (this->samples ? this->sumLag/this->samples*1000 : 0)
+		<< ", max " << this->maxLag*1000 << "\n";
+	os << "Missed deadlines: " << this->missedDeadlines << " of " << this->samples << " samples" << std::endl;
+}
+
+#endif
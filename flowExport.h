@@ -0,0 +1,219 @@
+#ifndef FLOW_EXPORT_H
+#define FLOW_EXPORT_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdio>
+#include <cstdlib>
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/flow-monitor-module.h"
+#include "flowTable.h"
+#include "dropAccounting.h"
+#include "aggregation.h"
+#include "tcpModel.h"
+
+using namespace ns3;
+
+/*
+	Per-flow results of one run. Rates are in Kbps (1 Kb = 1024 bits, as in
+	the .tp/.gp traces), delays in ms.
+	throughput: IP bytes received over [first Tx, last Rx]
+	goodput: application bytes delivered to the sink over the same interval
+*/
+struct FlowResult
+{
+	bool found;
+	FlowId flowId;
+	uint64_t txPackets, rxPackets, lostPackets;
+	uint64_t txBytes, rxBytes, appBytes;
+	double duration;
+	double throughput, goodput;
+	double lossRate;
+	double meanDelay, meanJitter;
+};
+
+/*
+	Walks FlowMonitor::GetFlowStats() once and files every FlowMonitor flow
+	under its FlowTable entry through the address index, so the cost is
+	linear in the number of flows whatever their addresses are.
+	FlowMonitor flows going the reverse way (ACKs) are skipped.
+*/
+class FlowExporter
+{
+private:
+	const FlowTable *flows;
+	const DropAccounting *drops;
+	std::vector<FlowResult> results;
+
+public:
+	FlowExporter(const FlowTable *flows);
+	void collect(Ptr<FlowMonitor> flowmon, Ptr<Ipv4FlowClassifier> classifier);
+	void collect(const FlowMonitor::FlowStatsContainer &stats, Ptr<Ipv4FlowClassifier> classifier);
+	void setAppBytes(uint32_t flow, uint64_t bytes);
+	void attachDrops(const DropAccounting *drops);
+	const FlowResult &get(uint32_t flow) const;
+	void writeCsv(std::string fileName) const;
+	bool publish(std::string aggregateName, std::string point) const;
+	uint32_t checkModels(std::string fileName, const std::vector<double> &mss, const std::vector<double> &wmax,
+		double baseRtt, double rto, double tolerance, std::ostream &os) const;
+};
+
+FlowExporter::FlowExporter(const FlowTable *flows) {
+	this->flows = flows;
+	this->drops = 0;
+	FlowResult empty = FlowResult();
+	empty.found = false;
+	this->results.assign(flows->size(), empty);
+}
+
+void FlowExporter::collect(Ptr<FlowMonitor> flowmon, Ptr<Ipv4FlowClassifier> classifier) {
+	this->collect(flowmon->GetFlowStats(), classifier);
+}
+
+//Stats kept outside FlowMonitor, e.g. the running totals of FlowSnapshots
+void FlowExporter::collect(const FlowMonitor::FlowStatsContainer &stats, Ptr<Ipv4FlowClassifier> classifier) {
+	for (FlowMonitor::FlowStatsContainerCI i = stats.begin(); i != stats.end(); ++i) {
+		Ipv4FlowClassifier::FiveTuple t = classifier->FindFlow(i->first);
+		uint32_t flow;
+		bool reverse;
+		if(!this->flows->lookup(t.sourceAddress.Get(), t.destinationAddress.Get(), flow, reverse) || reverse)
+			continue;
+
+		const FlowMonitor::FlowStats &st = i->second;
+		FlowResult &r = this->results[flow];
+		r.found = true;
+		r.flowId = i->first;
+		r.txPackets = st.txPackets;
+		r.rxPackets = st.rxPackets;
+		r.lostPackets = st.lostPackets;
+		r.txBytes = st.txBytes;
+		r.rxBytes = st.rxBytes;
+		r.duration = st.timeLastRxPacket.GetSeconds() - st.timeFirstTxPacket.GetSeconds();
+		r.throughput = r.duration > 0 ? ((st.rxBytes * 8.0) / 1024)/r.duration : 0;
+		r.goodput = r.duration > 0 ? ((r.appBytes * 8.0) / 1024)/r.duration : 0;
+		r.lossRate = st.txPackets ? (double)st.lostPackets/st.txPackets : 0;
+		r.meanDelay = st.rxPackets ? st.delaySum.GetSeconds()*1000/st.rxPackets : 0;
+		r.meanJitter = st.rxPackets > 1 ? st.jitterSum.GetSeconds()*1000/(st.rxPackets-1) : 0;
+	}
+}
+
+//Bytes received by the application (e.g. PacketSink::GetTotalRx), for goodput
+void FlowExporter::setAppBytes(uint32_t flow, uint64_t bytes) {
+	FlowResult &r = this->results[flow];
+	r.appBytes = bytes;
+	r.goodput = r.duration > 0 ? ((bytes * 8.0) / 1024)/r.duration : 0;
+}
+
+//Adds the per-cause drop counters as extra columns
+void FlowExporter::attachDrops(const DropAccounting *drops) {
+	this->drops = drops;
+}
+
+const FlowResult &FlowExporter::get(uint32_t flow) const {
+	return this->results[flow];
+}
+
+/*
+	One CSV per run, one row per flow. Flows that never showed up in the
+	FlowMonitor stats are still written, with found = 0.
+*/
+void FlowExporter::writeCsv(std::string fileName) const {
+	std::ofstream out(fileName.c_str());
+	if(!out) {
+		fprintf(stderr, "Cannot open %s\n", fileName.c_str());
+		exit(EXIT_FAILURE);
+	}
+	out << "flow,label,source,destination,found,flowId,txPackets,rxPackets,lostPackets,txBytes,rxBytes,appBytes,"
+		<< "duration_s,throughput_kbps,goodput_kbps,loss_rate,delay_ms,jitter_ms";
+	if(this->drops)
+		out << ",drop_overflow,drop_queue_disc,drop_error,retransmissions,ecn_marks";
+	out << "\n";
+
+	for(uint32_t flow = 0; flow < this->flows->size(); ++flow) {
+		const FlowEntry &e = this->flows->get(flow);
+		const FlowResult &r = this->results[flow];
+		out << flow << "," << e.label << "," << e.source << "," << e.destination << "," << r.found << ","
+			<< (r.found ? r.flowId : 0) << "," << r.txPackets << "," << r.rxPackets << "," << r.lostPackets << ","
+			<< r.txBytes << "," << r.rxBytes << "," << r.appBytes << ","
+			<< r.duration << "," << r.throughput << "," << r.goodput << "," << r.lossRate << ","
+			<< r.meanDelay << "," << r.meanJitter;
+		if(this->drops) {
+			out << "," << this->drops->getDataDrops(flow, DROP_QUEUE_OVERFLOW)
+				<< "," << this->drops->getDataDrops(flow, DROP_QUEUE_DISC)
+				<< "," << this->drops->getDataDrops(flow, DROP_RANDOM_ERROR)
+				<< "," << this->drops->getRetransmissions(flow)
+				<< "," << this->drops->getMarks(flow);
+		}
+		out << "\n";
+	}
+}
+
+/*
+	Adds the flows of this run to the live table of the sweep that started
+	it (--aggregate, see aggregation.h), in the order of aggMetricNames.
+*/
+bool FlowExporter::publish(std::string aggregateName, std::string point) const {
+	AggregatorClient client;
+	if(!client.open(aggregateName))
+		return false;
+	for(uint32_t flow = 0; flow < this->flows->size(); ++flow) {
+		const FlowResult &r = this->results[flow];
+		if(!r.found)
+			continue;
+		double values[AGG_METRICS] = {r.throughput, r.goodput, r.lossRate, r.meanDelay, r.meanJitter};
+		client.addFlow(point, this->flows->get(flow).label, values);
+	}
+	return true;
+}
+
+//Segments acked per ACK: the receivers' DelAckCount (2 unless a run sets ns3::TcpSocket::DelAckCount)
+double ackedPerAck() {
+	TypeId::AttributeInformation info;
+	TypeId::LookupByName("ns3::TcpSocket").LookupAttributeByName("DelAckCount", &info);
+	Ptr<const UintegerValue> count = DynamicCast<const UintegerValue>(info.initialValue);
+	return count && count->Get() > 0 ? count->Get() : 1;
+}
+
+/*
+	Mathis and Padhye predictions for every flow of this run (tcpModel.h),
+	written to fileName with the ratio of the simulated throughput to each.
+	The loss rate counts ECN marks as losses; the RTT is the flow's mean
+	one-way delay (queueing included) plus the one-way base delay of the
+	ACK path, baseRtt/2. Flows departing from either model by more than
+	`tolerance` are listed on os; returns their number.
+*/
+uint32_t FlowExporter::checkModels(std::string fileName, const std::vector<double> &mss, const std::vector<double> &wmax,
+		double baseRtt, double rto, double tolerance, std::ostream &os) const {
+	ModelBatch batch;
+	std::vector<uint32_t> index;
+	for(uint32_t flow = 0; flow < this->flows->size(); ++flow) {
+		const FlowResult &r = this->results[flow];
+		if(!r.found || r.txPackets == 0)
+			continue;
+		double marks = this->drops ? this->drops->getMarks(flow) : 0;
+		batch.add(r.lossRate + marks/r.txPackets, r.meanDelay/1000 + baseRtt/2, mss[flow], wmax[flow], rto, r.throughput);
+		index.push_back(flow);
+	}
+	computeModels(batch, ackedPerAck());
+
+	std::ofstream out(fileName.c_str());
+	out << "flow,label,loss_rate,rtt_ms,throughput_kbps,mathis_kbps,padhye_kbps,mathis_ratio,padhye_ratio,departs\n";
+	uint32_t departing = 0;
+	for(uint32_t i = 0; i < batch.size(); ++i) {
+		uint32_t flow = index[i];
+		bool departs = modelDeparts(batch.simulated[i], batch.mathis[i], tolerance) || modelDeparts(batch.simulated[i], batch.padhye[i], tolerance);
+		out << flow << "," << this->flows->get(flow).label << "," << batch.lossRate[i] << "," << batch.rtt[i]*1000 << ","
+			<< batch.simulated[i] << "," << batch.mathis[i] << "," << batch.padhye[i] << ","
+			<< modelRatio(batch.simulated[i], batch.mathis[i]) << "," << modelRatio(batch.simulated[i], batch.padhye[i]) << "," << departs << "\n";
+		if(departs) {
+			departing++;
+			os << "Model check: " << this->flows->get(flow).label << " at " << batch.simulated[i] << " Kbps, Mathis "
+				<< batch.mathis[i] << ", Padhye " << batch.padhye[i] << " (loss " << batch.lossRate[i] << ")" << std::endl;
+		}
+	}
+	return departing;
+}
+
+#endif
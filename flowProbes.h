@@ -0,0 +1,93 @@
+#ifndef FLOW_PROBES_H
+#define FLOW_PROBES_H
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/flow-monitor-module.h"
+
+using namespace ns3;
+
+/*
+	Where FlowMonitor probes go and when they count.
+	mode "All": a probe on every node (FlowMonitorHelper::InstallAll).
+	mode "Bottleneck": probes on the two routers and on the chosen host pairs
+	only. A FlowMonitor probe tags a packet when it leaves its source node and
+	ignores untagged packets elsewhere, so only flows whose sender and receiver
+	are both chosen are measured; the routers then give the per-hop view of
+	the bottleneck for those flows.
+	startTime/stopTime: accounting window, e.g. to leave out the warm-up.
+	maxPerHopDelay: packets not seen for this long are declared lost and
+	forgotten, which bounds the tracked-packet map.
+	binWidth: width of the delay/jitter histograms (s); coarser bins keep the
+	per-flow histograms short.
+*/
+struct FlowProbeConfig
+{
+	std::string mode;
+	std::vector<uint32_t> hosts;
+	double startTime;
+	double stopTime;
+	double maxPerHopDelay;
+	double binWidth;
+
+	FlowProbeConfig();
+};
+
+FlowProbeConfig::FlowProbeConfig() {
+	this -> mode = "All";
+	this -> startTime = 0;
+	this -> stopTime = -1;		// until the end of the simulation
+	this -> maxPerHopDelay = 10;
+	this -> binWidth = 0.001;
+}
+
+//"0,2,5" -> {0, 2, 5}
+std::vector<uint32_t> parseIndexList(std::string list) {
+	std::vector<uint32_t> indices;
+	std::stringstream ss(list);
+	std::string item;
+	while(std::getline(ss, item, ',')) {
+		if(!item.empty())
+			indices.push_back(std::stoul(item));
+	}
+	return indices;
+}
+
+Ptr<FlowMonitor> installFlowMonitor(FlowMonitorHelper &flowmonHelper, FlowProbeConfig config, NodeContainer routers, NodeContainer senders, NodeContainer receivers) {
+	flowmonHelper.SetMonitorAttribute("StartTime", TimeValue(Seconds(config.startTime)));
+	flowmonHelper.SetMonitorAttribute("MaxPerHopDelay", TimeValue(Seconds(config.maxPerHopDelay)));
+	flowmonHelper.SetMonitorAttribute("DelayBinWidth", DoubleValue(config.binWidth));
+	flowmonHelper.SetMonitorAttribute("JitterBinWidth", DoubleValue(config.binWidth));
+
+	Ptr<FlowMonitor> flowmon;
+	if(config.mode.compare("All") == 0) {
+		flowmon = flowmonHelper.InstallAll();
+	} else if(config.mode.compare("Bottleneck") == 0) {
+		NodeContainer probed;
+		probed.Add(routers);
+		for(uint32_t i = 0; i < config.hosts.size(); ++i) {
+			if(config.hosts[i] >= senders.GetN() || config.hosts[i] >= receivers.GetN()) {
+				fprintf(stderr, "Invalid FlowMonitor host %u\n", config.hosts[i]);
+				exit(EXIT_FAILURE);
+			}
+			probed.Add(senders.Get(config.hosts[i]));
+			probed.Add(receivers.Get(config.hosts[i]));
+		}
+		std::cout << "FlowMonitor probes on " << probed.GetN() << " nodes" << std::endl;
+		flowmon = flowmonHelper.Install(probed);
+	} else {
+		fprintf(stderr, "Invalid FlowMonitor mode\n");
+		exit(EXIT_FAILURE);
+	}
+
+	if(config.stopTime >= 0)
+		flowmon->Stop(Seconds(config.stopTime));
+	return flowmon;
+}
+
+#endif
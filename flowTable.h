@@ -0,0 +1,106 @@
+#ifndef FLOW_TABLE_H
+#define FLOW_TABLE_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/traffic-control-module.h"
+
+using namespace ns3;
+
+/*
+	Flows of one run, indexed by their (source, destination) IPv4 pair.
+	Every host pair carries at most one TCP connection in these scenarios,
+	so the address pair identifies the flow. Packets going the other way
+	(i.e. ACKs) map to the same flow with `reverse` set.
+*/
+struct FlowEntry
+{
+	std::string label;
+	Ipv4Address source;
+	Ipv4Address destination;
+};
+
+class FlowTable
+{
+private:
+	std::vector<FlowEntry> flows;
+	std::unordered_map<uint64_t, uint32_t> index;		// key -> flow*2 + reverse
+
+	static uint64_t key(uint32_t source, uint32_t destination);
+
+public:
+	uint32_t add(std::string label, Ipv4Address source, Ipv4Address destination);
+	bool lookup(uint32_t source, uint32_t destination, uint32_t &flow, bool &reverse) const;
+	uint32_t size() const;
+	const FlowEntry &get(uint32_t flow) const;
+};
+
+uint64_t FlowTable::key(uint32_t source, uint32_t destination) {
+	return ((uint64_t)source << 32) | destination;
+}
+
+uint32_t FlowTable::add(std::string label, Ipv4Address source, Ipv4Address destination) {
+	uint32_t flow = this->flows.size();
+	FlowEntry entry;
+	entry.label = label;
+	entry.source = source;
+	entry.destination = destination;
+	this->flows.push_back(entry);
+	this->index[key(source.Get(), destination.Get())] = flow*2;
+	this->index[key(destination.Get(), source.Get())] = flow*2 + 1;
+	return flow;
+}
+
+bool FlowTable::lookup(uint32_t source, uint32_t destination, uint32_t &flow, bool &reverse) const {
+	std::unordered_map<uint64_t, uint32_t>::const_iterator it = this->index.find(key(source, destination));
+	if(it == this->index.end())
+		return false;
+	flow = it->second/2;
+	reverse = it->second%2;
+	return true;
+}
+
+uint32_t FlowTable::size() const {
+	return this->flows.size();
+}
+
+const FlowEntry &FlowTable::get(uint32_t flow) const {
+	return this->flows[flow];
+}
+
+/*
+	Classify a packet as seen on a PointToPointNetDevice (device queue,
+	PhyRxDrop, ...), where it still carries the 2 byte PPP header.
+	Only the address bytes of the IPv4 header are copied out; no header is
+	deserialized and the packet is not copied.
+		bytes 0-1	PPP protocol (0x0021 for IPv4)
+		byte 2		IPv4 version/IHL
+		bytes 14-17	IPv4 source
+		bytes 18-21	IPv4 destination
+*/
+bool classifyP2PPacket(const FlowTable &flows, Ptr<const Packet> p, uint32_t &flow, bool &reverse) {
+	uint8_t buf[22];
+	if(p->CopyData(buf, sizeof(buf)) < sizeof(buf))
+		return false;
+	if(buf[0] != 0x00 || buf[1] != 0x21 || (buf[2] >> 4) != 4)
+		return false;
+	uint32_t source = ((uint32_t)buf[14] << 24) | ((uint32_t)buf[15] << 16) | ((uint32_t)buf[16] << 8) | buf[17];
+	uint32_t destination = ((uint32_t)buf[18] << 24) | ((uint32_t)buf[19] << 16) | ((uint32_t)buf[20] << 8) | buf[21];
+	return flows.lookup(source, destination, flow, reverse);
+}
+
+//Queue disc items keep the IPv4 header aside from the packet
+bool classifyQueueDiscItem(const FlowTable &flows, Ptr<const QueueDiscItem> item, uint32_t &flow, bool &reverse) {
+	Ptr<const Ipv4QueueDiscItem> ipItem = DynamicCast<const Ipv4QueueDiscItem>(item);
+	if(!ipItem)
+		return false;
+	const Ipv4Header &header = ipItem->GetHeader();
+	return flows.lookup(header.GetSource().Get(), header.GetDestination().Get(), flow, reverse);
+}
+
+#endif
@@ -0,0 +1,373 @@
+#ifndef GORILLA_H
+#define GORILLA_H
+
+#include <string>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+
+/*
+	Compressed (time, value) series, after Gorilla (Pelkonen et al., VLDB 2015).
+	Times are kept as integer ticks of `resolution` seconds and stored as
+	delta-of-delta in a variable-length code:
+		'0'                        same spacing as before
+		'10'   + 7 bits            -64 <= dod < 64
+		'110'  + 12 bits           -2048 <= dod < 2048
+		'1110' + 20 bits           -524288 <= dod < 524288
+		'1111' + 64 bits           anything else
+	Values are doubles XORed with the previous value:
+		'0'                        same value
+		'10' + meaningful bits     inside the previous leading/trailing-zero window
+		'11' + 5 bits leading zeros + 6 bits length + meaningful bits
+	mantissaBits < 52 rounds every value to that many mantissa bits before
+	encoding (lossy): the low bits then XOR to zero, which is where most of
+	the saving on measured rates comes from. 24 bits keep 7 significant
+	digits, more than the text traces print.
+	deadband > 0 makes the series sparse: a point is only stored when its
+	value differs from the last stored one by more than deadband (relative),
+	and the last point is always kept. The cumulative-rate traces (.gp,
+	.tp) settle quickly, so most of their points fall inside the band.
+	File layout: "GRLA", version (u32), resolution (f64), number of points
+	(u64, patched in on close), then the bit stream, MSB first.
+	No ns-3 dependency, so the decoder and gorillaCat build on their own.
+*/
+#define GORILLA_MAGIC "GRLA"
+#define GORILLA_VERSION 1
+#define GORILLA_COUNT_OFFSET 16
+
+class GorillaWriter
+{
+private:
+	FILE *file;
+	uint64_t bits;				// pending bits, right-aligned
+	uint32_t numBits;
+	double resolution;
+	uint64_t roundMask, roundHalf;
+	double deadband;
+	double lastStored, pendingTime, pendingValue;
+	bool pending;
+	uint64_t count, skipped;
+	int64_t prevTime, prevDelta;
+	uint64_t prevValue;
+	uint32_t prevLeading, prevTrailing;
+
+	void writeBits(uint64_t value, uint32_t n);
+	void encode(double time, double value);
+
+public:
+	GorillaWriter();
+	~GorillaWriter();
+	bool open(std::string fileName, double resolution, uint32_t mantissaBits = 52, double deadband = 0);
+	void append(double time, double value);
+	void close();
+	uint64_t getCount();
+	uint64_t getSkipped();
+};
+
+class GorillaReader
+{
+private:
+	FILE *file;
+	uint64_t bits;
+	uint32_t numBits;
+	double resolution;
+	uint64_t count, read;
+	int64_t prevTime, prevDelta;
+	uint64_t prevValue;
+	uint32_t prevLeading, prevTrailing;
+
+	uint64_t readBits(uint32_t n);
+
+public:
+	GorillaReader();
+	~GorillaReader();
+	bool open(std::string fileName);
+	bool next(double &time, double &value);
+	uint64_t getCount();
+	double getResolution();
+};
+
+inline uint32_t gorillaLeadingZeros(uint64_t x) {
+	return x ? __builtin_clzll(x) : 64;
+}
+
+inline uint32_t gorillaTrailingZeros(uint64_t x) {
+	return x ? __builtin_ctzll(x) : 64;
+}
+
+inline uint64_t gorillaDoubleBits(double value) {
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+inline double gorillaBitsDouble(uint64_t bits) {
+	double value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+inline GorillaWriter::GorillaWriter() {
+	this->file = 0;
+	this->bits = 0;
+	this->numBits = 0;
+	this->resolution = 1e-9;
+	this->roundMask = ~0ULL;
+	this->roundHalf = 0;
+	this->deadband = 0;
+	this->pending = false;
+	this->count = this->skipped = 0;
+}
+
+inline GorillaWriter::~GorillaWriter() {
+	this->close();
+}
+
+inline bool GorillaWriter::open(std::string fileName, double resolution, uint32_t mantissaBits, double deadband) {
+	this->file = fopen(fileName.c_str(), "wb");
+	if(!this->file) {
+		perror(fileName.c_str());
+		return false;
+	}
+	uint32_t version = GORILLA_VERSION;
+	this->resolution = resolution;
+	this->roundMask = ~0ULL;
+	this->roundHalf = 0;
+	if(mantissaBits < 52) {
+		this->roundMask = ~((1ULL << (52 - mantissaBits)) - 1);
+		this->roundHalf = 1ULL << (51 - mantissaBits);
+	}
+	this->deadband = deadband;
+	this->pending = false;
+	this->count = this->skipped = 0;
+	fwrite(GORILLA_MAGIC, 1, 4, this->file);
+	fwrite(&version, sizeof(version), 1, this->file);
+	fwrite(&this->resolution, sizeof(this->resolution), 1, this->file);
+	fwrite(&this->count, sizeof(this->count), 1, this->file);
+	return true;
+}
+
+//Up to 64 bits, in pieces of 32; whole bytes go out as soon as they are complete
+inline void GorillaWriter::writeBits(uint64_t value, uint32_t n) {
+	if(n > 32) {
+		this->writeBits(value >> 32, n - 32);
+		n = 32;
+	}
+	if(n < 64)
+		value &= (1ULL << n) - 1;
+	this->bits = (this->bits << n) | value;
+	this->numBits += n;
+	while(this->numBits >= 8) {
+		this->numBits -= 8;
+		fputc((int)((this->bits >> this->numBits) & 0xff), this->file);
+	}
+}
+
+inline void GorillaWriter::append(double time, double value) {
+	if(this->deadband > 0 && this->count > 0
+		&& std::fabs(value - this->lastStored) <= this->deadband*std::fabs(this->lastStored)) {
+		if(this->pending)
+			this->skipped++;
+		this->pendingTime = time;
+		this->pendingValue = value;
+		this->pending = true;
+		return;
+	}
+	if(this->pending)
+		this->skipped++;
+	this->pending = false;
+	this->lastStored = value;
+	this->encode(time, value);
+}
+
+inline void GorillaWriter::encode(double time, double value) {
+	int64_t t = (int64_t)std::llround(time/this->resolution);
+	uint64_t v = gorillaDoubleBits(value);
+	if(this->roundHalf && std::isfinite(value))
+		v = (v + this->roundHalf) & this->roundMask;
+	if(this->count == 0) {
+		this->writeBits((uint64_t)t, 64);
+		this->writeBits(v, 64);
+		this->prevTime = t;
+		this->prevDelta = 0;
+		this->prevValue = v;
+		this->prevLeading = 65;
+		this->prevTrailing = 0;
+		this->count++;
+		return;
+	}
+
+	int64_t delta = t - this->prevTime;
+	int64_t dod = delta - this->prevDelta;
+	if(dod == 0)
+		this->writeBits(0, 1);
+	else if(dod >= -64 && dod < 64) {
+		this->writeBits(0x2, 2);
+		this->writeBits((uint64_t)dod, 7);
+	} else if(dod >= -2048 && dod < 2048) {
+		this->writeBits(0x6, 3);
+		this->writeBits((uint64_t)dod, 12);
+	} else if(dod >= -524288 && dod < 524288) {
+		this->writeBits(0xe, 4);
+		this->writeBits((uint64_t)dod, 20);
+	} else {
+		this->writeBits(0xf, 4);
+		this->writeBits((uint64_t)dod, 64);
+	}
+	this->prevTime = t;
+	this->prevDelta = delta;
+
+	uint64_t x = v ^ this->prevValue;
+	if(x == 0)
+		this->writeBits(0, 1);
+	else {
+		uint32_t leading = gorillaLeadingZeros(x), trailing = gorillaTrailingZeros(x);
+		if(leading > 31)
+			leading = 31;
+		if(this->prevLeading <= 64 && leading >= this->prevLeading && trailing >= this->prevTrailing) {
+			this->writeBits(0x2, 2);
+			this->writeBits(x >> this->prevTrailing, 64 - this->prevLeading - this->prevTrailing);
+		} else {
+			uint32_t length = 64 - leading - trailing;
+			this->writeBits(0x3, 2);
+			this->writeBits(leading, 5);
+			this->writeBits(length == 64 ? 0 : length, 6);
+			this->writeBits(x >> trailing, length);
+			this->prevLeading = leading;
+			this->prevTrailing = trailing;
+		}
+	}
+	this->prevValue = v;
+	this->count++;
+}
+
+inline void GorillaWriter::close() {
+	if(!this->file)
+		return;
+	if(this->pending)
+		this->encode(this->pendingTime, this->pendingValue);
+	this->pending = false;
+	if(this->numBits > 0)
+		this->writeBits(0, 8 - this->numBits);
+	fseek(this->file, GORILLA_COUNT_OFFSET, SEEK_SET);
+	fwrite(&this->count, sizeof(this->count), 1, this->file);
+	fclose(this->file);
+	this->file = 0;
+}
+
+inline uint64_t GorillaWriter::getCount() {
+	return this->count;
+}
+
+inline uint64_t GorillaWriter::getSkipped() {
+	return this->skipped;
+}
+
+inline GorillaReader::GorillaReader() {
+	this->file = 0;
+	this->bits = 0;
+	this->numBits = 0;
+	this->resolution = 1e-9;
+	this->count = this->read = 0;
+}
+
+inline GorillaReader::~GorillaReader() {
+	if(this->file)
+		fclose(this->file);
+}
+
+inline bool GorillaReader::open(std::string fileName) {
+	this->file = fopen(fileName.c_str(), "rb");
+	if(!this->file)
+		return false;
+	char magic[4];
+	uint32_t version;
+	if(fread(magic, 1, 4, this->file) != 4 || memcmp(magic, GORILLA_MAGIC, 4) != 0
+		|| fread(&version, sizeof(version), 1, this->file) != 1 || version != GORILLA_VERSION
+		|| fread(&this->resolution, sizeof(this->resolution), 1, this->file) != 1
+		|| fread(&this->count, sizeof(this->count), 1, this->file) != 1) {
+		fclose(this->file);
+		this->file = 0;
+		return false;
+	}
+	this->read = 0;
+	return true;
+}
+
+//Up to 64 bits, in pieces of 32; past the end of the file reads zeros
+inline uint64_t GorillaReader::readBits(uint32_t n) {
+	if(n > 32) {
+		uint64_t high = this->readBits(n - 32);
+		return (high << 32) | this->readBits(32);
+	}
+	while(this->numBits < n) {
+		int c = fgetc(this->file);
+		this->bits = (this->bits << 8) | (uint64_t)(c == EOF ? 0 : c);
+		this->numBits += 8;
+	}
+	this->numBits -= n;
+	return n == 0 ? 0 : (this->bits >> this->numBits) & ((n < 64 ? (1ULL << n) : 0) - 1);
+}
+
+inline int64_t gorillaSignExtend(uint64_t value, uint32_t n) {
+	if(n < 64 && (value & (1ULL << (n - 1))))
+		value |= ~((1ULL << n) - 1);
+	return (int64_t)value;
+}
+
+inline bool GorillaReader::next(double &time, double &value) {
+	if(!this->file || this->read >= this->count)
+		return false;
+	if(this->read == 0) {
+		this->prevTime = (int64_t)this->readBits(64);
+		this->prevDelta = 0;
+		this->prevValue = this->readBits(64);
+		this->prevLeading = 65;
+		this->prevTrailing = 0;
+	} else {
+		int64_t dod = 0;
+		if(this->readBits(1) == 0)
+			dod = 0;
+		else if(this->readBits(1) == 0)
+			dod = gorillaSignExtend(this->readBits(7), 7);
+		else if(this->readBits(1) == 0)
+			dod = gorillaSignExtend(this->readBits(12), 12);
+		else if(this->readBits(1) == 0)
+			dod = gorillaSignExtend(this->readBits(20), 20);
+		else
+			dod = (int64_t)this->readBits(64);
+		this->prevDelta += dod;
+		this->prevTime += this->prevDelta;
+
+		if(this->readBits(1) == 1) {
+			if(this->readBits(1) == 0) {
+				uint32_t length = 64 - this->prevLeading - this->prevTrailing;
+				this->prevValue ^= this->readBits(length) << this->prevTrailing;
+			} else {
+				uint32_t leading = this->readBits(5);
+				uint32_t length = this->readBits(6);
+				if(length == 0)
+					length = 64;
+				uint32_t trailing = 64 - leading - length;
+				this->prevValue ^= this->readBits(length) << trailing;
+				this->prevLeading = leading;
+				this->prevTrailing = trailing;
+			}
+		}
+	}
+	this->read++;
+	time = this->prevTime*this->resolution;
+	value = gorillaBitsDouble(this->prevValue);
+	return true;
+}
+
+inline uint64_t GorillaReader::getCount() {
+	return this->count;
+}
+
+inline double GorillaReader::getResolution() {
+	return this->resolution;
+}
+
+#endif
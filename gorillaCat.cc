@@ -0,0 +1,74 @@
+/*
+	Expands compressed trace series (gorilla.h) back to text, or compresses
+	existing two-column text traces (e.g. the archive in DataFiles/).
+	Usage:
+		gorillaCat <file.grl>...                    print as "time\tvalue" lines
+		gorillaCat -c <in> <out.grl> [resolution] [mantissaBits] [deadband]
+		                                            compress a text trace
+	resolution: time tick in seconds (default 1e-9); mantissaBits: value
+	precision (default 52, lossless); deadband: relative change below which
+	points are dropped (default 0, keep all). Lines that are not two numbers
+	(comments) are skipped. Whole values print as integers, as the cwnd
+	traces were written.
+	Build: g++ -O2 -std=c++11 gorillaCat.cc -o gorillaCat
+*/
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include "gorilla.h"
+
+int compress(std::string in, std::string out, double resolution, uint32_t mantissaBits, double deadband) {
+	std::ifstream text(in.c_str());
+	if(!text) {
+		std::cerr << "Cannot open " << in << std::endl;
+		return EXIT_FAILURE;
+	}
+	GorillaWriter writer;
+	if(!writer.open(out, resolution, mantissaBits, deadband))
+		return EXIT_FAILURE;
+	std::string line;
+	double time, value;
+	while(std::getline(text, line)) {
+		std::stringstream ss(line);
+		if(ss >> time >> value)
+			writer.append(time, value);
+	}
+	writer.close();
+	std::cerr << writer.getCount() << " points stored, " << writer.getSkipped() << " inside the deadband" << std::endl;
+	return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv) {
+	if(argc < 2) {
+		std::cerr << "Usage: " << argv[0] << " <file.grl>..." << std::endl;
+		std::cerr << "       " << argv[0] << " -c <in> <out.grl> [resolution] [mantissaBits] [deadband]" << std::endl;
+		return EXIT_FAILURE;
+	}
+	if(std::string(argv[1]) == "-c") {
+		if(argc < 4) {
+			std::cerr << "Usage: " << argv[0] << " -c <in> <out.grl> [resolution] [mantissaBits] [deadband]" << std::endl;
+			return EXIT_FAILURE;
+		}
+		return compress(argv[2], argv[3], argc > 4 ? atof(argv[4]) : 1e-9, argc > 5 ? atoi(argv[5]) : 52, argc > 6 ? atof(argv[6]) : 0);
+	}
+
+	for(int i = 1; i < argc; ++i) {
+		GorillaReader reader;
+		if(!reader.open(argv[i])) {
+			std::cerr << "Not a compressed series: " << argv[i] << std::endl;
+			return EXIT_FAILURE;
+		}
+		double time, value;
+		while(reader.next(time, value)) {
+			std::cout << time << "\t";
+			if(value == std::floor(value) && std::fabs(value) < 1e15)
+				std::cout << (long long)value << "\n";
+			else
+				std::cout << value << "\n";
+		}
+	}
+	return 0;
+}
@@ -10,6 +10,23 @@
 #include "ns3/flow-monitor-module.h"
 #include "ns3/ipv4-global-routing-helper.h"
 #include "ns3/gnuplot.h"
+#include "bottleneck.h"
+#include "flowTable.h"
+#include "dropAccounting.h"
+#include "flowExport.h"
+#include "flowProbes.h"
+#include "replicas.h"
+#include "tcpVariants.h"
+#include "variantMatrix.h"
+#include "tcpSampler.h"
+#include "countingSink.h"
+#include "rateSchedule.h"
+#include "traceFiles.h"
+#include "measurementPhases.h"
+#include "ecnMarking.h"
+#include "bufferSizing.h"
+#include "socketParams.h"
+#include "streamingMode.h"
 
 typedef uint32_t uint;
 
@@ -26,6 +43,10 @@ class APP: public Application {
 
 		void ScheduleTx(void);
 		void SendPacket(void);
+		void SendPaced(void);
+		void Refill(void);
+		bool MorePackets(void) const;
+		void TxSpaceAvailable(Ptr<Socket> socket, uint32_t available);
 
 		Ptr<Socket>     mSocket;
 		Address         mPeer;
@@ -35,12 +56,17 @@ class APP: public Application {
 		EventId         mSendEvent;
 		bool            mRunning;
 		uint32_t        mPacketsSent;
+		bool            mPacing;
+		uint32_t        mBurst;
+		double          mTokens;
+		Time            mLastRefill;
 
 	public:
 		APP();
 		virtual ~APP();
 
 		void Setup(Ptr<Socket> socket, Address address, uint packetSize, uint nPackets, DataRate dataRate);
+		void SetPacing(uint burst);
 		void ChangeRate(DataRate newRate);
 		void recv(int numBytesRcvd);
 
@@ -53,13 +79,18 @@ APP::APP(): mSocket(0),
 		    mDataRate(0),
 		    mSendEvent(),
 		    mRunning(false),
-		    mPacketsSent(0) {
+		    mPacketsSent(0),
+		    mPacing(false),
+		    mBurst(0),
+		    mTokens(0),
+		    mLastRefill() {
 }
 
 APP::~APP() {
 	mSocket = 0;
 }
 
+//nPackets = 0: no limit, the flow runs until the application stops
 void APP::Setup(Ptr<Socket> socket, Address address, uint packetSize, uint nPackets, DataRate dataRate) {
 	mSocket = socket;
 	mPeer = address;
@@ -68,11 +99,32 @@ void APP::Setup(Ptr<Socket> socket, Address address, uint packetSize, uint nPack
 	mDataRate = dataRate;
 }
 
+/*
+	Token-bucket pacing instead of the fixed packet gap.
+	Tokens (bytes) accumulate at the data rate up to `burst`; the sender
+	writes back-to-back while it holds a packet's worth of tokens and the
+	socket has room, then sleeps until the next packet's worth has
+	accumulated, or until the socket frees space. One event per burst
+	rather than one per packet, and nothing is written that the socket
+	would refuse.
+*/
+void APP::SetPacing(uint burst) {
+	mPacing = true;
+	mBurst = burst < mPacketSize ? mPacketSize : burst;
+}
+
 void APP::StartApplication() {
 	mRunning = true;
 	mPacketsSent = 0;
 	mSocket->Bind();
 	mSocket->Connect(mPeer);
+	if(mPacing) {
+		mTokens = mBurst;
+		mLastRefill = Simulator::Now();
+		mSocket->SetSendCallback(MakeCallback(&APP::TxSpaceAvailable, this));
+		SendPaced();
+		return;
+	}
 	SendPacket();
 }
 
@@ -86,17 +138,52 @@ void APP::StopApplication() {
 	}
 }
 
+bool APP::MorePackets() const {
+	return mNPackets == 0 || mPacketsSent < mNPackets;
+}
+
 void APP::SendPacket() {
 	Ptr<Packet> packet = Create<Packet>(mPacketSize);
 	mSocket->Send(packet);
 
-	if(++mPacketsSent < mNPackets) {
+	mPacketsSent++;
+	if(MorePackets()) {
 		ScheduleTx();
 	}
 }
 
+void APP::Refill() {
+	Time now = Simulator::Now();
+	mTokens += (now - mLastRefill).GetSeconds()*mDataRate.GetBitRate()/8;
+	if(mTokens > mBurst)
+		mTokens = mBurst;
+	mLastRefill = now;
+}
+
+void APP::SendPaced() {
+	if(!mRunning)
+		return;
+	Refill();
+	while(mTokens >= mPacketSize && MorePackets()) {
+		if(mSocket->GetTxAvailable() < mPacketSize)
+			return;		//TxSpaceAvailable resumes
+		mSocket->Send(Create<Packet>(mPacketSize));
+		mTokens -= mPacketSize;
+		mPacketsSent++;
+	}
+	if(MorePackets() && mDataRate.GetBitRate() > 0) {
+		Time tNext(Seconds((mPacketSize - mTokens)*8/static_cast<double>(mDataRate.GetBitRate())));
+		mSendEvent = Simulator::Schedule(tNext, &APP::SendPaced, this);
+	}
+}
+
+void APP::TxSpaceAvailable(Ptr<Socket> socket, uint32_t available) {
+	if(mRunning && !mSendEvent.IsRunning())
+		SendPaced();
+}
+
 void APP::ScheduleTx() {
-	if (mRunning) {
+	if (mRunning && mDataRate.GetBitRate() > 0) {
 		Time tNext(Seconds(mPacketSize*8/static_cast<double>(mDataRate.GetBitRate())));
 		mSendEvent = Simulator::Schedule(tNext, &APP::SendPacket, this);
 		//double tVal = Simulator::Now().GetSeconds();
@@ -106,7 +193,18 @@ void APP::ScheduleTx() {
 }
 
 void APP::ChangeRate(DataRate newrate) {
+	bool wasStopped = mDataRate.GetBitRate() == 0;
+	if(mPacing && mRunning) {
+		//Tokens so far accrue at the old rate, the pending wake-up is recomputed
+		Refill();
+		mDataRate = newrate;
+		Simulator::Cancel(mSendEvent);
+		SendPaced();
+		return;
+	}
 	mDataRate = newrate;
+	if(wasStopped && mRunning && !mSendEvent.IsRunning() && MorePackets())
+		ScheduleTx();
 	return;
 }
 
@@ -121,18 +219,11 @@ PointToPointHelper configureP2PHelper(std::string rate, std::string latency, std
 }
 
 static void CwndChange(Ptr<OutputStreamWrapper> stream, double startTime, uint oldCwnd, uint newCwnd) {
+	if(!measuring)
+		return;
 	*stream->GetStream() << Simulator::Now ().GetSeconds () - startTime << "\t" << newCwnd << std::endl;
 }
 
-std::map<uint, uint> mapDrop;
-static void packetDrop(Ptr<OutputStreamWrapper> stream, double startTime, uint myId) {
-	*stream->GetStream() << Simulator::Now ().GetSeconds () - startTime << "\t" << std::endl;
-	if(mapDrop.find(myId) == mapDrop.end()) {
-		mapDrop[myId] = 0;
-	}
-	mapDrop[myId]++;
-}
-
 
 void IncRate(Ptr<APP> app, DataRate rate) {
 	app->ChangeRate(rate);
@@ -146,6 +237,8 @@ static double lastTimePrint = 0, lastTimePrintIPV4 = 0;
 double printGap = 0;
 
 void ReceivedPacket(Ptr<OutputStreamWrapper> stream, double startTime, std::string context, Ptr<const Packet> p, const Address& addr){
+	if(!measuring)
+		return;
 	double timeNow = Simulator::Now().GetSeconds();
 
 	if(mapBytesReceived.find(addr) == mapBytesReceived.end())
@@ -159,6 +252,8 @@ void ReceivedPacket(Ptr<OutputStreamWrapper> stream, double startTime, std::stri
 }
 
 void ReceivedPacketIPV4(Ptr<OutputStreamWrapper> stream, double startTime, std::string context, Ptr<const Packet> p, Ptr<Ipv4> ipv4, uint interface) {
+	if(!measuring)
+		return;
 	double timeNow = Simulator::Now().GetSeconds();
 
 	if(mapBytesReceivedIPV4.find(context) == mapBytesReceivedIPV4.end())
@@ -176,6 +271,21 @@ void ReceivedPacketIPV4(Ptr<OutputStreamWrapper> stream, double startTime, std::
 }
 
 
+//Live TCP state export, every socket created by uniFlow is sampled while it is set
+TcpStateSampler *tcpStateSampler = 0;
+
+//Receivers of uniFlow: CountingSink instead of PacketSink when set
+bool countingSinks = false;
+uint countingSinkReadSize = 0;
+
+//Senders of uniFlow: token-bucket pacing with this burst (bytes) when non-zero
+uint pacingBurst = 0;
+//Rate schedule driving the senders of uniFlow, in creation order, while set
+RateScheduler *rateScheduler = 0;
+//Socket parameters of the flows of uniFlow, in creation order, when set (packetSize becomes their write size)
+std::vector<SocketParam> flowSocketParams;
+uint uniFlowCount = 0;
+
 Ptr<Socket> uniFlow(Address sinkAddress, 
 					uint sinkPort, 
 					std::string tcpVariant, 
@@ -189,29 +299,193 @@ Ptr<Socket> uniFlow(Address sinkAddress,
 					double appStartTime,
 					double appStopTime) {
 
-	if(tcpVariant.compare("TcpHybla") == 0) {
-		Config::SetDefault("ns3::TcpL4Protocol::SocketType", TypeIdValue(TcpHybla::GetTypeId()));
-	} else if(tcpVariant.compare("TcpWestwood") == 0) {
-		Config::SetDefault("ns3::TcpL4Protocol::SocketType", TypeIdValue(TcpWestwoodPlus::GetTypeId()));
-	} else if(tcpVariant.compare("TcpYeah") == 0) {
-		Config::SetDefault("ns3::TcpL4Protocol::SocketType", TypeIdValue(TcpYeah::GetTypeId()));
+	setTcpVariant(hostNode, tcpVariantTypeId(tcpVariant));
+	//A DCTCP receiver echoes CE on every ACK; a classic ECN one holds ECE until CWR
+	if(tcpVariant == "TcpDctcp")
+		setTcpVariant(sinkNode, TcpDctcp::GetTypeId());
+	ApplicationContainer sinkApps;
+	if(countingSinks) {
+		Ptr<CountingSink> sink = CreateObject<CountingSink>();
+		sink->Setup(sinkPort, countingSinkReadSize);
+		sinkNode->AddApplication(sink);
+		sinkApps.Add(sink);
 	} else {
-		fprintf(stderr, "Invalid TCP version\n");
-		exit(EXIT_FAILURE);
+		PacketSinkHelper packetSinkHelper("ns3::TcpSocketFactory", InetSocketAddress(Ipv4Address::GetAny(), sinkPort));
+		sinkApps = packetSinkHelper.Install(sinkNode);
 	}
-	PacketSinkHelper packetSinkHelper("ns3::TcpSocketFactory", InetSocketAddress(Ipv4Address::GetAny(), sinkPort));
-	ApplicationContainer sinkApps = packetSinkHelper.Install(sinkNode);
 	sinkApps.Start(Seconds(startTime));
 	sinkApps.Stop(Seconds(stopTime));
 
 	Ptr<Socket> ns3TcpSocket = Socket::CreateSocket(hostNode, TcpSocketFactory::GetTypeId());
-	
+	uint flow = uniFlowCount++;
+	if(flow < flowSocketParams.size()) {
+		applySocketParam(ns3TcpSocket, flowSocketParams[flow]);
+		scheduleListenerParam(sinkApps.Get(0), startTime, flowSocketParams[flow]);
+		packetSize = flowSocketParams[flow].writeSize;
+	}
+	if(tcpStateSampler)
+		tcpStateSampler->installSocket(ns3TcpSocket);
 
 	Ptr<APP> app = CreateObject<APP>();
 	app->Setup(ns3TcpSocket, sinkAddress, packetSize, numPackets, DataRate(dataRate));
+	if(pacingBurst)
+		app->SetPacing(pacingBurst);
+	if(rateScheduler)
+		rateScheduler->addFlow(MakeCallback(&APP::ChangeRate, app));
 	hostNode->AddApplication(app);
 	app->SetStartTime(Seconds(appStartTime));
 	app->SetStopTime(Seconds(appStopTime));
 
 	return ns3TcpSocket;
-}
\ No newline at end of file
+}
+/*
+	Options of the dumbbell runs that part13 and part23 share, registered
+	on their CommandLine by addRunOptions so that the two mains cannot drift
+	apart; the options of one part only (streaming, sweeps, ...) stay in
+	its main. checkRunOptions normalises them once cmd.Parse is done and
+	returns the TCP variant of each sender.
+*/
+struct RunParam
+{
+	std::string queueDisc;			// None, DropTail, RED, CoDel, FqCoDel or Pie on R1-R2
+	EcnParam ecnParams;				// SACK, ECN marking on R1-R2, DCTCP (ecnMarking.h)
+	double queueSampleInterval;		// s between bottleneck queue samples
+
+	// Per sender, or one value for all (socketParams.h)
+	std::string segmentSizes;
+	std::string sndBufs;
+	std::string rcvBufs;
+	std::string initialCwnds;
+	std::string socketSweepList;
+
+	FlowProbeConfig probeConfig;
+	std::string flowmonHosts;
+
+	uint32_t seed;
+	uint64_t run;
+	uint32_t replicas;
+	uint32_t parallel;
+	std::string outDir;
+	std::string cacheDir;
+
+	std::string shmName;
+	double modelTolerance;
+	bool liveTable;
+	std::string aggregateName;
+	std::string aggregateKey;
+
+	std::string variantList;
+	std::string sinkType;
+	double sinkSampleInterval;
+	std::string transferSpeed;
+	std::string rateScheduleFile;
+	double rateScheduleResolution;
+
+	bool compressTraces;
+	uint32_t traceMantissaBits;
+	double traceDeadband;
+	bool muxTraces;
+
+	RunParam(std::string outDir);
+};
+
+RunParam::RunParam(std::string outDir) {
+	this->queueDisc = "None";
+	this->queueSampleInterval = 0.01;
+
+	this->segmentSizes = "0";
+	this->sndBufs = "0";
+	this->rcvBufs = "0";
+	this->initialCwnds = "0";
+	this->socketSweepList = "";
+
+	this->flowmonHosts = "0,1,2";
+
+	this->seed = 1;
+	this->run = 1;
+	this->replicas = 1;
+	this->parallel = 4;
+	this->outDir = outDir;
+	this->cacheDir = "";
+
+	this->shmName = "";
+	this->modelTolerance = 2;
+	this->liveTable = false;
+	this->aggregateName = "";
+	this->aggregateKey = "";
+
+	this->variantList = "TcpHybla,TcpWestwood,TcpYeah";
+	this->sinkType = "PacketSink";
+	this->sinkSampleInterval = 0.1;
+	this->transferSpeed = "400Mbps";
+	this->rateScheduleFile = "";
+	this->rateScheduleResolution = 0.1;
+
+	this->compressTraces = false;
+	this->traceMantissaBits = 24;
+	this->traceDeadband = 0;
+	this->muxTraces = false;
+}
+
+//`muxFile` is the name of the multiplexed trace file of the part, for the help text
+void addRunOptions(CommandLine &cmd, RunParam &params, std::string muxFile) {
+	cmd.AddValue("queueDisc", "Bottleneck queue discipline: None, DropTail, RED, CoDel, FqCoDel or Pie", params.queueDisc);
+	cmd.AddValue("sack", "Selective acknowledgements on every TCP socket", params.ecnParams.sack);
+	cmd.AddValue("ecn", "ECN on every TCP socket and marking at the bottleneck AQM", params.ecnParams.ecn);
+	cmd.AddValue("dctcp", "DCTCP on every flow with step marking (RED) at the bottleneck, implies ecn", params.ecnParams.dctcp);
+	cmd.AddValue("markThreshold", "DCTCP marking threshold K (packets)", params.ecnParams.markThreshold);
+	cmd.AddValue("segmentSize", "TCP segment size of each sender (bytes, or one for all), 0 for the application write size", params.segmentSizes);
+	cmd.AddValue("sndBuf", "Send buffer of each sender (bytes, or one for all), 0 for twice the path bandwidth-delay product", params.sndBufs);
+	cmd.AddValue("rcvBuf", "Receive buffer of each receiver (bytes, or one for all), 0 for twice the path bandwidth-delay product", params.rcvBufs);
+	cmd.AddValue("initialCwnd", "Initial congestion window of each sender (segments, or one for all), 0 for the default", params.initialCwnds);
+	cmd.AddValue("socketSweep", "Run these socket buffer sizes (multiples of the path bandwidth-delay product) and report throughput against socket memory", params.socketSweepList);
+	cmd.AddValue("queueSampleInterval", "Bottleneck queue sampling interval (s)", params.queueSampleInterval);
+	cmd.AddValue("flowmonMode", "FlowMonitor probes: All or Bottleneck (routers and flowmonHosts only)", params.probeConfig.mode);
+	cmd.AddValue("flowmonHosts", "Host pairs probed in Bottleneck mode, e.g. 0,2", params.flowmonHosts);
+	cmd.AddValue("flowmonStart", "Start of the FlowMonitor accounting window (s)", params.probeConfig.startTime);
+	cmd.AddValue("flowmonStop", "End of the FlowMonitor accounting window (s), -1 for the whole run", params.probeConfig.stopTime);
+	cmd.AddValue("seed", "RNG seed", params.seed);
+	cmd.AddValue("run", "RNG run number (first run number with --replicas)", params.run);
+	cmd.AddValue("replicas", "Number of independent replicas to run", params.replicas);
+	cmd.AddValue("parallel", "Replicas run concurrently", params.parallel);
+	cmd.AddValue("outDir", "Output directory", params.outDir);
+	cmd.AddValue("shmName", "Shared-memory segment for live TCP state (e.g. /dumbbell), empty to disable", params.shmName);
+	cmd.AddValue("modelTolerance", "Flag flows whose throughput is off the Mathis/Padhye prediction by more than this factor", params.modelTolerance);
+	cmd.AddValue("liveTable", "Sweeps: merge the runs into sweep_live.csv as they finish", params.liveTable);
+	cmd.AddValue("aggregate", "Shared-memory table of the sweep this run belongs to (set by the sweep)", params.aggregateName);
+	cmd.AddValue("aggregateKey", "Sweep point of this run in that table (set by the sweep)", params.aggregateKey);
+	cmd.AddValue("cacheDir", "Results cache: reuse finished runs of the same scenario, empty to disable", params.cacheDir);
+	cmd.AddValue("variants", "TCP variant of each sender (H1,H2,H3)", params.variantList);
+	cmd.AddValue("sink", "Receiver application: PacketSink or Counting (byte counters only, sampled goodput trace)", params.sinkType);
+	cmd.AddValue("sinkReadSize", "Bytes per read of the Counting sink, 0 to drain the receive buffer", countingSinkReadSize);
+	cmd.AddValue("sinkSampleInterval", "Goodput trace interval of the Counting sink (s)", params.sinkSampleInterval);
+	cmd.AddValue("senderRate", "Application sending rate of each sender", params.transferSpeed);
+	cmd.AddValue("pacingBurst", "Token-bucket pacing of the senders with this burst (bytes), 0 for the fixed packet gap", pacingBurst);
+	cmd.AddValue("rateSchedule", "Table of step/ramp/sinusoid sending rates per sender, empty to keep senderRate", params.rateScheduleFile);
+	cmd.AddValue("rateScheduleResolution", "Update interval of ramps and sinusoids (s)", params.rateScheduleResolution);
+	cmd.AddValue("compressTraces", "Write the .cw/.tp/.gp traces compressed (<file>.grl, expand with gorillaCat)", params.compressTraces);
+	cmd.AddValue("traceMantissaBits", "Value precision of compressed traces (52 = lossless)", params.traceMantissaBits);
+	cmd.AddValue("traceDeadband", "Drop compressed trace points within this relative change of the last stored one", params.traceDeadband);
+	cmd.AddValue("muxTraces", "Write every trace of the run into one file (" + muxFile + ", split with traceSplit)", params.muxTraces);
+}
+
+std::vector<std::string> checkRunOptions(RunParam &params, uint32_t numSender) {
+	//Output paths are outDir + file name
+	if(!params.outDir.empty() && params.outDir[params.outDir.size()-1] != '/')
+		params.outDir += "/";
+	params.probeConfig.hosts = parseIndexList(params.flowmonHosts);
+	if(params.sinkType != "PacketSink" && params.sinkType != "Counting") {
+		fprintf(stderr, "Invalid sink %s\n", params.sinkType.c_str());
+		exit(EXIT_FAILURE);
+	}
+	countingSinks = params.sinkType == "Counting";
+	std::vector<std::string> tcpVariants = parseVariantList(params.variantList);
+	if(tcpVariants.size() != numSender) {
+		fprintf(stderr, "Need one TCP variant per sender (%u)\n", numSender);
+		exit(EXIT_FAILURE);
+	}
+	params.queueDisc = checkEcnParam(params.ecnParams, params.queueDisc);
+	if(params.ecnParams.dctcp)
+		tcpVariants.assign(numSender, "TcpDctcp");
+	return tcpVariants;
+}
@@ -0,0 +1,116 @@
+#ifndef MEASUREMENT_PHASES_H
+#define MEASUREMENT_PHASES_H
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include "ns3/core-module.h"
+
+using namespace ns3;
+
+/*
+	Warm-up, measure and cool-down phases of a run:
+		[0, warmup)					warm-up, slow start and queue build-up
+		[warmup, warmup+measure)	measure
+		[warmup+measure, end]		cool-down, flows keep running unobserved
+	Everything that records data (the trace callbacks, the queue and sink
+	samplers, drop accounting) checks the one flag `measuring` and returns
+	early while it is off. Nothing is disconnected or reconnected: the
+	controller flips the flag with one event per boundary. FlowMonitor gets
+	the same window through its own StartTime/Stop (FlowProbeConfig).
+	Rates are averaged from the start of the measure phase, so traces are
+	connected with getMeasureStart() as their startTime. Counters that are
+	read at the end (e.g. PacketSink::GetTotalRx) are registered with
+	addCounter and read back with getMeasured: their value at each
+	boundary is kept, so what accrued outside the window drops out.
+	The defaults (no warm-up, measure until the end) keep the flag on for
+	the whole run.
+*/
+bool measuring = true;
+
+class MeasurementPhases
+{
+private:
+	double warmup;
+	double measure;		// -1: until the end of the simulation
+	std::vector<Callback<uint64_t> > counters;
+	std::vector<uint64_t> atStart, atStop;
+	bool stopped;
+
+	void enter(bool on, std::string phase);
+
+public:
+	MeasurementPhases();
+	void set(double warmup, double measure);
+	uint32_t addCounter(Callback<uint64_t> counter);
+	void schedule();
+	uint64_t getMeasured(uint32_t counter);
+	double getMeasureStart();
+	double getMeasureStop(double end);
+};
+
+MeasurementPhases::MeasurementPhases() {
+	this->warmup = 0;
+	this->measure = -1;
+	this->stopped = false;
+}
+
+void MeasurementPhases::set(double warmup, double measure) {
+	if(warmup < 0 || measure == 0) {
+		fprintf(stderr, "Invalid measurement phases: warm-up %g s, measure %g s\n", warmup, measure);
+		exit(EXIT_FAILURE);
+	}
+	this->warmup = warmup;
+	this->measure = measure;
+}
+
+uint32_t MeasurementPhases::addCounter(Callback<uint64_t> counter) {
+	this->counters.push_back(counter);
+	this->atStart.push_back(0);
+	this->atStop.push_back(0);
+	return this->counters.size() - 1;
+}
+
+void MeasurementPhases::enter(bool on, std::string phase) {
+	measuring = on;
+	for(uint32_t i = 0; i < this->counters.size(); ++i) {
+		if(on)
+			this->atStart[i] = this->counters[i]();
+		else
+			this->atStop[i] = this->counters[i]();
+	}
+	this->stopped = !on;
+	std::cout << Simulator::Now().GetSeconds() << "s: " << phase << " phase" << std::endl;
+}
+
+//To be called before Simulator::Run(), once the counters are added
+void MeasurementPhases::schedule() {
+	measuring = this->warmup == 0;
+	this->stopped = false;
+	for(uint32_t i = 0; i < this->counters.size(); ++i)
+		this->atStart[i] = this->counters[i]();
+	if(this->warmup > 0)
+		Simulator::Schedule(Seconds(this->warmup), &MeasurementPhases::enter, this, true, std::string("measure"));
+	if(this->measure > 0)
+		Simulator::Schedule(Seconds(this->warmup + this->measure), &MeasurementPhases::enter, this, false, std::string("cool-down"));
+}
+
+//Growth of a counter over the measure phase (up to now if it is still on)
+uint64_t MeasurementPhases::getMeasured(uint32_t counter) {
+	uint64_t end = this->stopped ? this->atStop[counter] : this->counters[counter]();
+	return end - this->atStart[counter];
+}
+
+double MeasurementPhases::getMeasureStart() {
+	return this->warmup;
+}
+
+double MeasurementPhases::getMeasureStop(double end) {
+	if(this->measure < 0 || this->warmup + this->measure > end)
+		return end;
+	return this->warmup + this->measure;
+}
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef MEMORY_ACCOUNTING_H
+#define MEMORY_ACCOUNTING_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <unistd.h>
+#include <sys/resource.h>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+
+using namespace ns3;
+
+//Resident set size of this process (bytes)
+uint64_t currentRss() {
+	std::ifstream statm("/proc/self/statm");
+	uint64_t size = 0, resident = 0;
+	statm >> size >> resident;
+	return resident * (uint64_t)sysconf(_SC_PAGESIZE);
+}
+
+//Highest resident set size so far (bytes)
+uint64_t peakRss() {
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return (uint64_t)usage.ru_maxrss * 1024;
+}
+
+/*
+	Memory per subsystem, measured as the growth of the resident set while
+	the subsystem is built: mark(name) charges everything allocated since
+	the previous mark to `name`, and marks of the same name add up, so the
+	setup of interleaved subsystems (e.g. the trace streams and sockets of
+	each flow) can be charged piecewise. Freed memory the allocator keeps is
+	not given back, so the figures are what each stage added to the peak.
+*/
+class MemoryAccounting
+{
+private:
+	std::vector<std::string> names;
+	std::vector<int64_t> bytes;
+	uint64_t last;
+	uint64_t base;
+
+public:
+	MemoryAccounting();
+	void mark(std::string name);
+	void report(std::ostream &os, uint32_t hostPairs);
+};
+
+MemoryAccounting::MemoryAccounting() {
+	this->base = this->last = currentRss();
+}
+
+void MemoryAccounting::mark(std::string name) {
+	uint64_t now = currentRss();
+	int64_t delta = (int64_t)now - (int64_t)this->last;
+	this->last = now;
+	for(uint32_t i = 0; i < this->names.size(); ++i) {
+		if(this->names[i] == name) {
+			this->bytes[i] += delta;
+			return;
+		}
+	}
+	this->names.push_back(name);
+	this->bytes.push_back(delta);
+}
+
+void MemoryAccounting::report(std::ostream &os, uint32_t hostPairs) {
+	uint32_t devices = 0, applications = 0;
+	for(uint32_t n = 0; n < NodeList::GetNNodes(); ++n) {
+		devices += NodeList::GetNode(n)->GetNDevices();
+		applications += NodeList::GetNode(n)->GetNApplications();
+	}
+	if(hostPairs == 0)
+		hostPairs = 1;
+
+	os << "Memory by subsystem (resident set growth, KB):" << "\n";
+	os << std::setw(36) << std::left << "  before topology" << std::right << std::setw(12) << this->base/1024 << "\n";
+	for(uint32_t i = 0; i < this->names.size(); ++i) {
+		os << std::setw(36) << std::left << "  " + this->names[i] << std::right << std::setw(12) << this->bytes[i]/1024
+			<< std::setw(12) << this->bytes[i]/1024.0/hostPairs << " per host pair\n";
+	}
+	os << "Objects: " << NodeList::GetNNodes() << " nodes, " << devices << " devices, " << applications << " applications\n";
+	os << "Peak RSS: " << peakRss()/1024 << " KB, " << peakRss()/1024.0/hostPairs << " KB per host pair (" << hostPairs << " pairs)" << std::endl;
+}
+
+#endif
@@ -0,0 +1,134 @@
+/*
+	Mathis/Padhye check over the flow CSVs of a whole sweep (tcpModel.h),
+	the offline counterpart of the model_check_<part>.csv of each run.
+	Usage:
+		modelCheck [options] <flows.csv>...
+		find PartB/ -name flows_b.csv | xargs modelCheck -o check.csv
+	Options (defaults: the dumbbell of part23):
+		-r <ms>     base RTT of the path (180)
+		-m <bytes>  segment size (1331)
+		-w <segs>   receive window (338, twice the path BDP)
+		-T <s>      retransmission timeout T0 (1)
+		-b <n>      segments acked per ACK (2, ns-3's default DelAckCount)
+		-t <x>      tolerance factor (2)
+		-o <file>   one row per flow (default: stdout)
+	Every flow of every file goes into one batch and the models are
+	computed in a single pass; a summary per label goes to stderr and the
+	exit status is 1 when any flow departs from a model.
+	Build: g++ -O2 -fno-math-errno -std=c++11 modelCheck.cc -o modelCheck
+*/
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include "tcpModel.h"
+
+struct FlowRow
+{
+	std::string file;
+	std::string label;
+};
+
+//Flows found in the file, appended to the batch with the given model inputs
+uint32_t readFlows(std::string fileName, double baseRtt, double mss, double wmax, double rto, ModelBatch &batch, std::vector<FlowRow> &rows) {
+	std::ifstream in(fileName.c_str());
+	std::string line, cell;
+	std::map<std::string, int> column;
+	if(!std::getline(in, line))
+		return 0;
+	std::stringstream header(line);
+	for(int c = 0; std::getline(header, cell, ','); ++c)
+		column[cell] = c;
+	const char *needed[] = {"label", "found", "txPackets", "loss_rate", "delay_ms", "throughput_kbps"};
+	for(uint32_t i = 0; i < 6; ++i) {
+		if(!column.count(needed[i])) {
+			std::cerr << fileName << ": no " << needed[i] << " column" << std::endl;
+			return 0;
+		}
+	}
+	uint32_t n = 0;
+	std::vector<std::string> cells;
+	while(std::getline(in, line)) {
+		cells.clear();
+		std::stringstream ss(line);
+		while(std::getline(ss, cell, ','))
+			cells.push_back(cell);
+		if(cells.size() < column.size() || cells[column["found"]] != "1")
+			continue;
+		double tx = atof(cells[column["txPackets"]].c_str());
+		if(tx <= 0)
+			continue;
+		double loss = atof(cells[column["loss_rate"]].c_str());
+		if(column.count("ecn_marks"))
+			loss += atof(cells[column["ecn_marks"]].c_str())/tx;
+		double rtt = atof(cells[column["delay_ms"]].c_str())/1000 + baseRtt/2;
+		batch.add(loss, rtt, mss, wmax, rto, atof(cells[column["throughput_kbps"]].c_str()));
+		FlowRow row;
+		row.file = fileName;
+		row.label = cells[column["label"]];
+		rows.push_back(row);
+		n++;
+	}
+	return n;
+}
+
+int main(int argc, char **argv) {
+	double baseRtt = 0.18, mss = 1331, wmax = 338, rto = 1, acked = 2, tolerance = 2;
+	std::string outFile;
+	int i = 1;
+	for(; i < argc && argv[i][0] == '-' && i + 1 < argc; i += 2) {
+		double value = atof(argv[i + 1]);
+		if(strcmp(argv[i], "-r") == 0)
+			baseRtt = value/1000;
+		else if(strcmp(argv[i], "-m") == 0)
+			mss = value;
+		else if(strcmp(argv[i], "-w") == 0)
+			wmax = value;
+		else if(strcmp(argv[i], "-T") == 0)
+			rto = value;
+		else if(strcmp(argv[i], "-b") == 0)
+			acked = value;
+		else if(strcmp(argv[i], "-t") == 0)
+			tolerance = value;
+		else if(strcmp(argv[i], "-o") == 0)
+			outFile = argv[i + 1];
+		else
+			break;
+	}
+	if(i >= argc || tolerance <= 1 || baseRtt <= 0 || mss <= 0 || acked <= 0) {
+		std::cerr << "Usage: " << argv[0] << " [-r ms] [-m bytes] [-w segs] [-T s] [-b n] [-t x] [-o file] <flows.csv>..." << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	ModelBatch batch;
+	std::vector<FlowRow> rows;
+	for(; i < argc; ++i)
+		readFlows(argv[i], baseRtt, mss, wmax, rto, batch, rows);
+	computeModels(batch, acked);
+
+	std::ofstream file;
+	if(!outFile.empty())
+		file.open(outFile.c_str());
+	std::ostream &out = outFile.empty() ? std::cout : file;
+	out << "file,label,loss_rate,rtt_ms,throughput_kbps,mathis_kbps,padhye_kbps,mathis_ratio,padhye_ratio,departs\n";
+	std::map<std::string, uint32_t> flows, departing;
+	for(uint32_t f = 0; f < batch.size(); ++f) {
+		bool departs = modelDeparts(batch.simulated[f], batch.mathis[f], tolerance) || modelDeparts(batch.simulated[f], batch.padhye[f], tolerance);
+		out << rows[f].file << "," << rows[f].label << "," << batch.lossRate[f] << "," << batch.rtt[f]*1000 << "," << batch.simulated[f] << ","
+			<< batch.mathis[f] << "," << batch.padhye[f] << "," << modelRatio(batch.simulated[f], batch.mathis[f]) << ","
+			<< modelRatio(batch.simulated[f], batch.padhye[f]) << "," << departs << "\n";
+		flows[rows[f].label]++;
+		if(departs)
+			departing[rows[f].label]++;
+	}
+	uint32_t total = 0;
+	for(std::map<std::string, uint32_t>::iterator it = flows.begin(); it != flows.end(); ++it) {
+		std::cerr << it->first << ": " << departing[it->first] << " of " << it->second << " flows off the models by more than x" << tolerance << std::endl;
+		total += departing[it->first];
+	}
+	return total ? 1 : 0;
+}
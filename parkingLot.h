@@ -0,0 +1,312 @@
+#ifndef PARKING_LOT_H
+#define PARKING_LOT_H
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/ipv4-static-routing-helper.h"
+#include "ns3/ipv4-global-routing-helper.h"
+#include "flowTable.h"
+#include "bottleneck.h"
+
+using namespace ns3;
+
+/*
+	Parking-lot topology: a chain of routers R0 - R1 - ... - R(K-1).
+	Long flows enter at R0 and leave at R(K-1), crossing every hop.
+	At each hop h, numCrossFlows cross-traffic flows enter at Rh and leave
+	at R(h+1), so every router-router link is a bottleneck shared by the
+	long flows and its own cross traffic. K = 2 with no cross flows is the
+	dumbbell.
+		 S0..   C0..    C1..
+		  |      |       |
+		  R0 --- R1 ---- R2 --- ...
+		         |       |       |
+		        C0'..   C1'..   D0..
+	Every flow has its own sender and receiver host.
+*/
+struct ParkingLotParam
+{
+	uint32_t numRouters;
+	uint32_t numLongFlows;
+	uint32_t numCrossFlows;		// per hop
+
+	std::string bandwidth_hostToRouter;
+	std::string delay_hostToRouter;
+	std::string bandwidth_routerToRouter;
+	std::string delay_routerToRouter;
+	uint32_t packetSize;
+	uint32_t queueSizeHR;
+	uint32_t queueSizeRR;
+
+	std::string routing;		// Static (computed from the chain) or Global
+
+	ParkingLotParam();
+};
+
+ParkingLotParam::ParkingLotParam() {
+	this -> numRouters = 4;
+	this -> numLongFlows = 1;
+	this -> numCrossFlows = 1;
+
+	this -> bandwidth_hostToRouter = "100Mbps";
+	this -> delay_hostToRouter = "20ms";
+	this -> bandwidth_routerToRouter = "10Mbps";
+	this -> delay_routerToRouter = "50ms";
+	this -> packetSize = 1.3*1024;		// 1.3KB, the flows' write size
+	// One bandwidth-delay product of each link: rate*delay/(8*packetSize) packets
+	this -> queueSizeHR = bdpPackets(this->bandwidth_hostToRouter, Time(this->delay_hostToRouter), this->packetSize);
+	this -> queueSizeRR = bdpPackets(this->bandwidth_routerToRouter, Time(this->delay_routerToRouter), this->packetSize);
+
+	this -> routing = "Static";
+}
+
+/*
+	Address plan, so that routes can be computed instead of searched:
+	router r owns the /18 block 10.0.0.0 + (r << 14) for its leaf links,
+	one /30 per host link (up to 4096 hosts per router, 1024 routers).
+	Router-router link r -> r+1 is the /30 172.16.0.0 + (r << 2).
+*/
+#define PARKING_LOT_MAX_ROUTERS 1024
+
+Ipv4Address parkingLotLeafBlock(uint32_t router) {
+	return Ipv4Address(0x0A000000 + (router << 14));
+}
+
+Ipv4Address parkingLotRouterLink(uint32_t hop) {
+	return Ipv4Address(0xAC100000 + (hop << 2));
+}
+
+class ParkingLotTopology
+{
+private:
+	NodeContainer routers, senders, receivers;
+	std::vector<uint32_t> senderRouter, receiverRouter;
+	uint32_t numLongFlows;
+	std::vector<NetDeviceContainer> routerLinks;		// routerLinks[h]: (Rh, Rh+1)
+	std::vector<Ipv4InterfaceContainer> routerLinkIFCs;
+	NetDeviceContainer hostDevices;
+	Ipv4InterfaceContainer senderIFCs, receiverIFCs;
+	std::vector<NetDeviceContainer> leafDevices;		// leafDevices[r]: (router, host) devices of r's host links
+	std::vector<Ipv4InterfaceContainer> leafIFCs;		// leafIFCs[r]: (router, host) per link
+
+	void createNodes(ParkingLotParam params);
+	void setNetDevices(ParkingLotParam params);
+	void installInternetStack(ParkingLotParam params);
+	void addIpAddrToNetDevices(ParkingLotParam params);
+	void setStaticRoutes(ParkingLotParam params);
+
+public:
+	void build(ParkingLotParam params);
+	void addFlows(FlowTable &flowTable);
+	uint32_t getNumFlows();
+	Ptr<Node> getSender(uint32_t flow);
+	Ptr<Node> getReceiver(uint32_t flow);
+	Ipv4Address getReceiverAddress(uint32_t flow);
+	NetDeviceContainer getBottleneckDevices();
+	NetDeviceContainer getNetDevices();
+};
+
+void ParkingLotTopology::build(ParkingLotParam params) {
+	if(params.numRouters < 2 || params.numRouters > PARKING_LOT_MAX_ROUTERS) {
+		fprintf(stderr, "Invalid number of routers\n");
+		exit(EXIT_FAILURE);
+	}
+	if(params.numLongFlows + 2*params.numCrossFlows > 4096) {
+		fprintf(stderr, "Too many hosts on one router\n");
+		exit(EXIT_FAILURE);
+	}
+	std::cout << "Parking lot: " << params.numRouters << " routers, " << params.numLongFlows << " long flows, "
+		<< params.numCrossFlows << " cross flows per hop" << std::endl;
+	this->createNodes(params);
+	this->setNetDevices(params);
+	this->installInternetStack(params);
+	this->addIpAddrToNetDevices(params);
+	if(params.routing.compare("Static") == 0) {
+		this->setStaticRoutes(params);
+	} else if(params.routing.compare("Global") == 0) {
+		Ipv4GlobalRoutingHelper::PopulateRoutingTables();
+	} else {
+		fprintf(stderr, "Invalid routing\n");
+		exit(EXIT_FAILURE);
+	}
+}
+
+//Flow i: senders.Get(i) -> receivers.Get(i); long flows first, then cross flows hop by hop
+void ParkingLotTopology::createNodes(ParkingLotParam params) {
+	uint32_t hops = params.numRouters - 1;
+	uint32_t numFlows = params.numLongFlows + hops*params.numCrossFlows;
+	this->routers.Create(params.numRouters);
+	this->senders.Create(numFlows);
+	this->receivers.Create(numFlows);
+	this->numLongFlows = params.numLongFlows;
+	for(uint32_t i = 0; i < params.numLongFlows; ++i) {
+		this->senderRouter.push_back(0);
+		this->receiverRouter.push_back(params.numRouters - 1);
+	}
+	for(uint32_t h = 0; h < hops; ++h) {
+		for(uint32_t i = 0; i < params.numCrossFlows; ++i) {
+			this->senderRouter.push_back(h);
+			this->receiverRouter.push_back(h + 1);
+		}
+	}
+}
+
+void ParkingLotTopology::setNetDevices(ParkingLotParam params) {
+	PointToPointHelper pointToPointRouter, pointToPointLeaf;
+	pointToPointRouter.SetDeviceAttribute("DataRate", StringValue(params.bandwidth_routerToRouter));
+	pointToPointRouter.SetChannelAttribute("Delay", StringValue(params.delay_routerToRouter));
+	pointToPointRouter.SetQueue("ns3::DropTailQueue", "MaxSize", StringValue(std::to_string(params.queueSizeRR)+"p"));
+	pointToPointLeaf.SetDeviceAttribute("DataRate", StringValue(params.bandwidth_hostToRouter));
+	pointToPointLeaf.SetChannelAttribute("Delay", StringValue(params.delay_hostToRouter));
+	pointToPointLeaf.SetQueue("ns3::DropTailQueue", "MaxSize", StringValue(std::to_string(params.queueSizeHR)+"p"));
+
+	for(uint32_t h = 0; h + 1 < params.numRouters; ++h) {
+		this->routerLinks.push_back(pointToPointRouter.Install(this->routers.Get(h), this->routers.Get(h + 1)));
+	}
+	this->leafDevices.resize(params.numRouters);
+	for(uint32_t i = 0; i < this->senders.GetN(); ++i) {
+		NetDeviceContainer cleft = pointToPointLeaf.Install(this->routers.Get(this->senderRouter[i]), this->senders.Get(i));
+		NetDeviceContainer cright = pointToPointLeaf.Install(this->routers.Get(this->receiverRouter[i]), this->receivers.Get(i));
+		this->leafDevices[this->senderRouter[i]].Add(cleft);
+		this->leafDevices[this->receiverRouter[i]].Add(cright);
+		this->hostDevices.Add(cleft);
+		this->hostDevices.Add(cright);
+	}
+}
+
+/*
+	With static routing the nodes get only Ipv4StaticRouting, which skips
+	the global routing object on every node and the all-pairs route
+	computation of PopulateRoutingTables.
+*/
+void ParkingLotTopology::installInternetStack(ParkingLotParam params) {
+	InternetStackHelper stack;
+	if(params.routing.compare("Static") == 0) {
+		Ipv4StaticRoutingHelper staticRouting;
+		stack.SetRoutingHelper(staticRouting);
+	}
+	stack.Install(this->routers);
+	stack.Install(this->senders);
+	stack.Install(this->receivers);
+}
+
+void ParkingLotTopology::addIpAddrToNetDevices(ParkingLotParam params) {
+	for(uint32_t h = 0; h < this->routerLinks.size(); ++h) {
+		Ipv4AddressHelper routerIP(parkingLotRouterLink(h), "255.255.255.252");
+		this->routerLinkIFCs.push_back(routerIP.Assign(this->routerLinks[h]));
+	}
+
+	//leafDevices[r] holds (router, host) pairs in the order they were installed
+	this->leafIFCs.resize(params.numRouters);
+	std::vector<Ipv4AddressHelper> leafIP;
+	for(uint32_t r = 0; r < params.numRouters; ++r) {
+		leafIP.push_back(Ipv4AddressHelper(parkingLotLeafBlock(r), "255.255.255.252"));
+	}
+	std::vector<uint32_t> next(params.numRouters, 0);
+	for(uint32_t i = 0; i < this->senders.GetN(); ++i) {
+		uint32_t r = this->senderRouter[i];
+		NetDeviceContainer link;
+		link.Add(this->leafDevices[r].Get(next[r]));
+		link.Add(this->leafDevices[r].Get(next[r] + 1));
+		next[r] += 2;
+		Ipv4InterfaceContainer ifc = leafIP[r].Assign(link);
+		leafIP[r].NewNetwork();
+		this->leafIFCs[r].Add(ifc);
+		this->senderIFCs.Add(ifc.Get(1));
+
+		r = this->receiverRouter[i];
+		link = NetDeviceContainer();
+		link.Add(this->leafDevices[r].Get(next[r]));
+		link.Add(this->leafDevices[r].Get(next[r] + 1));
+		next[r] += 2;
+		ifc = leafIP[r].Assign(link);
+		leafIP[r].NewNetwork();
+		this->leafIFCs[r].Add(ifc);
+		this->receiverIFCs.Add(ifc.Get(1));
+	}
+}
+
+/*
+	Routes follow from the address plan:
+	- a host has a default route to its router,
+	- router r reaches the leaf block of router q < r through R(r-1) and
+	  of q > r through R(r+1); its own leaf links are directly connected.
+	This is O(K) routes per router and no graph search.
+*/
+void ParkingLotTopology::setStaticRoutes(ParkingLotParam params) {
+	Ipv4StaticRoutingHelper staticRouting;
+	Ipv4Mask blockMask("255.255.192.0");
+
+	for(uint32_t r = 0; r < params.numRouters; ++r) {
+		Ptr<Ipv4> ipv4 = this->routers.Get(r)->GetObject<Ipv4>();
+		Ptr<Ipv4StaticRouting> routing = staticRouting.GetStaticRouting(ipv4);
+		for(uint32_t q = 0; q < params.numRouters; ++q) {
+			if(q == r)
+				continue;
+			//link r-1 -> r: (Rr-1, Rr); link r -> r+1: (Rr, Rr+1)
+			uint32_t hop = q < r ? r - 1 : r;
+			uint32_t self = q < r ? 1 : 0;
+			Ipv4Address nextHop = this->routerLinkIFCs[hop].GetAddress(1 - self);
+			uint32_t interface = ipv4->GetInterfaceForDevice(this->routerLinks[hop].Get(self));
+			routing->AddNetworkRouteTo(parkingLotLeafBlock(q), blockMask, nextHop, interface);
+		}
+	}
+
+	for(uint32_t r = 0; r < params.numRouters; ++r) {
+		for(uint32_t l = 0; l < this->leafIFCs[r].GetN(); l += 2) {
+			Ptr<Ipv4> hostIpv4 = this->leafIFCs[r].Get(l + 1).first;
+			uint32_t interface = this->leafIFCs[r].Get(l + 1).second;
+			staticRouting.GetStaticRouting(hostIpv4)->SetDefaultRoute(this->leafIFCs[r].GetAddress(l), interface);
+		}
+	}
+}
+
+void ParkingLotTopology::addFlows(FlowTable &flowTable) {
+	for(uint32_t i = 0; i < this->senders.GetN(); ++i) {
+		std::string label = i < this->numLongFlows ?
+			"long" + std::to_string(i) : "cross" + std::to_string(this->senderRouter[i]) + "_" + std::to_string(i);
+		flowTable.add(label, this->senderIFCs.GetAddress(i), this->receiverIFCs.GetAddress(i));
+	}
+}
+
+uint32_t ParkingLotTopology::getNumFlows() {
+	return this->senders.GetN();
+}
+
+Ptr<Node> ParkingLotTopology::getSender(uint32_t flow) {
+	return this->senders.Get(flow);
+}
+
+Ptr<Node> ParkingLotTopology::getReceiver(uint32_t flow) {
+	return this->receivers.Get(flow);
+}
+
+Ipv4Address ParkingLotTopology::getReceiverAddress(uint32_t flow) {
+	return this->receiverIFCs.GetAddress(flow);
+}
+
+//Forward-direction device of every hop, i.e. where each bottleneck queue builds up
+NetDeviceContainer ParkingLotTopology::getBottleneckDevices() {
+	NetDeviceContainer devices;
+	for(uint32_t h = 0; h < this->routerLinks.size(); ++h) {
+		devices.Add(this->routerLinks[h].Get(0));
+	}
+	return devices;
+}
+
+NetDeviceContainer ParkingLotTopology::getNetDevices() {
+	NetDeviceContainer devices;
+	for(uint32_t h = 0; h < this->routerLinks.size(); ++h) {
+		devices.Add(this->routerLinks[h]);
+	}
+	devices.Add(this->hostDevices);
+	return devices;
+}
+
+#endif
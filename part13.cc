@@ -1,6 +1,6 @@
 #include "header.h"
 
-int main() 
+int main(int argc, char **argv) 
 {
 	std::cout << "* PART-1 AND PART-3 STARTED *" << std::endl;
 	std::string rateHR = "100Mbps";
@@ -9,16 +9,57 @@ int main()
 	std::string latencyRR = "50ms";
 
 	uint packetSize = 1.2*1024;		//1.2KB
-	uint queueSizeHR = (100000*20)/packetSize;
-	uint queueSizeRR = (10000*50)/packetSize;
+	//One bandwidth-delay product of each link, in packets
+	uint queueSizeHR = bdpPackets(rateHR, Time(latencyHR), packetSize);
+	uint queueSizeRR = bdpPackets(rateRR, Time(latencyRR), packetSize);
 
 	std::string valueHR = std::to_string(queueSizeHR)+"p";
 	std::string valueRR = std::to_string(queueSizeRR)+"p";
 	uint numSender = 3;
 	double errorP = ERROR;
 
+	RunParam runParams("PartA/");
+
+	CommandLine cmd;
+	addRunOptions(cmd, runParams, "traces_a.tmux");
+	cmd.Parse(argc, argv);
+	std::vector<std::string> tcpVariants = checkRunOptions(runParams, numSender);
+	setTcpOptions(runParams.ecnParams);
+
+	SweepAggregator aggregator;
+	if(runParams.liveTable) {
+		aggregator.setOutput(runParams.outDir+"sweep_live.csv", "flows_a.csv");
+		sweepAggregator = &aggregator;
+	}
+
+	//Bandwidth-delay product of the path in bytes: bottleneck rate times the base RTT
+	Time rtt = Seconds(2*(2*Time(latencyHR).GetSeconds() + Time(latencyRR).GetSeconds()));
+	uint32_t pathBdp = DataRate(rateRR).GetBitRate()*rtt.GetSeconds()/8;
+	flowSocketParams = parseSocketParams(runParams.segmentSizes, runParams.sndBufs, runParams.rcvBufs, runParams.initialCwnds, numSender, packetSize, 2*pathBdp);
+	if(!runParams.socketSweepList.empty())
+		return runSocketSweep(argc, argv, parseBdpMultiples(runParams.socketSweepList), pathBdp, flowSocketParams[0].segmentSize,
+			DataRate(rateRR).GetBitRate()/1024.0, runParams.parallel, runParams.outDir, "flows_a.csv", runParams.cacheDir);
+
+	if(runParams.replicas > 1 || !runParams.cacheDir.empty())
+		return runReplicas(argc, argv, runParams.replicas, runParams.parallel, runParams.run, runParams.outDir, "flows_a.csv", runParams.cacheDir);
+	SystemPath::MakeDirectories(runParams.outDir);
+	setRngStream(runParams.seed, runParams.run);
+
+	TcpStateSampler sampler;
+	if(!runParams.shmName.empty()) {
+		if(!sampler.open(runParams.shmName, 1 << 16))
+			exit(EXIT_FAILURE);
+		tcpStateSampler = &sampler;
+	}
+
+	RateScheduler scheduler;
+	if(!runParams.rateScheduleFile.empty()) {
+		scheduler.load(runParams.rateScheduleFile, runParams.rateScheduleResolution);
+		rateScheduler = &scheduler;
+	}
+
 	PointToPointHelper p2pHR = configureP2PHelper(rateHR, latencyHR, valueHR);
-	PointToPointHelper p2pRR = configureP2PHelper(rateRR, latencyRR, valueRR);;
+	PointToPointHelper p2pRR = configureP2PHelper(rateRR, latencyRR, isQueueDiscEnabled(runParams.queueDisc) ? BOTTLENECK_DEVICE_QUEUE : valueRR);
 	Ptr<RateErrorModel> em = CreateObjectWithAttributes<RateErrorModel> ("ErrorRate", DoubleValue (errorP));
 
 	//Empty node containers
@@ -70,6 +111,12 @@ int main()
 	stack.Install(receivers);
 	std::cout<<"done"<< std::endl;
 
+	//Bottleneck queue disc, must be in place before addresses are assigned
+	if(isQueueDiscEnabled(runParams.queueDisc)) {
+		setEcnMarking(runParams.ecnParams);
+		installBottleneckQueueDisc(routerDevices, runParams.queueDisc, valueRR);
+	}
+
 	//Adding IP addresses
 	std::cout << "Assigning IP addresses...";
 	Ipv4AddressHelper routerIP = Ipv4AddressHelper("10.3.0.0", "255.255.255.0");	//(network, mask)
@@ -107,6 +154,18 @@ int main()
 
 	std::cout<<"done"<< std::endl;
 
+	//Flows of this run (H1->H4, H2->H5, H3->H6), for drop accounting and result export
+	FlowTable flowTable;
+	for(uint i = 0; i < numSender; ++i) {
+		flowTable.add(tcpVariants[i], senderIFCs.GetAddress(i), receiverIFCs.GetAddress(i));
+	}
+	DropAccounting dropAccounting(&flowTable);
+	dropAccounting.installDevices(routerDevices);
+	dropAccounting.installDevices(leftRouterDevices);
+	dropAccounting.installDevices(rightRouterDevices);
+	dropAccounting.installDevices(senderDevices);
+	dropAccounting.installDevices(receiverDevices);
+
 	/*
 		Measuring Performance of each TCP variant
 	*/
@@ -124,22 +183,27 @@ int main()
 	double netDuration = 0;
 	uint port = 9000;
 	uint numPackets = 10000000;
-	std::string transferSpeed = "400Mbps";	
 
 	//TCP Reno from H1 to H4
-	std::cout<<"** TCP Hybla from H1 to H4 **"<<std::endl;
-	AsciiTraceHelper asciiTraceHelper;
-	Ptr<OutputStreamWrapper> h1cw = asciiTraceHelper.CreateFileStream("PartA/data_hybla_a.cw");
-	Ptr<OutputStreamWrapper> h1cl = asciiTraceHelper.CreateFileStream("PartA/hybla_a.cl");
-	Ptr<OutputStreamWrapper> h1tp = asciiTraceHelper.CreateFileStream("PartA/data_hybla_a.tp");
-	Ptr<OutputStreamWrapper> h1gp = asciiTraceHelper.CreateFileStream("PartA/data_hybla_a.gp");
-	Ptr<Socket> ns3TcpSocket1 = uniFlow(InetSocketAddress(receiverIFCs.GetAddress(0), port), port, "TcpHybla", senders.Get(0), receivers.Get(0), netDuration, netDuration+durationGap, packetSize, numPackets, transferSpeed, netDuration, netDuration+durationGap);
+	std::cout<<"** "<<tcpVariants[0]<<" from H1 to H4 **"<<std::endl;
+	TraceFiles traceFiles;
+	traceFiles.setCompression(runParams.compressTraces, 1e-9, runParams.traceMantissaBits, runParams.traceDeadband);
+	if(runParams.muxTraces)
+		traceFiles.setMultiplexed(runParams.outDir+"traces_a.tmux");
+	Ptr<OutputStreamWrapper> h1cw = traceFiles.create(runParams.outDir+"data_"+variantFileStem(tcpVariants, 0)+"_a.cw");
+	Ptr<OutputStreamWrapper> h1cl = traceFiles.createText(runParams.outDir+variantFileStem(tcpVariants, 0)+"_a.cl");
+	Ptr<OutputStreamWrapper> h1tp = traceFiles.create(runParams.outDir+"data_"+variantFileStem(tcpVariants, 0)+"_a.tp");
+	Ptr<OutputStreamWrapper> h1gp = traceFiles.create(runParams.outDir+"data_"+variantFileStem(tcpVariants, 0)+"_a.gp");
+	Ptr<Socket> ns3TcpSocket1 = uniFlow(InetSocketAddress(receiverIFCs.GetAddress(0), port), port, tcpVariants[0], senders.Get(0), receivers.Get(0), netDuration, netDuration+durationGap, packetSize, numPackets, runParams.transferSpeed, netDuration, netDuration+durationGap);
 	ns3TcpSocket1->TraceConnectWithoutContext("CongestionWindow", MakeBoundCallback (&CwndChange, h1cw, netDuration));
-	ns3TcpSocket1->TraceConnectWithoutContext("Drop", MakeBoundCallback (&packetDrop, h1cl, netDuration, 1));
+	dropAccounting.installSocket(ns3TcpSocket1, 0);
 
 	// Measure PacketSinks
 	std::string sink = "/NodeList/5/ApplicationList/0/$ns3::PacketSink/Rx";
-	Config::Connect(sink, MakeBoundCallback(&ReceivedPacket, h1gp, netDuration));
+	if(countingSinks)
+		startSinkSampling(receivers.Get(0), h1gp, netDuration, runParams.sinkSampleInterval, netDuration+durationGap);
+	else
+		Config::Connect(sink, MakeBoundCallback(&ReceivedPacket, h1gp, netDuration));
 
 	std::string sink_ = "/NodeList/5/$ns3::Ipv4L3Protocol/Rx";
 	Config::Connect(sink_, MakeBoundCallback(&ReceivedPacketIPV4, h1tp, netDuration));
@@ -148,33 +212,39 @@ int main()
 
 
 	//TCP Westwood from H2 to H5
-	std::cout<<"** TCP Westwood from H2 to H5 **"<<std::endl;
-	Ptr<OutputStreamWrapper> h2cw = asciiTraceHelper.CreateFileStream("PartA/data_westwood_a.cw");
-	Ptr<OutputStreamWrapper> h2cl = asciiTraceHelper.CreateFileStream("PartA/westwood_a.cl");
-	Ptr<OutputStreamWrapper> h2tp = asciiTraceHelper.CreateFileStream("PartA/data_westwood_a.tp");
-	Ptr<OutputStreamWrapper> h2gp = asciiTraceHelper.CreateFileStream("PartA/data_westwood_a.gp");
-	Ptr<Socket> ns3TcpSocket2 = uniFlow(InetSocketAddress(receiverIFCs.GetAddress(1), port), port, "TcpWestwood", senders.Get(1), receivers.Get(1), netDuration, netDuration+durationGap, packetSize, numPackets, transferSpeed, netDuration, netDuration+durationGap);
+	std::cout<<"** "<<tcpVariants[1]<<" from H2 to H5 **"<<std::endl;
+	Ptr<OutputStreamWrapper> h2cw = traceFiles.create(runParams.outDir+"data_"+variantFileStem(tcpVariants, 1)+"_a.cw");
+	Ptr<OutputStreamWrapper> h2cl = traceFiles.createText(runParams.outDir+variantFileStem(tcpVariants, 1)+"_a.cl");
+	Ptr<OutputStreamWrapper> h2tp = traceFiles.create(runParams.outDir+"data_"+variantFileStem(tcpVariants, 1)+"_a.tp");
+	Ptr<OutputStreamWrapper> h2gp = traceFiles.create(runParams.outDir+"data_"+variantFileStem(tcpVariants, 1)+"_a.gp");
+	Ptr<Socket> ns3TcpSocket2 = uniFlow(InetSocketAddress(receiverIFCs.GetAddress(1), port), port, tcpVariants[1], senders.Get(1), receivers.Get(1), netDuration, netDuration+durationGap, packetSize, numPackets, runParams.transferSpeed, netDuration, netDuration+durationGap);
 	ns3TcpSocket2->TraceConnectWithoutContext("CongestionWindow", MakeBoundCallback (&CwndChange, h2cw, netDuration));
-	ns3TcpSocket2->TraceConnectWithoutContext("Drop", MakeBoundCallback (&packetDrop, h2cl, netDuration, 2));
+	dropAccounting.installSocket(ns3TcpSocket2, 1);
 
 	sink = "/NodeList/6/ApplicationList/0/$ns3::PacketSink/Rx";
-	Config::Connect(sink, MakeBoundCallback(&ReceivedPacket, h2gp, netDuration));
+	if(countingSinks)
+		startSinkSampling(receivers.Get(1), h2gp, netDuration, runParams.sinkSampleInterval, netDuration+durationGap);
+	else
+		Config::Connect(sink, MakeBoundCallback(&ReceivedPacket, h2gp, netDuration));
 	sink_ = "/NodeList/6/$ns3::Ipv4L3Protocol/Rx";
 	Config::Connect(sink_, MakeBoundCallback(&ReceivedPacketIPV4, h2tp, netDuration));
 	netDuration += durationGap;
 
 	//TCP Fack from H3 to H6
-	std::cout<<"** TCP Yeah from H3 to H6 **"<<std::endl;
-	Ptr<OutputStreamWrapper> h3cw = asciiTraceHelper.CreateFileStream("PartA/data_yeah_a.cw");
-	Ptr<OutputStreamWrapper> h3cl = asciiTraceHelper.CreateFileStream("PartA/yeah_a.cl");
-	Ptr<OutputStreamWrapper> h3tp = asciiTraceHelper.CreateFileStream("PartA/data_yeah_a.tp");
-	Ptr<OutputStreamWrapper> h3gp = asciiTraceHelper.CreateFileStream("PartA/data_yeah_a.gp");
-	Ptr<Socket> ns3TcpSocket3 = uniFlow(InetSocketAddress(receiverIFCs.GetAddress(2), port), port, "TcpYeah", senders.Get(2), receivers.Get(2), netDuration, netDuration+durationGap, packetSize, numPackets, transferSpeed, netDuration, netDuration+durationGap);
+	std::cout<<"** "<<tcpVariants[2]<<" from H3 to H6 **"<<std::endl;
+	Ptr<OutputStreamWrapper> h3cw = traceFiles.create(runParams.outDir+"data_"+variantFileStem(tcpVariants, 2)+"_a.cw");
+	Ptr<OutputStreamWrapper> h3cl = traceFiles.createText(runParams.outDir+variantFileStem(tcpVariants, 2)+"_a.cl");
+	Ptr<OutputStreamWrapper> h3tp = traceFiles.create(runParams.outDir+"data_"+variantFileStem(tcpVariants, 2)+"_a.tp");
+	Ptr<OutputStreamWrapper> h3gp = traceFiles.create(runParams.outDir+"data_"+variantFileStem(tcpVariants, 2)+"_a.gp");
+	Ptr<Socket> ns3TcpSocket3 = uniFlow(InetSocketAddress(receiverIFCs.GetAddress(2), port), port, tcpVariants[2], senders.Get(2), receivers.Get(2), netDuration, netDuration+durationGap, packetSize, numPackets, runParams.transferSpeed, netDuration, netDuration+durationGap);
 	ns3TcpSocket3->TraceConnectWithoutContext("CongestionWindow", MakeBoundCallback (&CwndChange, h3cw, netDuration));
-	ns3TcpSocket3->TraceConnectWithoutContext("Drop", MakeBoundCallback (&packetDrop, h3cl, netDuration, 3));
+	dropAccounting.installSocket(ns3TcpSocket3, 2);
 
 	sink = "/NodeList/7/ApplicationList/0/$ns3::PacketSink/Rx";
-	Config::Connect(sink, MakeBoundCallback(&ReceivedPacket, h3gp, netDuration));
+	if(countingSinks)
+		startSinkSampling(receivers.Get(2), h3gp, netDuration, runParams.sinkSampleInterval, netDuration+durationGap);
+	else
+		Config::Connect(sink, MakeBoundCallback(&ReceivedPacket, h3gp, netDuration));
 	sink_ = "/NodeList/7/$ns3::Ipv4L3Protocol/Rx";
 	Config::Connect(sink_, MakeBoundCallback(&ReceivedPacketIPV4, h3tp, netDuration));
 	netDuration += durationGap;
@@ -187,61 +257,69 @@ int main()
 	Ipv4GlobalRoutingHelper::PopulateRoutingTables();
 	std::cout<<"done"<< std::endl;
 
+	//Queue occupancy and sojourn time of R1 towards R2
+	Ptr<OutputStreamWrapper> bottleneckQs = traceFiles.createText(runParams.outDir+"bottleneck_a.qs");
+	QueueMonitor bottleneckMonitor;
+	bottleneckMonitor.install(routerDevices.Get(0), bottleneckQs, runParams.queueSampleInterval, 0, netDuration);
+
 	std::cout<<"Setting up FlowMonitor...";
 	Ptr<FlowMonitor> flowmon;
 	FlowMonitorHelper flowmonHelper;
-	flowmon = flowmonHelper.InstallAll();
+	flowmon = installFlowMonitor(flowmonHelper, runParams.probeConfig, routers, senders, receivers);
 	Simulator::Stop(Seconds(netDuration));
 	std::cout<<"done"<< std::endl;
 
 	std::cout<<"Starting Simulation"<< std::endl;
 
+	//After the last SetDefault (AQM and ECN ones included)
+	writeReplayRecord(runParams.outDir, runParams.seed, runParams.run, argc, argv);
+	scheduler.start();
 	Simulator::Run();
+	sampler.finish();
+	std::cout<<"Simulator events: "<<Simulator::GetEventCount()<< std::endl;
 	std::cout<<"Checking for lost packets...";
 	flowmon->CheckForLostPackets();
 	std::cout<<"done"<< std::endl;
 
-	//Ptr<OutputStreamWrapper> streamTP = asciiTraceHelper.CreateFileStream("application_6_a.tp");
 	Ptr<Ipv4FlowClassifier> classifier = DynamicCast<Ipv4FlowClassifier>(flowmonHelper.GetClassifier());
-	std::map<FlowId, FlowMonitor::FlowStats> stats = flowmon->GetFlowStats();
-	for (std::map<FlowId, FlowMonitor::FlowStats>::const_iterator i = stats.begin(); i != stats.end(); ++i) {
-		Ipv4FlowClassifier::FiveTuple t = classifier->FindFlow (i->first);
-		/*
-		*streamTP->GetStream()  << "Flow " << i->first  << " (" << t.sourceAddress << " -> " << t.destinationAddress << ")\n";
-		*streamTP->GetStream()  << "  Tx Bytes:   " << i->second.txBytes << "\n";
-		*streamTP->GetStream()  << "  Rx Bytes:   " << i->second.rxBytes << "\n";
-		*streamTP->GetStream()  << "  Time        " << i->second.timeLastRxPacket.GetSeconds() - i->second.timeFirstTxPacket.GetSeconds() << "\n";
-		*streamTP->GetStream()  << "  Throughput: " << i->second.rxBytes * 8.0 / (i->second.timeLastRxPacket.GetSeconds() - i->second.timeFirstTxPacket.GetSeconds())/1024/1024  << " Mbps\n";	
-		*/
-		if(t.sourceAddress == "10.1.0.1") {
-			if(mapDrop.find(1)==mapDrop.end())
-				mapDrop[1] = 0;
-			*h1cl->GetStream() << "TcpHybla Flow " << i->first  << " (" << t.sourceAddress << " -> " << t.destinationAddress << ")\n";
-			*h1cl->GetStream()  << "Net Packet Lost: " << i->second.lostPackets << "\n";
-			*h1cl->GetStream()  << "Packet Lost due to buffer overflow: " << mapDrop[1] << "\n";
-			*h1cl->GetStream()  << "Packet Lost due to Congestion: " << i->second.lostPackets - mapDrop[1] << "\n";
-			*h1cl->GetStream() << "Max throughput: " << mapMaxThroughput["/NodeList/5/$ns3::Ipv4L3Protocol/Rx"] << std::endl;
-		} else if(t.sourceAddress == "10.1.1.1") {
-			if(mapDrop.find(2)==mapDrop.end())
-				mapDrop[2] = 0;
-			*h2cl->GetStream() << "Tcp Westwood Flow " << i->first  << " (" << t.sourceAddress << " -> " << t.destinationAddress << ")\n";
-			*h2cl->GetStream()  << "Net Packet Lost: " << i->second.lostPackets << "\n";
-			*h2cl->GetStream()  << "Packet Lost due to buffer overflow: " << mapDrop[2] << "\n";
-			*h2cl->GetStream()  << "Packet Lost due to Congestion: " << i->second.lostPackets - mapDrop[2] << "\n";
-			*h2cl->GetStream() << "Max throughput: " << mapMaxThroughput["/NodeList/6/$ns3::Ipv4L3Protocol/Rx"] << std::endl;
-		} else if(t.sourceAddress == "10.1.2.1") {
-			if(mapDrop.find(3)==mapDrop.end())
-				mapDrop[3] = 0;
-			*h3cl->GetStream() << "Tcp Fack Flow " << i->first  << " (" << t.sourceAddress << " -> " << t.destinationAddress << ")\n";
-			*h3cl->GetStream()  << "Net Packet Lost: " << i->second.lostPackets << "\n";
-			*h3cl->GetStream()  << "Packet Lost due to buffer overflow: " << mapDrop[3] << "\n";
-			*h3cl->GetStream()  << "Packet Lost due to Congestion: " << i->second.lostPackets - mapDrop[3] << "\n";
-			*h3cl->GetStream() << "Max throughput: " << mapMaxThroughput["/NodeList/7/$ns3::Ipv4L3Protocol/Rx"] << std::endl;
-		}
+	FlowExporter flowExporter(&flowTable);
+	flowExporter.collect(flowmon, classifier);
+	flowExporter.attachDrops(&dropAccounting);
+	for(uint i = 0; i < numSender; ++i) {
+		flowExporter.setAppBytes(i, sinkTotalRx(receivers.Get(i)->GetApplication(0)));
+	}
+	flowExporter.writeCsv(runParams.outDir+"flows_a.csv");
+	if(!runParams.aggregateName.empty() && !flowExporter.publish(runParams.aggregateName, runParams.aggregateKey))
+		std::cerr << "Cannot reach the sweep table " << runParams.aggregateName << std::endl;
+	std::vector<double> mss, wmax;
+	for(uint i = 0; i < numSender; ++i) {
+		mss.push_back(flowSocketParams[i].segmentSize);
+		wmax.push_back((double)flowSocketParams[i].rcvBuf/flowSocketParams[i].segmentSize);
 	}
+	//T0 = 1 s, the MinRto of ns-3, which the RTTs here never exceed
+	flowExporter.checkModels(runParams.outDir+"model_check_a.csv", mss, wmax, rtt.GetSeconds(), 1, runParams.modelTolerance, std::cout);
+
+	Ptr<OutputStreamWrapper> clStreams[] = {h1cl, h2cl, h3cl};
+	for(uint i = 0; i < numSender; ++i) {
+		const FlowEntry &e = flowTable.get(i);
+		const FlowResult &r = flowExporter.get(i);
+		if(!r.found)
+			continue;
+		std::string context = "/NodeList/"+std::to_string(receivers.Get(i)->GetId())+"/$ns3::Ipv4L3Protocol/Rx";
+		*clStreams[i]->GetStream() << e.label << " Flow " << r.flowId << " (" << e.source << " -> " << e.destination << ")\n";
+		*clStreams[i]->GetStream() << "Net Packet Lost: " << r.lostPackets << "\n";
+		dropAccounting.report(i, *clStreams[i]->GetStream());
+		*clStreams[i]->GetStream() << "Goodput (Kbps): " << r.goodput << "\n";
+		*clStreams[i]->GetStream() << "Max throughput: " << mapMaxThroughput[context] << std::endl;
+	}
+
+	*bottleneckQs->GetStream() << "# Bottleneck queue disc: " << runParams.queueDisc << "\n";
+	std::cout << "Bottleneck queue (" << runParams.queueDisc << ")" << std::endl;
+	bottleneckMonitor.report(std::cout);
+	traceFiles.close();
 
 	//flowmon->SerializeToXmlFile("application_6_a.flowmon", true, true);
-	std::cout << "Simulation finished! Find the data in PartA folder" << std::endl;
+	std::cout << "Simulation finished! Find the data in " << runParams.outDir << std::endl;
 	Simulator::Destroy();
 	return 0;
 }
\ No newline at end of file
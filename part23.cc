@@ -42,7 +42,7 @@ Senders	|	H2------R1------R2-----H5	 |	Receivers
 */
 #include "header.h"
 
-int main() 
+int main(int argc, char **argv) 
 {
 	std::cout << "* PART-2 AND PART-3 STARTED *" << std::endl;
 	std::string rateHR = "100Mbps";
@@ -51,10 +51,12 @@ int main()
 	std::string latencyRR = "50ms";
 
 	uint packetSize = 1.3*1024;		//1.2KB
-	uint queueSizeHR = (100000*20)/packetSize;
+	//One bandwidth-delay product of each link, in packets
+	uint queueSizeHR = bdpPackets(rateHR, Time(latencyHR), packetSize);
 	// uint queueSizeHR = 0;
-	uint queueSizeRR = (10000*50)/packetSize;
+	uint queueSizeRR = bdpPackets(rateRR, Time(latencyRR), packetSize);
 	// uint queueSizeRR = 0;
+	uint32_t bottleneckBuffer = 0;
 
 	std::string valueHR = std::to_string(queueSizeHR)+"p";
 	std::string valueRR = std::to_string(queueSizeRR)+"p";
@@ -62,6 +64,84 @@ int main()
 	uint numSender = 3;
 
 	double errorP = ERROR;
+	bool streaming = false;
+	double rollInterval = 600;
+	uint32_t rollKeep = 0;
+	double snapshotInterval = 60;
+	double rssTolerance = 10;
+	std::string matrixList = "";
+	std::string sizingList = "";
+	double sizingMin = 0.05, sizingMax = 4;
+	uint32_t sizingRounds = 3;
+	double sizingDuration = 30;
+	double durationGap = 100;
+	double otherFlowStart = 20;
+
+	RunParam runParams("PartB/");
+
+	CommandLine cmd;
+	addRunOptions(cmd, runParams, "traces_b.tmux");
+	cmd.AddValue("streaming", "Long-run mode: unlimited flows, rolling traces and periodic FlowMonitor snapshots (flows_b_windows.csv)", streaming);
+	cmd.AddValue("rollInterval", "Streaming: simulated seconds per trace file", rollInterval);
+	cmd.AddValue("rollKeep", "Streaming: trace files kept per trace, 0 for all", rollKeep);
+	cmd.AddValue("snapshotInterval", "Streaming: FlowMonitor snapshot and reset interval (s)", snapshotInterval);
+	cmd.AddValue("rssTolerance", "Streaming: RSS growth after the first snapshot (%) above which the run fails", rssTolerance);
+	cmd.AddValue("matrix", "Run every assignment of these variants (or all) to the senders and report pairwise fairness", matrixList);
+	cmd.AddValue("sizing", "Search the bottleneck buffer at the throughput/delay knee for each of these variants (or all)", sizingList);
+	cmd.AddValue("sizingMin", "Smallest buffer searched, in path bandwidth-delay products", sizingMin);
+	cmd.AddValue("sizingMax", "Largest buffer searched, in path bandwidth-delay products", sizingMax);
+	cmd.AddValue("sizingRounds", "Rounds of the buffer search", sizingRounds);
+	cmd.AddValue("sizingDuration", "Length of each buffer search run (s)", sizingDuration);
+	cmd.AddValue("bottleneckBuffer", "Bottleneck buffer (packets), 0 for one bandwidth-delay product of the R1-R2 link", bottleneckBuffer);
+	cmd.AddValue("duration", "Length of each flow (s)", durationGap);
+	cmd.AddValue("otherFlowStart", "Start time of the H2 and H3 flows (s)", otherFlowStart);
+	cmd.Parse(argc, argv);
+	std::vector<std::string> tcpVariants = checkRunOptions(runParams, numSender);
+	setTcpOptions(runParams.ecnParams);
+
+	SweepAggregator aggregator;
+	if(runParams.liveTable) {
+		aggregator.setOutput(runParams.outDir+"sweep_live.csv", "flows_b.csv");
+		sweepAggregator = &aggregator;
+	}
+
+	//Bandwidth-delay product of the path in bytes: bottleneck rate times the base RTT
+	Time rtt = Seconds(2*(2*Time(latencyHR).GetSeconds() + Time(latencyRR).GetSeconds()));
+	uint32_t pathBdp = DataRate(rateRR).GetBitRate()*rtt.GetSeconds()/8;
+	flowSocketParams = parseSocketParams(runParams.segmentSizes, runParams.sndBufs, runParams.rcvBufs, runParams.initialCwnds, numSender, packetSize, 2*pathBdp);
+	if(!runParams.socketSweepList.empty())
+		return runSocketSweep(argc, argv, parseBdpMultiples(runParams.socketSweepList), pathBdp, flowSocketParams[0].segmentSize,
+			DataRate(rateRR).GetBitRate()/1024.0, runParams.parallel, runParams.outDir, "flows_b.csv", runParams.cacheDir);
+
+	if(!matrixList.empty())
+		return runVariantMatrix(argc, argv, parseVariantList(matrixList), numSender, runParams.parallel, runParams.outDir, "flows_b.csv", runParams.cacheDir);
+	if(!sizingList.empty()) {
+		//Knee buffers are in units of the bottleneck rate times the base RTT of the path
+		return runBufferSizing(argc, argv, parseVariantList(sizingList), numSender, bdpPackets(rateRR, rtt, packetSize),
+			DataRate(rateRR).GetBitRate()/1024.0, sizingMin, sizingMax, sizingRounds, sizingDuration, runParams.parallel, runParams.outDir, "flows_b.csv", runParams.cacheDir);
+	}
+	if(bottleneckBuffer > 0) {
+		queueSizeRR = bottleneckBuffer;
+		valueRR = std::to_string(queueSizeRR)+"p";
+	}
+
+	if(runParams.replicas > 1 || !runParams.cacheDir.empty())
+		return runReplicas(argc, argv, runParams.replicas, runParams.parallel, runParams.run, runParams.outDir, "flows_b.csv", runParams.cacheDir);
+	SystemPath::MakeDirectories(runParams.outDir);
+	setRngStream(runParams.seed, runParams.run);
+
+	TcpStateSampler sampler;
+	if(!runParams.shmName.empty()) {
+		if(!sampler.open(runParams.shmName, 1 << 16))
+			exit(EXIT_FAILURE);
+		tcpStateSampler = &sampler;
+	}
+
+	RateScheduler scheduler;
+	if(!runParams.rateScheduleFile.empty()) {
+		scheduler.load(runParams.rateScheduleFile, runParams.rateScheduleResolution);
+		rateScheduler = &scheduler;
+	}
 
 
 	// Config::Set("ns3::DropTailQueue::Mode", StringValue("QUEUE_MODE_PACKETS"));
@@ -72,7 +152,7 @@ int main()
 	//Creating channel without IP address
 	std::cout << "Creating channel without IP address" << std::endl;
 	PointToPointHelper p2pHR = configureP2PHelper(rateHR, latencyHR, valueHR);
-	PointToPointHelper p2pRR = configureP2PHelper(rateRR, latencyRR, valueRR);;
+	PointToPointHelper p2pRR = configureP2PHelper(rateRR, latencyRR, isQueueDiscEnabled(runParams.queueDisc) ? BOTTLENECK_DEVICE_QUEUE : valueRR);
 	
 	//Adding some errorrate
 	std::cout << "Adding some errorrate" << std::endl;
@@ -117,6 +197,12 @@ int main()
 	stack.Install(receivers);
 	std::cout<<"done"<< std::endl;
 
+	//Bottleneck queue disc, must be in place before addresses are assigned
+	if(isQueueDiscEnabled(runParams.queueDisc)) {
+		setEcnMarking(runParams.ecnParams);
+		installBottleneckQueueDisc(routerDevices, runParams.queueDisc, valueRR);
+	}
+
 	//Adding IP addresses
 	std::cout << "Assigning IP addresses..." << std::endl;
 	Ipv4AddressHelper routerIP = Ipv4AddressHelper("10.3.0.0", "255.255.255.0");
@@ -145,6 +231,19 @@ int main()
 		receiverIP.NewNetwork();
 	}
 	std::cout<<"done"<< std::endl;
+
+	//Flows of this run (H1->H4, H2->H5, H3->H6), for drop accounting and result export
+	FlowTable flowTable;
+	for(uint i = 0; i < numSender; ++i) {
+		flowTable.add(tcpVariants[i], senderIFCs.GetAddress(i), receiverIFCs.GetAddress(i));
+	}
+	DropAccounting dropAccounting(&flowTable);
+	dropAccounting.installDevices(routerDevices);
+	dropAccounting.installDevices(leftRouterDevices);
+	dropAccounting.installDevices(rightRouterDevices);
+	dropAccounting.installDevices(senderDevices);
+	dropAccounting.installDevices(receiverDevices);
+
 	/********************************************************************
 	PART (b)
 	********************************************************************/
@@ -153,58 +252,69 @@ int main()
 		and then measure throughput and CWND of each flow at steady state
 		2)Also find the max throuhput per flow
 	********************************************************************/
-	double durationGap = 100;
 	double oneFlowStart = 0;
-	double otherFlowStart = 20;
 	uint port = 9000;
-	uint numPackets = 10000000;
-	std::string transferSpeed = "400Mbps";
+	uint numPackets = streaming ? 0 : 10000000;
 		
 	
 	//TCP Reno from H1 to H4
-	std::cout << "** TCP Hybla from H1 to H4" << std::endl;
-	AsciiTraceHelper asciiTraceHelper;
-	Ptr<OutputStreamWrapper> h1cw = asciiTraceHelper.CreateFileStream("PartB/data_hybla_b.cwnd");
-	Ptr<OutputStreamWrapper> h1cl = asciiTraceHelper.CreateFileStream("PartB/hybla_b.cl");
-	Ptr<OutputStreamWrapper> h1tp = asciiTraceHelper.CreateFileStream("PartB/data_hybla_b.tp");
-	Ptr<OutputStreamWrapper> h1gp = asciiTraceHelper.CreateFileStream("PartB/data_hybla_b.gp");
-	Ptr<Socket> ns3TcpSocket1 = uniFlow(InetSocketAddress(receiverIFCs.GetAddress(0), port), port, "TcpHybla", senders.Get(0), receivers.Get(0), oneFlowStart, oneFlowStart+durationGap, packetSize, numPackets, transferSpeed, oneFlowStart, oneFlowStart+durationGap);
+	std::cout << "** " << tcpVariants[0] << " from H1 to H4" << std::endl;
+	TraceFiles traceFiles;
+	traceFiles.setCompression(runParams.compressTraces, 1e-9, runParams.traceMantissaBits, runParams.traceDeadband);
+	if(runParams.muxTraces)
+		traceFiles.setMultiplexed(runParams.outDir+"traces_b.tmux");
+	if(streaming)
+		traceFiles.setRolling(rollInterval, rollKeep);
+	Ptr<OutputStreamWrapper> h1cw = traceFiles.create(runParams.outDir+"data_"+variantFileStem(tcpVariants, 0)+"_b.cwnd");
+	Ptr<OutputStreamWrapper> h1cl = traceFiles.createText(runParams.outDir+variantFileStem(tcpVariants, 0)+"_b.cl");
+	Ptr<OutputStreamWrapper> h1tp = traceFiles.create(runParams.outDir+"data_"+variantFileStem(tcpVariants, 0)+"_b.tp");
+	Ptr<OutputStreamWrapper> h1gp = traceFiles.create(runParams.outDir+"data_"+variantFileStem(tcpVariants, 0)+"_b.gp");
+	Ptr<Socket> ns3TcpSocket1 = uniFlow(InetSocketAddress(receiverIFCs.GetAddress(0), port), port, tcpVariants[0], senders.Get(0), receivers.Get(0), oneFlowStart, oneFlowStart+durationGap, packetSize, numPackets, runParams.transferSpeed, oneFlowStart, oneFlowStart+durationGap);
 	ns3TcpSocket1->TraceConnectWithoutContext("CongestionWindow", MakeBoundCallback (&CwndChange, h1cw, 0));
-	ns3TcpSocket1->TraceConnectWithoutContext("Drop", MakeBoundCallback (&packetDrop, h1cl, 0, 1));
+	dropAccounting.installSocket(ns3TcpSocket1, 0);
 
 
 	std::string sink = "/NodeList/5/ApplicationList/0/$ns3::PacketSink/Rx";
-	Config::Connect(sink, MakeBoundCallback(&ReceivedPacket, h1gp, 0));
+	if(countingSinks)
+		startSinkSampling(receivers.Get(0), h1gp, 0, runParams.sinkSampleInterval, oneFlowStart+durationGap);
+	else
+		Config::Connect(sink, MakeBoundCallback(&ReceivedPacket, h1gp, 0));
 	std::string sink_ = "/NodeList/5/$ns3::Ipv4L3Protocol/Rx";
 	Config::Connect(sink_, MakeBoundCallback(&ReceivedPacketIPV4, h1tp, 0));
 
 	//TCP Westwood from H2 to H5
-	std::cout << "** TCP Westwood from H2 to H5" << std::endl;
-	Ptr<OutputStreamWrapper> h2cw = asciiTraceHelper.CreateFileStream("PartB/data_westwood_b.cw");
-	Ptr<OutputStreamWrapper> h2cl = asciiTraceHelper.CreateFileStream("PartB/westwood_b.cl");
-	Ptr<OutputStreamWrapper> h2tp = asciiTraceHelper.CreateFileStream("PartB/data_westwood_b.tp");
-	Ptr<OutputStreamWrapper> h2gp = asciiTraceHelper.CreateFileStream("PartB/data_westwood_b.gp");
-	Ptr<Socket> ns3TcpSocket2 = uniFlow(InetSocketAddress(receiverIFCs.GetAddress(1), port), port, "TcpWestwood", senders.Get(1), receivers.Get(1), otherFlowStart, otherFlowStart+durationGap, packetSize, numPackets, transferSpeed, otherFlowStart, otherFlowStart+durationGap);
+	std::cout << "** " << tcpVariants[1] << " from H2 to H5" << std::endl;
+	Ptr<OutputStreamWrapper> h2cw = traceFiles.create(runParams.outDir+"data_"+variantFileStem(tcpVariants, 1)+"_b.cw");
+	Ptr<OutputStreamWrapper> h2cl = traceFiles.createText(runParams.outDir+variantFileStem(tcpVariants, 1)+"_b.cl");
+	Ptr<OutputStreamWrapper> h2tp = traceFiles.create(runParams.outDir+"data_"+variantFileStem(tcpVariants, 1)+"_b.tp");
+	Ptr<OutputStreamWrapper> h2gp = traceFiles.create(runParams.outDir+"data_"+variantFileStem(tcpVariants, 1)+"_b.gp");
+	Ptr<Socket> ns3TcpSocket2 = uniFlow(InetSocketAddress(receiverIFCs.GetAddress(1), port), port, tcpVariants[1], senders.Get(1), receivers.Get(1), otherFlowStart, otherFlowStart+durationGap, packetSize, numPackets, runParams.transferSpeed, otherFlowStart, otherFlowStart+durationGap);
 	ns3TcpSocket2->TraceConnectWithoutContext("CongestionWindow", MakeBoundCallback (&CwndChange, h2cw, 0));
-	ns3TcpSocket2->TraceConnectWithoutContext("Drop", MakeBoundCallback (&packetDrop, h2cl, 0, 2));
+	dropAccounting.installSocket(ns3TcpSocket2, 1);
 
 	sink = "/NodeList/6/ApplicationList/0/$ns3::PacketSink/Rx";
-	Config::Connect(sink, MakeBoundCallback(&ReceivedPacket, h2gp, 0));
+	if(countingSinks)
+		startSinkSampling(receivers.Get(1), h2gp, 0, runParams.sinkSampleInterval, otherFlowStart+durationGap);
+	else
+		Config::Connect(sink, MakeBoundCallback(&ReceivedPacket, h2gp, 0));
 	sink_ = "/NodeList/6/$ns3::Ipv4L3Protocol/Rx";
 	Config::Connect(sink_, MakeBoundCallback(&ReceivedPacketIPV4, h2tp, 0));
 
 	//TCP Fack from H3 to H6
-	std::cout << "** TCP Yeah from H3 to H6" << std::endl;
-	Ptr<OutputStreamWrapper> h3cw = asciiTraceHelper.CreateFileStream("PartB/data_yeah_b.cwnd");
-	Ptr<OutputStreamWrapper> h3cl = asciiTraceHelper.CreateFileStream("PartB/yeah.cl");
-	Ptr<OutputStreamWrapper> h3tp = asciiTraceHelper.CreateFileStream("PartB/data_yeah_b.tp");
-	Ptr<OutputStreamWrapper> h3gp = asciiTraceHelper.CreateFileStream("PartB/data_yeah_b.gp");
-	Ptr<Socket> ns3TcpSocket3 = uniFlow(InetSocketAddress(receiverIFCs.GetAddress(2), port), port, "TcpYeah", senders.Get(2), receivers.Get(2), otherFlowStart, otherFlowStart+durationGap, packetSize, numPackets, transferSpeed, otherFlowStart, otherFlowStart+durationGap);
+	std::cout << "** " << tcpVariants[2] << " from H3 to H6" << std::endl;
+	Ptr<OutputStreamWrapper> h3cw = traceFiles.create(runParams.outDir+"data_"+variantFileStem(tcpVariants, 2)+"_b.cwnd");
+	Ptr<OutputStreamWrapper> h3cl = traceFiles.createText(runParams.outDir+variantFileStem(tcpVariants, 2)+".cl");
+	Ptr<OutputStreamWrapper> h3tp = traceFiles.create(runParams.outDir+"data_"+variantFileStem(tcpVariants, 2)+"_b.tp");
+	Ptr<OutputStreamWrapper> h3gp = traceFiles.create(runParams.outDir+"data_"+variantFileStem(tcpVariants, 2)+"_b.gp");
+	Ptr<Socket> ns3TcpSocket3 = uniFlow(InetSocketAddress(receiverIFCs.GetAddress(2), port), port, tcpVariants[2], senders.Get(2), receivers.Get(2), otherFlowStart, otherFlowStart+durationGap, packetSize, numPackets, runParams.transferSpeed, otherFlowStart, otherFlowStart+durationGap);
 	ns3TcpSocket3->TraceConnectWithoutContext("CongestionWindow", MakeBoundCallback (&CwndChange, h3cw, 0));
-	ns3TcpSocket3->TraceConnectWithoutContext("Drop", MakeBoundCallback (&packetDrop, h3cl, 0, 3));
+	dropAccounting.installSocket(ns3TcpSocket3, 2);
 
 	sink = "/NodeList/7/ApplicationList/0/$ns3::PacketSink/Rx";
-	Config::Connect(sink, MakeBoundCallback(&ReceivedPacket, h3gp, 0));
+	if(countingSinks)
+		startSinkSampling(receivers.Get(2), h3gp, 0, runParams.sinkSampleInterval, otherFlowStart+durationGap);
+	else
+		Config::Connect(sink, MakeBoundCallback(&ReceivedPacket, h3gp, 0));
 	sink_ = "/NodeList/7/$ns3::Ipv4L3Protocol/Rx";
 	Config::Connect(sink_, MakeBoundCallback(&ReceivedPacketIPV4, h3tp, 0));
 
@@ -212,54 +322,77 @@ int main()
 	Ipv4GlobalRoutingHelper::PopulateRoutingTables();
 	std::cout<<"done"<< std::endl;
 
+	//Queue occupancy and sojourn time of R1 towards R2. A series, so it rolls in streaming mode;
+	//otherwise text, since compression keeps only one value per line
+	Ptr<OutputStreamWrapper> bottleneckQs = streaming ? traceFiles.create(runParams.outDir+"bottleneck_b.qs") : traceFiles.createText(runParams.outDir+"bottleneck_b.qs");
+	QueueMonitor bottleneckMonitor;
+	bottleneckMonitor.install(routerDevices.Get(0), bottleneckQs, runParams.queueSampleInterval, 0, durationGap+otherFlowStart);
+
 	std::cout << "Setting up FlowMonitor...";
 	Ptr<FlowMonitor> flowmon;
 	FlowMonitorHelper flowmonHelper;
-	flowmon = flowmonHelper.InstallAll();
+	flowmon = installFlowMonitor(flowmonHelper, runParams.probeConfig, routers, senders, receivers);
+	Ptr<Ipv4FlowClassifier> classifier = DynamicCast<Ipv4FlowClassifier>(flowmonHelper.GetClassifier());
+	FlowSnapshots snapshots;
+	if(streaming)
+		snapshots.install(flowmon, classifier, &flowTable, runParams.outDir+"flows_b_windows.csv", snapshotInterval, 0, durationGap+otherFlowStart);
 	Simulator::Stop(Seconds(durationGap+otherFlowStart));
 	std::cout<<"done"<< std::endl;
 
 	std::cout<<"Starting Simulation..."<< std::endl;
+	//After the last SetDefault (AQM and ECN ones included)
+	writeReplayRecord(runParams.outDir, runParams.seed, runParams.run, argc, argv);
+	scheduler.start();
 	Simulator::Run();
+	sampler.finish();
+	std::cout<<"Simulator events: "<<Simulator::GetEventCount()<< std::endl;
 
 	std::cout<<"Checking for lost packets..."<< std::endl;
 	flowmon->CheckForLostPackets();
 
-	//Ptr<OutputStreamWrapper> streamTP = asciiTraceHelper.CreateFileStream("application_6_b.tp");
-	Ptr<Ipv4FlowClassifier> classifier = DynamicCast<Ipv4FlowClassifier>(flowmonHelper.GetClassifier());
-	std::map<FlowId, FlowMonitor::FlowStats> stats = flowmon->GetFlowStats();
-	for (std::map<FlowId, FlowMonitor::FlowStats>::const_iterator i = stats.begin(); i != stats.end(); ++i) {
-		Ipv4FlowClassifier::FiveTuple t = classifier->FindFlow (i->first);
-		if(t.sourceAddress == "10.1.0.1") {
-			if(mapDrop.find(1)==mapDrop.end())
-				mapDrop[1] = 0;
-			*h1cl->GetStream() << "TcpHybla Flow " << i->first  << " (" << t.sourceAddress << " -> " << t.destinationAddress << ")\n";
-			*h1cl->GetStream()  << "Net Packet Lost: " << i->second.lostPackets << "\n";
-			*h1cl->GetStream()  << "Packet Lost due to buffer overflow: " << mapDrop[1] << "\n";
-			*h1cl->GetStream()  << "Packet Lost due to Congestion: " << i->second.lostPackets - mapDrop[1] << "\n";
-			*h1cl->GetStream() << "Max throughput: " << mapMaxThroughput["/NodeList/5/$ns3::Ipv4L3Protocol/Rx"] << std::endl;
-		} else if(t.sourceAddress == "10.1.1.1") {
-			if(mapDrop.find(2)==mapDrop.end())
-				mapDrop[2] = 0;
-			*h2cl->GetStream() << "TcpWestwood Flow " << i->first  << " (" << t.sourceAddress << " -> " << t.destinationAddress << ")\n";
-			*h2cl->GetStream()  << "Net Packet Lost: " << i->second.lostPackets << "\n";
-			*h2cl->GetStream()  << "Packet Lost due to buffer overflow: " << mapDrop[2] << "\n";
-			*h2cl->GetStream()  << "Packet Lost due to Congestion: " << i->second.lostPackets - mapDrop[2] << "\n";
-			*h2cl->GetStream() << "Max throughput: " << mapMaxThroughput["/NodeList/6/$ns3::Ipv4L3Protocol/Rx"] << std::endl;
-		} else if(t.sourceAddress == "10.1.2.1") {
-			if(mapDrop.find(3)==mapDrop.end())
-				mapDrop[3] = 0;
-			*h3cl->GetStream() << "TcpYeah Flow " << i->first  << " (" << t.sourceAddress << " -> " << t.destinationAddress << ")\n";
-			*h3cl->GetStream()  << "Net Packet Lost: " << i->second.lostPackets << "\n";
-			*h3cl->GetStream()  << "Packet Lost due to buffer overflow: " << mapDrop[3] << "\n";
-			*h3cl->GetStream()  << "Packet Lost due to Congestion: " << i->second.lostPackets - mapDrop[3] << "\n";
-			*h3cl->GetStream() << "Max throughput: " << mapMaxThroughput["/NodeList/7/$ns3::Ipv4L3Protocol/Rx"] << std::endl;
-		}
+	FlowExporter flowExporter(&flowTable);
+	if(streaming)
+		flowExporter.collect(snapshots.getTotals(), classifier);
+	else
+		flowExporter.collect(flowmon, classifier);
+	flowExporter.attachDrops(&dropAccounting);
+	for(uint i = 0; i < numSender; ++i) {
+		flowExporter.setAppBytes(i, sinkTotalRx(receivers.Get(i)->GetApplication(0)));
+	}
+	flowExporter.writeCsv(runParams.outDir+"flows_b.csv");
+	if(!runParams.aggregateName.empty() && !flowExporter.publish(runParams.aggregateName, runParams.aggregateKey))
+		std::cerr << "Cannot reach the sweep table " << runParams.aggregateName << std::endl;
+	std::vector<double> mss, wmax;
+	for(uint i = 0; i < numSender; ++i) {
+		mss.push_back(flowSocketParams[i].segmentSize);
+		wmax.push_back((double)flowSocketParams[i].rcvBuf/flowSocketParams[i].segmentSize);
 	}
+	//T0 = 1 s, the MinRto of ns-3, which the RTTs here never exceed
+	flowExporter.checkModels(runParams.outDir+"model_check_b.csv", mss, wmax, rtt.GetSeconds(), 1, runParams.modelTolerance, std::cout);
+
+	Ptr<OutputStreamWrapper> clStreams[] = {h1cl, h2cl, h3cl};
+	for(uint i = 0; i < numSender; ++i) {
+		const FlowEntry &e = flowTable.get(i);
+		const FlowResult &r = flowExporter.get(i);
+		if(!r.found)
+			continue;
+		std::string context = "/NodeList/"+std::to_string(receivers.Get(i)->GetId())+"/$ns3::Ipv4L3Protocol/Rx";
+		*clStreams[i]->GetStream() << e.label << " Flow " << r.flowId << " (" << e.source << " -> " << e.destination << ")\n";
+		*clStreams[i]->GetStream() << "Net Packet Lost: " << r.lostPackets << "\n";
+		dropAccounting.report(i, *clStreams[i]->GetStream());
+		*clStreams[i]->GetStream() << "Goodput (Kbps): " << r.goodput << "\n";
+		*clStreams[i]->GetStream() << "Max throughput: " << mapMaxThroughput[context] << std::endl;
+	}
+
+	*bottleneckQs->GetStream() << "# Bottleneck queue disc: " << runParams.queueDisc << "\n";
+	std::cout << "Bottleneck queue (" << runParams.queueDisc << ")" << std::endl;
+	bottleneckMonitor.report(std::cout);
+	traceFiles.close();
 
 	//flowmon->SerializeToXmlFile("application_6_b.flowmon", true, true);
-	std::cout << "Simulation finished! Find the data in PartB folder" << std::endl;
+	std::cout << "Simulation finished! Find the data in " << runParams.outDir << std::endl;
+	bool flat = !streaming || snapshots.checkRss(rssTolerance, std::cout);
 	Simulator::Destroy();
-	return 0;
+	return flat ? 0 : EXIT_FAILURE;
 
 }
\ No newline at end of file
@@ -0,0 +1,548 @@
+/*
+	Performance regression gate: runs the benchmark scenarios a few times
+	each and compares wall time, simulator events per second and peak
+	memory against a stored baseline.
+	Usage:
+		perfGate -b <baseline.json> -u [options]     record the baseline
+		perfGate -b <baseline.json> [options]        compare against it
+	Options:
+		-n <runs>        runs per scenario (5)
+		-a <alpha>       significance level of the tests (0.05)
+		-t <percent>     slowdown tolerated in wall time and events/s (10)
+		-m <percent>     growth tolerated in peak memory (10)
+		-d <dir>         directory of the part13 and part23 binaries (.)
+		-w <dir>         work directory, one subdirectory per run (perf_gate)
+		-s <name=cmd>    add a scenario or replace one of the defaults
+		-o <file>        also write this session's runs as JSON
+	Default scenarios:
+		partA     part13
+		partB     part23
+	App6 (the scaled dumbbell, e.g. --numHostPairs=64 --slimStack=1) does
+	not build yet and is left out; add it with -s dumbbell=... once it does.
+	Each run is a child process started in its own work subdirectory, with
+	its stdout and stderr in log.txt there. Wall time is taken around the
+	child, peak memory is its ru_maxrss from wait4 and the event count is the
+	"Simulator events: N" line the mains print after Simulator::Run. Runs
+	are interleaved across scenarios, so a burst of load on the machine is
+	spread over all of them rather than landing on one.
+	A metric regresses when a one-sided Mann-Whitney U test finds the runs
+	worse than the baseline's at level alpha and the medians differ by more
+	than the threshold: the test alone flags 1% shifts on a quiet machine,
+	the threshold alone flags noise. The exit status is 1 on any regression
+	or on any metric the test cannot decide.
+	With m and n runs the smallest p-value the test can give is
+	1/C(m+n, n) (every new run worse than every old one), so too few runs
+	can never reach alpha: 3 against 3 gives 0.05. Such run counts are
+	refused rather than passing every regression.
+	The baseline keeps every sample, not only a summary, since the test
+	needs them:
+		{"runs": 5, "scenarios": {"partA": {"command": "...",
+		 "wall_s": [...], "events_per_s": [...], "maxrss_kb": [...]}, ...}}
+	Build: g++ -O2 -std=c++11 perfGate.cc -o perfGate
+*/
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+#define METRICS 3
+
+const char *metricNames[METRICS] = {"wall_s", "events_per_s", "maxrss_kb"};
+//Whether a larger value is worse
+const bool metricHigherWorse[METRICS] = {true, false, true};
+
+struct Scenario
+{
+	std::string name;
+	std::string command;
+	std::vector<double> samples[METRICS];
+};
+
+//"Simulator events: N" in the run's log, 0 if the binary does not print it
+double readEvents(std::string logFile) {
+	std::ifstream in(logFile.c_str());
+	std::string line;
+	double events = 0;
+	while(std::getline(in, line)) {
+		if(line.compare(0, 18, "Simulator events: ") == 0)
+			events = atof(line.c_str() + 18);
+	}
+	return events;
+}
+
+//One run of command in dir: wall time (s) and peak RSS (KB) of the child
+bool runOnce(std::string command, std::string dir, double &wall, double &maxrss) {
+	mkdir(dir.c_str(), 0755);
+	std::vector<std::string> args;
+	std::stringstream ss(command);
+	std::string arg;
+	while(ss >> arg)
+		args.push_back(arg);
+	if(args.empty())
+		return false;
+
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	pid_t pid = fork();
+	if(pid < 0) {
+		perror("fork");
+		exit(EXIT_FAILURE);
+	}
+	if(pid == 0) {
+		if(chdir(dir.c_str()) != 0)
+			_exit(127);
+		int fd = open("log.txt", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if(fd >= 0) {
+			dup2(fd, STDOUT_FILENO);
+			dup2(fd, STDERR_FILENO);
+			close(fd);
+		}
+		std::vector<char *> childArgv;
+		for(uint32_t i = 0; i < args.size(); ++i)
+			childArgv.push_back((char *)args[i].c_str());
+		childArgv.push_back(NULL);
+		execvp(childArgv[0], &childArgv[0]);
+		perror("execvp");
+		_exit(127);
+	}
+	int status;
+	struct rusage usage;
+	if(wait4(pid, &status, 0, &usage) < 0) {
+		perror("wait4");
+		exit(EXIT_FAILURE);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	wall = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec)/1e9;
+	maxrss = usage.ru_maxrss;
+	return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+double median(std::vector<double> values) {
+	if(values.empty())
+		return 0;
+	std::sort(values.begin(), values.end());
+	size_t n = values.size();
+	return n % 2 ? values[n/2] : (values[n/2 - 1] + values[n/2])/2;
+}
+
+/*
+	One-sided Mann-Whitney U test of "b tends to be larger than a".
+	U counts the pairs (a_i, b_j) with b_j > a_i, ties as one half. Without
+	ties the p-value is exact, from the distribution of U over every
+	ordering (the recurrence on the sample sizes); with ties it is the
+	normal approximation with tie correction and continuity correction.
+*/
+double mannWhitneyGreater(const std::vector<double> &a, const std::vector<double> &b) {
+	size_t m = a.size(), n = b.size();
+	if(m == 0 || n == 0)
+		return 1;
+	double u = 0;
+	bool ties = false;
+	for(size_t i = 0; i < m; ++i) {
+		for(size_t j = 0; j < n; ++j) {
+			if(b[j] > a[i])
+				u += 1;
+			else if(b[j] == a[i]) {
+				u += 0.5;
+				ties = true;
+			}
+		}
+	}
+	if(!ties) {
+		//f[i][k][v]: orderings of i values of a and k of b with U = v. The largest
+		//value is from a (adds nothing) or from b (beats all i values of a)
+		std::vector<std::vector<std::vector<double> > > f(m + 1, std::vector<std::vector<double> >(n + 1));
+		for(size_t i = 0; i <= m; ++i) {
+			for(size_t k = 0; k <= n; ++k) {
+				f[i][k].assign(i*k + 1, 0);
+				if(i == 0 || k == 0) {
+					f[i][k][0] = 1;
+					continue;
+				}
+				for(size_t v = 0; v < f[i - 1][k].size(); ++v)
+					f[i][k][v] += f[i - 1][k][v];
+				for(size_t v = 0; v < f[i][k - 1].size(); ++v)
+					f[i][k][v + i] += f[i][k - 1][v];
+			}
+		}
+		const std::vector<double> &distribution = f[m][n];
+		double total = 0, tail = 0;
+		for(size_t v = 0; v < distribution.size(); ++v) {
+			total += distribution[v];
+			if(v >= u)
+				tail += distribution[v];
+		}
+		return tail/total;
+	}
+	std::vector<double> all(a);
+	all.insert(all.end(), b.begin(), b.end());
+	std::sort(all.begin(), all.end());
+	double tieTerm = 0;
+	for(size_t i = 0; i < all.size();) {
+		size_t j = i;
+		while(j < all.size() && all[j] == all[i])
+			j++;
+		double t = j - i;
+		tieTerm += t*t*t - t;
+		i = j;
+	}
+	double N = m + n;
+	double sigma = std::sqrt(m*n/12.0*((N + 1) - tieTerm/(N*(N - 1))));
+	if(sigma == 0)
+		return 1;
+	double z = (u - m*n/2.0 - 0.5)/sigma;
+	return 0.5*std::erfc(z/std::sqrt(2.0));
+}
+
+//Smallest one-sided p-value of the exact test with m and n samples: 1/C(m+n, n)
+double minPValue(size_t m, size_t n) {
+	double orderings = 1;
+	for(size_t k = 1; k <= n; ++k)
+		orderings = orderings*(m + k)/k;
+	return 1/orderings;
+}
+
+/*
+	Just enough JSON for the baseline: objects, arrays, strings and numbers.
+	Objects come back as their members in order, arrays of numbers as the
+	numbers.
+*/
+struct JsonValue
+{
+	std::string text;
+	std::vector<double> numbers;
+	std::vector<std::pair<std::string, JsonValue> > members;
+};
+
+class JsonParser
+{
+private:
+	std::string input;
+	size_t pos;
+	std::string fileName;
+
+	void fail(const char *what);
+	void skipSpace();
+	std::string parseString();
+	double parseNumber();
+
+public:
+	JsonParser(std::string input, std::string fileName);
+	JsonValue parseValue();
+};
+
+JsonParser::JsonParser(std::string input, std::string fileName) {
+	this->input = input;
+	this->pos = 0;
+	this->fileName = fileName;
+}
+
+void JsonParser::fail(const char *what) {
+	fprintf(stderr, "%s: %s at byte %zu\n", this->fileName.c_str(), what, this->pos);
+	exit(EXIT_FAILURE);
+}
+
+void JsonParser::skipSpace() {
+	while(this->pos < this->input.size() && isspace((unsigned char)this->input[this->pos]))
+		this->pos++;
+}
+
+std::string JsonParser::parseString() {
+	std::string s;
+	this->pos++;
+	while(this->pos < this->input.size() && this->input[this->pos] != '"') {
+		if(this->input[this->pos] == '\\' && this->pos + 1 < this->input.size())
+			this->pos++;
+		s += this->input[this->pos++];
+	}
+	if(this->pos >= this->input.size())
+		this->fail("unterminated string");
+	this->pos++;
+	return s;
+}
+
+double JsonParser::parseNumber() {
+	const char *start = this->input.c_str() + this->pos;
+	char *end;
+	double value = strtod(start, &end);
+	if(end == start)
+		this->fail("expected a value");
+	this->pos += end - start;
+	return value;
+}
+
+JsonValue JsonParser::parseValue() {
+	JsonValue value;
+	this->skipSpace();
+	if(this->pos >= this->input.size())
+		this->fail("unexpected end");
+	char c = this->input[this->pos];
+	if(c == '{' || c == '[') {
+		char close = c == '{' ? '}' : ']';
+		this->pos++;
+		this->skipSpace();
+		while(this->pos < this->input.size() && this->input[this->pos] != close) {
+			if(c == '{') {
+				if(this->input[this->pos] != '"')
+					this->fail("expected a key");
+				std::string key = this->parseString();
+				this->skipSpace();
+				if(this->pos >= this->input.size() || this->input[this->pos] != ':')
+					this->fail("expected ':'");
+				this->pos++;
+				value.members.push_back(std::make_pair(key, this->parseValue()));
+			} else {
+				value.numbers.push_back(this->parseValue().numbers.at(0));
+			}
+			this->skipSpace();
+			if(this->pos < this->input.size() && this->input[this->pos] == ',') {
+				this->pos++;
+				this->skipSpace();
+			}
+		}
+		if(this->pos >= this->input.size())
+			this->fail("unterminated object or array");
+		this->pos++;
+	} else if(c == '"') {
+		value.text = this->parseString();
+	} else {
+		value.numbers.push_back(this->parseNumber());
+	}
+	return value;
+}
+
+const JsonValue *jsonMember(const JsonValue &object, std::string key) {
+	for(uint32_t i = 0; i < object.members.size(); ++i) {
+		if(object.members[i].first == key)
+			return &object.members[i].second;
+	}
+	return 0;
+}
+
+std::vector<Scenario> readBaseline(std::string fileName) {
+	std::ifstream in(fileName.c_str());
+	if(!in) {
+		fprintf(stderr, "Cannot open %s, record one with -u\n", fileName.c_str());
+		exit(EXIT_FAILURE);
+	}
+	std::stringstream buffer;
+	buffer << in.rdbuf();
+	JsonValue root = JsonParser(buffer.str(), fileName).parseValue();
+	const JsonValue *scenarios = jsonMember(root, "scenarios");
+	std::vector<Scenario> baseline;
+	if(!scenarios)
+		return baseline;
+	for(uint32_t i = 0; i < scenarios->members.size(); ++i) {
+		Scenario s;
+		s.name = scenarios->members[i].first;
+		const JsonValue &entry = scenarios->members[i].second;
+		const JsonValue *command = jsonMember(entry, "command");
+		if(command)
+			s.command = command->text;
+		for(uint32_t m = 0; m < METRICS; ++m) {
+			const JsonValue *samples = jsonMember(entry, metricNames[m]);
+			if(samples)
+				s.samples[m] = samples->numbers;
+		}
+		baseline.push_back(s);
+	}
+	return baseline;
+}
+
+void writeJson(std::string fileName, const std::vector<Scenario> &scenarios, uint32_t runs) {
+	std::string tmp = fileName + ".tmp";
+	std::ofstream out(tmp.c_str());
+	out << std::setprecision(10);
+	out << "{\n\t\"runs\": " << runs << ",\n\t\"scenarios\": {\n";
+	for(uint32_t i = 0; i < scenarios.size(); ++i) {
+		std::string command;
+		for(uint32_t c = 0; c < scenarios[i].command.size(); ++c) {
+			if(scenarios[i].command[c] == '"' || scenarios[i].command[c] == '\\')
+				command += '\\';
+			command += scenarios[i].command[c];
+		}
+		out << "\t\t\"" << scenarios[i].name << "\": {\n\t\t\t\"command\": \"" << command << "\"";
+		for(uint32_t m = 0; m < METRICS; ++m) {
+			out << ",\n\t\t\t\"" << metricNames[m] << "\": [";
+			for(uint32_t r = 0; r < scenarios[i].samples[m].size(); ++r)
+				out << (r ? ", " : "") << scenarios[i].samples[m][r];
+			out << "]";
+		}
+		out << "\n\t\t}" << (i + 1 < scenarios.size() ? "," : "") << "\n";
+	}
+	out << "\t}\n}\n";
+	out.close();
+	if(!out || rename(tmp.c_str(), fileName.c_str()) != 0) {
+		fprintf(stderr, "Cannot write %s\n", fileName.c_str());
+		exit(EXIT_FAILURE);
+	}
+}
+
+void usage(const char *name) {
+	std::cerr << "Usage: " << name << " -b <baseline.json> [-u] [-n runs] [-a alpha] [-t percent] [-m percent]" << std::endl;
+	std::cerr << "       [-d bindir] [-w workdir] [-s name=command]... [-o runs.json]" << std::endl;
+}
+
+int main(int argc, char **argv) {
+	std::string baselineFile, binDir = ".", workDir = "perf_gate", outFile;
+	uint32_t runs = 5;
+	double alpha = 0.05, slowdown = 10, memoryGrowth = 10;
+	bool record = false;
+	std::vector<std::pair<std::string, std::string> > extra;
+	int i = 1;
+	for(; i < argc && argv[i][0] == '-'; ++i) {
+		if(strcmp(argv[i], "-u") == 0) {
+			record = true;
+			continue;
+		}
+		if(i + 1 >= argc) {
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+		const char *value = argv[++i];
+		if(strcmp(argv[i - 1], "-b") == 0)
+			baselineFile = value;
+		else if(strcmp(argv[i - 1], "-n") == 0)
+			runs = atoi(value);
+		else if(strcmp(argv[i - 1], "-a") == 0)
+			alpha = atof(value);
+		else if(strcmp(argv[i - 1], "-t") == 0)
+			slowdown = atof(value);
+		else if(strcmp(argv[i - 1], "-m") == 0)
+			memoryGrowth = atof(value);
+		else if(strcmp(argv[i - 1], "-d") == 0)
+			binDir = value;
+		else if(strcmp(argv[i - 1], "-w") == 0)
+			workDir = value;
+		else if(strcmp(argv[i - 1], "-o") == 0)
+			outFile = value;
+		else if(strcmp(argv[i - 1], "-s") == 0 && strchr(value, '='))
+			extra.push_back(std::make_pair(std::string(value, strchr(value, '=')), std::string(strchr(value, '=') + 1)));
+		else {
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if(i < argc || baselineFile.empty() || runs < 2 || alpha <= 0 || alpha >= 1) {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	if(minPValue(runs, runs) >= alpha) {
+		std::cerr << runs << " runs against " << runs << " cannot reach p < " << alpha << " (smallest p " << minPValue(runs, runs)
+			<< "), use more runs" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	//Binaries are run from their work subdirectory, so relative paths are made absolute
+	if(binDir[0] != '/') {
+		char cwd[4096];
+		if(getcwd(cwd, sizeof(cwd)))
+			binDir = std::string(cwd) + "/" + binDir;
+	}
+	std::vector<Scenario> scenarios(2);
+	scenarios[0].name = "partA";
+	scenarios[0].command = binDir + "/part13";
+	scenarios[1].name = "partB";
+	scenarios[1].command = binDir + "/part23";
+	for(uint32_t e = 0; e < extra.size(); ++e) {
+		uint32_t s = 0;
+		while(s < scenarios.size() && scenarios[s].name != extra[e].first)
+			s++;
+		if(s == scenarios.size()) {
+			scenarios.push_back(Scenario());
+			scenarios[s].name = extra[e].first;
+		}
+		scenarios[s].command = extra[e].second;
+	}
+
+	mkdir(workDir.c_str(), 0755);
+	uint32_t failed = 0;
+	for(uint32_t r = 0; r < runs; ++r) {
+		for(uint32_t s = 0; s < scenarios.size(); ++s) {
+			std::string dir = workDir + "/" + scenarios[s].name + "_" + std::to_string(r);
+			double wall, maxrss;
+			if(!runOnce(scenarios[s].command, dir, wall, maxrss)) {
+				std::cerr << scenarios[s].name << " run " << r << " failed, see " << dir << "/log.txt" << std::endl;
+				failed++;
+				continue;
+			}
+			double events = readEvents(dir + "/log.txt");
+			scenarios[s].samples[0].push_back(wall);
+			if(events > 0)
+				scenarios[s].samples[1].push_back(events/wall);
+			scenarios[s].samples[2].push_back(maxrss);
+			std::cerr << scenarios[s].name << " run " << r << ": " << wall << " s, " << (uint64_t)(events/wall) << " events/s, "
+				<< (uint64_t)maxrss << " KB" << std::endl;
+		}
+	}
+	if(failed) {
+		std::cerr << failed << " runs failed, no comparison" << std::endl;
+		return EXIT_FAILURE;
+	}
+	if(!outFile.empty())
+		writeJson(outFile, scenarios, runs);
+	if(record) {
+		writeJson(baselineFile, scenarios, runs);
+		std::cout << "Baseline written to " << baselineFile << std::endl;
+		return EXIT_SUCCESS;
+	}
+
+	std::vector<Scenario> baseline = readBaseline(baselineFile);
+	uint32_t regressions = 0, undecided = 0;
+	std::cout << std::left << std::setw(12) << "scenario" << std::setw(14) << "metric" << std::right << std::setw(14) << "baseline"
+		<< std::setw(14) << "current" << std::setw(10) << "change%" << std::setw(10) << "p" << "  verdict" << std::endl;
+	for(uint32_t s = 0; s < scenarios.size(); ++s) {
+		const Scenario *base = 0;
+		for(uint32_t b = 0; b < baseline.size(); ++b) {
+			if(baseline[b].name == scenarios[s].name)
+				base = &baseline[b];
+		}
+		if(!base) {
+			std::cout << std::left << std::setw(12) << scenarios[s].name << std::right << "not in the baseline, skipped" << std::endl;
+			continue;
+		}
+		if(base->command != scenarios[s].command)
+			std::cerr << scenarios[s].name << ": command differs from the baseline's (" << base->command << ")" << std::endl;
+		for(uint32_t m = 0; m < METRICS; ++m) {
+			const std::vector<double> &before = base->samples[m], &after = scenarios[s].samples[m];
+			if(before.size() < 2 || after.size() < 2)
+				continue;
+			double medianBefore = median(before), medianAfter = median(after);
+			double change = medianBefore > 0 ? (medianAfter - medianBefore)/medianBefore*100 : 0;
+			//Worse is larger for wall time and memory, smaller for events/s
+			double p = metricHigherWorse[m] ? mannWhitneyGreater(before, after) : mannWhitneyGreater(after, before);
+			double worse = metricHigherWorse[m] ? change : -change;
+			double threshold = m == 2 ? memoryGrowth : slowdown;
+			bool regressed = p < alpha && worse > threshold;
+			//A baseline recorded with fewer runs can leave the test unable to reach alpha
+			bool decidable = minPValue(before.size(), after.size()) < alpha;
+			if(regressed)
+				regressions++;
+			if(!decidable)
+				undecided++;
+			std::cout << std::left << std::setw(12) << scenarios[s].name << std::setw(14) << metricNames[m] << std::right
+				<< std::setw(14) << medianBefore << std::setw(14) << medianAfter << std::fixed << std::setprecision(1) << std::setw(10) << change
+				<< std::setprecision(4) << std::setw(10) << p << "  " << (regressed ? "REGRESSION" : decidable ? "ok" : "TOO FEW RUNS") << std::endl;
+			std::cout.unsetf(std::ios::fixed);
+			std::cout << std::setprecision(6);
+		}
+	}
+	std::cout << regressions << " regressions (alpha " << alpha << ", thresholds " << slowdown << "% speed, " << memoryGrowth << "% memory)" << std::endl;
+	if(undecided)
+		std::cout << undecided << " metrics with too few runs to reach alpha, record the baseline with more runs" << std::endl;
+	return regressions || undecided ? 1 : 0;
+}
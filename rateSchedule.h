@@ -0,0 +1,162 @@
+#ifndef RATE_SCHEDULE_H
+#define RATE_SCHEDULE_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+
+using namespace ns3;
+
+/*
+	Time-varying sending rates.
+	A schedule is a table, one segment per line, '#' starts a comment:
+		<start (s)> <flow> step     <rate>
+		<start (s)> <flow> ramp     <from> <to> <duration (s)>
+		<start (s)> <flow> sinusoid <mean> <amplitude> <period (s)>
+	Rates are ns-3 DataRate strings (e.g. 2Mbps). A segment holds for its
+	flow until the flow's next segment starts; a ramp stays at <to> once
+	done. Flows are numbered in registration order (for uniFlow, sender
+	order).
+	All flows are driven by a single event: each tick applies the current
+	rate of every flow and schedules the next tick at the next segment
+	start, or after `resolution` while a ramp or sinusoid is running.
+*/
+struct RateSegment
+{
+	double start;
+	uint32_t flow;
+	std::string kind;
+	double rate;			// bps: step rate, ramp start, sinusoid mean
+	double rate2;			// bps: ramp end, sinusoid amplitude
+	double period;			// s: ramp duration, sinusoid period
+};
+
+class RateScheduler
+{
+private:
+	std::vector<Callback<void, DataRate> > flows;
+	std::vector<double> current;
+	std::vector<RateSegment> segments;
+	double resolution;
+
+	bool isContinuous(const RateSegment &segment, double now);
+	double rateAt(const RateSegment &segment, double now);
+	void tick();
+
+public:
+	RateScheduler();
+	void load(std::string fileName, double resolution);
+	uint32_t addFlow(Callback<void, DataRate> setRate);
+	void start();
+};
+
+RateScheduler::RateScheduler() {
+	this->resolution = 0.1;
+}
+
+static bool rateSegmentBefore(const RateSegment &a, const RateSegment &b) {
+	return a.start < b.start;
+}
+
+void RateScheduler::load(std::string fileName, double resolution) {
+	std::ifstream in(fileName.c_str());
+	if(!in) {
+		fprintf(stderr, "Cannot open rate schedule %s\n", fileName.c_str());
+		exit(EXIT_FAILURE);
+	}
+	this->resolution = resolution;
+	std::string line;
+	while(std::getline(in, line)) {
+		line = line.substr(0, line.find('#'));
+		std::stringstream ss(line);
+		RateSegment segment;
+		std::string rate, rate2;
+		if(!(ss >> segment.start >> segment.flow >> segment.kind >> rate))
+			continue;
+		segment.rate = DataRate(rate).GetBitRate();
+		segment.rate2 = 0;
+		segment.period = 0;
+		if(segment.kind == "ramp" || segment.kind == "sinusoid") {
+			if(!(ss >> rate2 >> segment.period) || segment.period <= 0) {
+				fprintf(stderr, "Invalid %s segment in %s: %s\n", segment.kind.c_str(), fileName.c_str(), line.c_str());
+				exit(EXIT_FAILURE);
+			}
+			segment.rate2 = DataRate(rate2).GetBitRate();
+		} else if(segment.kind != "step") {
+			fprintf(stderr, "Invalid rate segment kind %s\n", segment.kind.c_str());
+			exit(EXIT_FAILURE);
+		}
+		this->segments.push_back(segment);
+	}
+	std::stable_sort(this->segments.begin(), this->segments.end(), rateSegmentBefore);
+}
+
+uint32_t RateScheduler::addFlow(Callback<void, DataRate> setRate) {
+	this->flows.push_back(setRate);
+	this->current.push_back(-1);
+	return this->flows.size() - 1;
+}
+
+bool RateScheduler::isContinuous(const RateSegment &segment, double now) {
+	if(segment.kind == "sinusoid")
+		return true;
+	return segment.kind == "ramp" && now < segment.start + segment.period;
+}
+
+double RateScheduler::rateAt(const RateSegment &segment, double now) {
+	double t = now - segment.start;
+	double rate = segment.rate;
+	if(segment.kind == "ramp")
+		rate = t >= segment.period ? segment.rate2 : segment.rate + (segment.rate2 - segment.rate)*t/segment.period;
+	else if(segment.kind == "sinusoid")
+		rate = segment.rate + segment.rate2*std::sin(2*M_PI*t/segment.period);
+	return rate < 0 ? 0 : rate;
+}
+
+//To be called once every flow is added, before Simulator::Run()
+void RateScheduler::start() {
+	if(!this->segments.empty())
+		Simulator::Schedule(Seconds(this->segments[0].start), &RateScheduler::tick, this);
+}
+
+void RateScheduler::tick() {
+	double now = Simulator::Now().GetSeconds();
+	//Active segment of every flow: the last one started
+	std::vector<int> active(this->flows.size(), -1);
+	double next = -1;
+	for(uint32_t i = 0; i < this->segments.size(); ++i) {
+		if(this->segments[i].start > now) {
+			next = this->segments[i].start;
+			break;
+		}
+		if(this->segments[i].flow < active.size())
+			active[this->segments[i].flow] = i;
+	}
+
+	bool continuous = false;
+	for(uint32_t f = 0; f < this->flows.size(); ++f) {
+		if(active[f] < 0)
+			continue;
+		const RateSegment &segment = this->segments[active[f]];
+		double rate = this->rateAt(segment, now);
+		if(rate != this->current[f]) {
+			this->current[f] = rate;
+			this->flows[f](DataRate((uint64_t)rate));
+		}
+		continuous = continuous || this->isContinuous(segment, now);
+	}
+
+	if(continuous && (next < 0 || now + this->resolution < next))
+		next = now + this->resolution;
+	if(next >= 0)
+		Simulator::Schedule(Seconds(next - now), &RateScheduler::tick, this);
+}
+
+#endif
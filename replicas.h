@@ -0,0 +1,337 @@
+#ifndef REPLICAS_H
+#define REPLICAS_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <sstream>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <functional>
+#include "ns3/core-module.h"
+#include "ns3/config-store-module.h"
+#include "resultsCache.h"
+#include "aggregation.h"
+
+using namespace ns3;
+
+/*
+	Random number streams.
+	ns-3 draws every random variable (e.g. the RanVar of the RateErrorModel)
+	from one MRG32k3a generator. The seed selects the generator state and the
+	run number selects an independent substream, so replicas of a scenario
+	keep the seed and differ only in the run number.
+*/
+void setRngStream(uint32_t seed, uint64_t run) {
+	RngSeedManager::SetSeed(seed);
+	RngSeedManager::SetRun(run);
+}
+
+/*
+	Everything needed to replay one run bit-exactly:
+	- the binary (hash of the executable),
+	- the command line, seed and run number,
+	- every attribute default (ConfigStore dump), which covers values set
+	  through Config::SetDefault or NS_GLOBAL_VALUE rather than the command line.
+	To be called after the last Config::SetDefault, right before
+	Simulator::Run, so that the dump holds the values the run used.
+	Replay: rerun the same binary with the recorded command line and
+	--seed/--run.
+*/
+void writeReplayRecord(std::string outDir, uint32_t seed, uint64_t run, int argc, char **argv) {
+	std::ofstream out((outDir + "replay.txt").c_str());
+	out << "binary " << argv[0] << "\n";
+	out << "binaryHash " << toHex(hashFile("/proc/self/exe")) << "\n";
+	out << "seed " << seed << "\n";
+	out << "run " << run << "\n";
+	out << "commandLine";
+	for(int i = 0; i < argc; ++i)
+		out << " " << argv[i];
+	out << "\n";
+	out.close();
+
+	Config::SetDefault("ns3::ConfigStore::Filename", StringValue(outDir + "attributes.txt"));
+	Config::SetDefault("ns3::ConfigStore::Mode", StringValue("Save"));
+	Config::SetDefault("ns3::ConfigStore::FileFormat", StringValue("RawText"));
+	ConfigStore config;
+	config.ConfigureDefaults();
+}
+
+//Two-sided 95% Student t quantiles, df = 1..30
+double tQuantile95(uint32_t df) {
+	static const double t[] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+		2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+		2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+	if(df == 0)
+		return 0;
+	if(df <= 30)
+		return t[df-1];
+	return 1.96;
+}
+
+struct ConfidenceInterval
+{
+	uint32_t n;
+	double mean;
+	double halfWidth;		// 95%
+};
+
+ConfidenceInterval confidenceInterval(const std::vector<double> &samples) {
+	ConfidenceInterval ci;
+	ci.n = samples.size();
+	ci.mean = 0;
+	ci.halfWidth = 0;
+	if(ci.n == 0)
+		return ci;
+	for(uint32_t i = 0; i < ci.n; ++i)
+		ci.mean += samples[i];
+	ci.mean /= ci.n;
+	if(ci.n < 2)
+		return ci;
+	double var = 0;
+	for(uint32_t i = 0; i < ci.n; ++i)
+		var += (samples[i]-ci.mean)*(samples[i]-ci.mean);
+	var /= ci.n-1;
+	ci.halfWidth = tQuantile95(ci.n-1)*std::sqrt(var/ci.n);
+	return ci;
+}
+
+//Rows of a CSV with a header line, as column -> value
+std::vector<std::map<std::string, std::string> > readCsv(std::string fileName) {
+	std::vector<std::map<std::string, std::string> > rows;
+	std::ifstream in(fileName.c_str());
+	std::string line, cell;
+	std::vector<std::string> header;
+	if(std::getline(in, line)) {
+		std::stringstream ss(line);
+		while(std::getline(ss, cell, ','))
+			header.push_back(cell);
+	}
+	while(std::getline(in, line)) {
+		std::stringstream ss(line);
+		std::map<std::string, std::string> row;
+		for(uint32_t c = 0; c < header.size() && std::getline(ss, cell, ','); ++c)
+			row[header[c]] = cell;
+		rows.push_back(row);
+	}
+	return rows;
+}
+
+//Command line without the given --name=value options
+std::vector<std::string> stripOptions(int argc, char **argv, std::vector<std::string> names) {
+	std::vector<std::string> args;
+	for(int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		bool strip = false;
+		for(uint32_t n = 0; n < names.size(); ++n) {
+			std::string prefix = "--" + names[n] + "=";
+			if(arg.compare(0, prefix.size(), prefix) == 0)
+				strip = true;
+		}
+		if(!strip)
+			args.push_back(arg);
+	}
+	return args;
+}
+
+/*
+	Runs `binary args extra[i]` for every i, at most `parallel` at a time.
+	Each child is a separate process, hence a separate Simulator; its
+	stdout/stderr go to logs[i]. onExit(i, ok), if given, is called as soon
+	as child i exits. Returns the number of failed children.
+*/
+uint32_t runChildren(std::string binary, std::vector<std::string> args, std::vector<std::vector<std::string> > extra, std::vector<std::string> logs, uint32_t parallel, std::function<void(uint32_t, bool)> onExit = nullptr) {
+	uint32_t next = 0, running = 0, failed = 0;
+	std::map<pid_t, uint32_t> children;
+	if(parallel == 0)
+		parallel = 1;
+	while(next < extra.size() || running > 0) {
+		while(running < parallel && next < extra.size()) {
+			pid_t pid = fork();
+			if(pid < 0) {
+				perror("fork");
+				exit(EXIT_FAILURE);
+			}
+			if(pid == 0) {
+				int fd = open(logs[next].c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+				if(fd >= 0) {
+					dup2(fd, STDOUT_FILENO);
+					dup2(fd, STDERR_FILENO);
+					close(fd);
+				}
+				std::vector<std::string> all = args;
+				all.insert(all.end(), extra[next].begin(), extra[next].end());
+				std::vector<char *> childArgv;
+				childArgv.push_back((char *)binary.c_str());
+				for(uint32_t i = 0; i < all.size(); ++i)
+					childArgv.push_back((char *)all[i].c_str());
+				childArgv.push_back(NULL);
+				execv(binary.c_str(), &childArgv[0]);
+				perror("execv");
+				_exit(127);
+			}
+			children[pid] = next;
+			next++;
+			running++;
+		}
+		int status;
+		pid_t pid = waitpid(-1, &status, 0);
+		if(pid < 0) {
+			if(errno == EINTR)
+				continue;
+			perror("waitpid");
+			exit(EXIT_FAILURE);
+		}
+		//Not one of the runs (e.g. a child forked elsewhere in the process)
+		std::map<pid_t, uint32_t>::iterator it = children.find(pid);
+		if(it == children.end())
+			continue;
+		uint32_t index = it->second;
+		children.erase(it);
+		running--;
+		bool ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+		if(!ok)
+			failed++;
+		if(onExit)
+			onExit(index, ok);
+	}
+	return failed;
+}
+
+//Live sweep table of runScenarios (aggregation.h) while set
+SweepAggregator *sweepAggregator = 0;
+
+//Flows of a finished run's CSV into the sweep table, for runs taken from the cache
+void aggregateCsv(SweepAggregator *aggregator, std::string csvFile, std::string point) {
+	std::vector<std::map<std::string, std::string> > rows = readCsv(csvFile);
+	for(uint32_t i = 0; i < rows.size(); ++i) {
+		if(rows[i]["found"] != "1")
+			continue;
+		double values[AGG_METRICS];
+		for(uint32_t m = 0; m < AGG_METRICS; ++m)
+			values[m] = std::stod(rows[i][aggMetricNames[m]]);
+		aggregator->addFlow(point, rows[i]["label"], values);
+	}
+}
+
+/*
+	Runs this binary once per point, with `args`, then points[i] and
+	--outDir=dirs[i], at most `parallel` at a time.
+	With a cacheDir, points found in the results cache (resultsCache.h)
+	are copied instead of run, and every point that finishes is stored
+	right away, so an interrupted sweep resumes where it stopped.
+	With sweepAggregator set, every run also gets --aggregate and
+	--aggregateKey, adds its flows to the live table on its way out, and
+	the table is rewritten after each exit.
+	Returns the number of failed points.
+*/
+uint32_t runScenarios(std::vector<std::string> args, std::vector<std::vector<std::string> > points, std::vector<std::string> dirs, uint32_t parallel, std::string cacheDir) {
+	ResultsCache cache;
+	if(!cacheDir.empty())
+		cache.open(cacheDir, "/proc/self/exe");
+	SweepAggregator *aggregator = sweepAggregator;
+	if(aggregator && !aggregator->isOpen() && !aggregator->open())
+		aggregator = 0;
+	//The children report through --aggregate, the table option itself is not theirs (nor part of the cache key)
+	for(uint32_t i = 0; i < args.size(); ++i) {
+		if(args[i] == "--liveTable" || args[i].compare(0, 12, "--liveTable=") == 0)
+			args.erase(args.begin() + i--);
+	}
+
+	std::vector<std::vector<std::string> > extra, pendingScenarios;
+	std::vector<std::string> logs, pendingKeys, pendingDirs;
+	for(uint32_t i = 0; i < points.size(); ++i) {
+		std::vector<std::string> scenario = args;
+		scenario.insert(scenario.end(), points[i].begin(), points[i].end());
+		if(!cacheDir.empty()) {
+			std::string key = cache.key(scenario);
+			if(cache.fetch(key, dirs[i])) {
+				if(aggregator)
+					aggregateCsv(aggregator, dirs[i] + aggregator->getCsvName(), aggPointKey(points[i]));
+				continue;
+			}
+			pendingKeys.push_back(key);
+		}
+		SystemPath::MakeDirectories(dirs[i]);
+		pendingDirs.push_back(dirs[i]);
+		pendingScenarios.push_back(scenario);
+		logs.push_back(dirs[i] + "stdout.txt");
+		extra.push_back(points[i]);
+		extra.back().push_back("--outDir=" + dirs[i]);
+		if(aggregator) {
+			extra.back().push_back("--aggregate=" + aggregator->getName());
+			extra.back().push_back("--aggregateKey=" + aggPointKey(points[i]));
+		}
+	}
+
+	std::cout << "Running " << extra.size() << " of " << points.size() << " runs, " << parallel << " in parallel";
+	if(!cacheDir.empty())
+		std::cout << " (" << cache.getHits() << " from " << cacheDir << ")";
+	std::cout << std::endl;
+	uint32_t failed = runChildren("/proc/self/exe", args, extra, logs, parallel, [&](uint32_t i, bool ok) {
+		if(ok && !cacheDir.empty())
+			cache.store(pendingKeys[i], pendingDirs[i], pendingScenarios[i]);
+		if(aggregator)
+			aggregator->writeTable();
+	});
+	if(aggregator)
+		aggregator->writeTable();
+	if(failed)
+		std::cerr << failed << " runs failed, see their stdout.txt" << std::endl;
+	return failed;
+}
+
+/*
+	R replicas of the scenario given on the command line, run number
+	firstRun .. firstRun+R-1, each into outDir/run<k>/. The per-flow CSV of
+	every replica (see flowExport.h) is then reduced to a mean and 95%
+	confidence interval of throughput and loss rate per flow, written to
+	outDir/replicas.csv.
+*/
+int runReplicas(int argc, char **argv, uint32_t replicas, uint32_t parallel, uint64_t firstRun, std::string outDir, std::string csvName, std::string cacheDir = "") {
+	std::vector<std::string> args = stripOptions(argc, argv, {"replicas", "parallel", "run", "outDir", "cacheDir"});
+	std::vector<std::vector<std::string> > points;
+	std::vector<std::string> dirs;
+	for(uint32_t r = 0; r < replicas; ++r) {
+		uint64_t run = firstRun + r;
+		dirs.push_back(outDir + "run" + std::to_string(run) + "/");
+		points.push_back({"--replicas=1", "--run=" + std::to_string(run)});
+	}
+	uint32_t failed = runScenarios(args, points, dirs, parallel, cacheDir);
+
+	std::vector<std::string> labels;
+	std::map<std::string, std::vector<double> > throughput, loss;
+	for(uint32_t r = 0; r < replicas; ++r) {
+		std::vector<std::map<std::string, std::string> > rows = readCsv(dirs[r] + csvName);
+		for(uint32_t i = 0; i < rows.size(); ++i) {
+			std::string label = rows[i]["label"];
+			if(rows[i]["found"] != "1")
+				continue;
+			if(throughput.find(label) == throughput.end())
+				labels.push_back(label);
+			throughput[label].push_back(std::stod(rows[i]["throughput_kbps"]));
+			loss[label].push_back(std::stod(rows[i]["loss_rate"]));
+		}
+	}
+
+	std::ofstream out((outDir + "replicas.csv").c_str());
+	out << "label,replicas,throughput_kbps,throughput_ci95,loss_rate,loss_rate_ci95\n";
+	for(uint32_t i = 0; i < labels.size(); ++i) {
+		ConfidenceInterval tp = confidenceInterval(throughput[labels[i]]);
+		ConfidenceInterval lr = confidenceInterval(loss[labels[i]]);
+		out << labels[i] << "," << tp.n << "," << tp.mean << "," << tp.halfWidth << "," << lr.mean << "," << lr.halfWidth << "\n";
+		std::cout << labels[i] << ": throughput " << tp.mean << " +- " << tp.halfWidth << " Kbps, loss rate "
+			<< lr.mean << " +- " << lr.halfWidth << " (" << tp.n << " replicas)" << std::endl;
+	}
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+#endif
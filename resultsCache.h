@@ -0,0 +1,200 @@
+#ifndef RESULTS_CACHE_H
+#define RESULTS_CACHE_H
+
+#include <string>
+#include <vector>
+#include <list>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <iostream>
+#include <cstdio>
+#include <cstdint>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "ns3/core-module.h"
+
+using namespace ns3;
+
+//FNV-1a, used to fingerprint the binary and whole scenarios
+uint64_t fnv1a(const void *data, size_t len, uint64_t hash = 0xcbf29ce484222325ULL) {
+	const unsigned char *p = (const unsigned char *)data;
+	for(size_t i = 0; i < len; ++i) {
+		hash ^= p[i];
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+uint64_t hashFile(std::string fileName) {
+	std::ifstream in(fileName.c_str(), std::ios::binary);
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	char buf[1 << 16];
+	while(in) {
+		in.read(buf, sizeof(buf));
+		hash = fnv1a(buf, in.gcount(), hash);
+	}
+	return hash;
+}
+
+std::string toHex(uint64_t value) {
+	char buf[17];
+	snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)value);
+	return buf;
+}
+
+/*
+	Content-addressed cache of finished runs.
+	A scenario is the binary (hash of the executable, which fixes the
+	topology, the flows, their TCP variants and every attribute default)
+	plus its command line (every option that changes them, the seed and the
+	run number). Its key is the hash of the sorted option list, so the order
+	of the options does not matter. Options naming a file (--rateSchedule,
+	--leafParamsFile, --crossTrace, ...) also bring in the hash of that
+	file's contents, so editing the file is a new scenario rather than a
+	stale hit.
+	Each finished run is stored as cacheDir/<key>/ holding a copy of its
+	output files and a scenario.txt with the text that was hashed. The entry
+	is first written to a temporary directory and renamed into place, so an
+	entry is either complete or absent: a sweep killed halfway leaves only
+	finished points behind, and rerunning it computes just the rest.
+*/
+class ResultsCache
+{
+private:
+	std::string dir;
+	std::string binaryHash;
+	uint32_t hits, stored;
+
+	static bool isDirectory(std::string path);
+	static bool copyFiles(std::string from, std::string to, std::string skip);
+	static void removeDirectory(std::string path);
+
+public:
+	ResultsCache();
+	void open(std::string cacheDir, std::string binary);
+	std::string describe(std::vector<std::string> args);
+	std::string key(std::vector<std::string> args);
+	bool fetch(std::string key, std::string outDir);
+	bool store(std::string key, std::string outDir, std::vector<std::string> args);
+	uint32_t getHits();
+	uint32_t getStored();
+};
+
+ResultsCache::ResultsCache() {
+	this->hits = 0;
+	this->stored = 0;
+}
+
+void ResultsCache::open(std::string cacheDir, std::string binary) {
+	if(cacheDir.empty() || cacheDir[cacheDir.size()-1] != '/')
+		cacheDir += "/";
+	this->dir = cacheDir;
+	this->binaryHash = toHex(hashFile(binary));
+	SystemPath::MakeDirectories(this->dir);
+}
+
+//Text that identifies the scenario, one option per line
+std::string ResultsCache::describe(std::vector<std::string> args) {
+	std::sort(args.begin(), args.end());
+	std::string text = "binaryHash " + this->binaryHash + "\n";
+	for(uint32_t i = 0; i < args.size(); ++i) {
+		text += args[i] + "\n";
+		//Any value that is a regular file is taken as an input file of the run
+		size_t eq = args[i].find('=');
+		struct stat st;
+		if(eq != std::string::npos && stat(args[i].c_str() + eq + 1, &st) == 0 && S_ISREG(st.st_mode))
+			text += "fileHash " + args[i].substr(eq + 1) + " " + toHex(hashFile(args[i].substr(eq + 1))) + "\n";
+	}
+	return text;
+}
+
+std::string ResultsCache::key(std::vector<std::string> args) {
+	std::string text = this->describe(args);
+	return toHex(fnv1a(text.data(), text.size()));
+}
+
+bool ResultsCache::isDirectory(std::string path) {
+	struct stat st;
+	return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+/*
+	Regular files only, `skip` is left out. An explicit read/write loop:
+	out << in.rdbuf() sets failbit on an empty source, and runs do leave
+	empty outputs (e.g. a .cl file without losses).
+*/
+bool ResultsCache::copyFiles(std::string from, std::string to, std::string skip) {
+	std::list<std::string> files = SystemPath::ReadFiles(from);
+	char buf[1 << 16];
+	for(std::list<std::string>::iterator it = files.begin(); it != files.end(); ++it) {
+		struct stat st;
+		if(*it == skip || stat((from + *it).c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+			continue;
+		std::ifstream in((from + *it).c_str(), std::ios::binary);
+		std::ofstream out((to + *it).c_str(), std::ios::binary);
+		if(!in || !out)
+			return false;
+		while(in.read(buf, sizeof(buf)) || in.gcount() > 0)
+			out.write(buf, in.gcount());
+		if(in.bad() || !out.flush())
+			return false;
+	}
+	return true;
+}
+
+void ResultsCache::removeDirectory(std::string path) {
+	std::list<std::string> files = SystemPath::ReadFiles(path);
+	for(std::list<std::string>::iterator it = files.begin(); it != files.end(); ++it)
+		unlink((path + *it).c_str());
+	rmdir(path.c_str());
+}
+
+//Copies a cached run into outDir, false on a miss (the run is then redone and overwrites a partial copy)
+bool ResultsCache::fetch(std::string key, std::string outDir) {
+	std::string entry = this->dir + key + "/";
+	if(!isDirectory(entry))
+		return false;
+	SystemPath::MakeDirectories(outDir);
+	if(!copyFiles(entry, outDir, "scenario.txt")) {
+		std::cerr << "Cache entry " << key << " could not be copied to " << outDir << ", running the scenario" << std::endl;
+		return false;
+	}
+	this->hits++;
+	return true;
+}
+
+//Copies the outputs of a finished run into the cache
+bool ResultsCache::store(std::string key, std::string outDir, std::vector<std::string> args) {
+	std::string entry = this->dir + key;
+	std::string tmp = this->dir + "tmp-" + key + "-" + std::to_string(getpid()) + "/";
+	SystemPath::MakeDirectories(tmp);
+	std::ofstream scenario((tmp + "scenario.txt").c_str());
+	scenario << this->describe(args);
+	scenario.close();
+	if(!scenario || !copyFiles(outDir, tmp, "")) {
+		std::cerr << "Cannot store " << outDir << " in the cache (" << tmp << ")" << std::endl;
+		removeDirectory(tmp);
+		return false;
+	}
+	if(rename(tmp.c_str(), entry.c_str()) != 0) {
+		removeDirectory(tmp);
+		//Another sweep may have stored the same point meanwhile
+		if(isDirectory(entry + "/"))
+			return true;
+		std::cerr << "Cannot store " << outDir << " in the cache as " << entry << std::endl;
+		return false;
+	}
+	this->stored++;
+	return true;
+}
+
+uint32_t ResultsCache::getHits() {
+	return this->hits;
+}
+
+uint32_t ResultsCache::getStored() {
+	return this->stored;
+}
+
+#endif
@@ -0,0 +1,223 @@
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include <string>
+#include <atomic>
+#include <cstring>
+#include <cstdio>
+#include <cstdint>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*
+	Single-producer ring buffer of TCP state samples in a POSIX shared-memory
+	segment, written by the simulator and read by a separate viewer process
+	(see shmViewer.cc). No ns-3 dependency, so the viewer builds on its own.
+
+	The producer never waits for the reader: it always writes slot
+	head % capacity and then publishes head + 1. A slot carries the index it
+	was written for (seq = index + 1, stored last with release order); the
+	reader copies the slot and checks seq before and after, so a slot that
+	was overwritten while being read is detected and counted as lost rather
+	than returned torn.
+*/
+#define SHM_RING_MAGIC 0x54435052u		// "TCPR"
+#define SHM_RING_VERSION 1
+
+struct TcpStateRecord
+{
+	double time;				// simulation time (s)
+	uint32_t flow;
+	uint32_t cwnd;				// bytes
+	uint32_t ssthresh;			// bytes
+	uint32_t bytesInFlight;
+	double rtt;					// s
+	double rto;					// s
+	uint32_t congState;			// TcpSocketState::TcpCongState_t
+	uint32_t pad;
+};
+
+struct ShmRingSlot
+{
+	std::atomic<uint64_t> seq;
+	TcpStateRecord record;
+};
+
+struct ShmRingHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t capacity;
+	std::atomic<uint64_t> head;			// records ever written
+	std::atomic<uint32_t> finished;		// set by the producer at the end of the run
+};
+
+inline size_t shmRingSize(uint64_t capacity) {
+	return sizeof(ShmRingHeader) + capacity*sizeof(ShmRingSlot);
+}
+
+inline ShmRingSlot *shmRingSlots(ShmRingHeader *header) {
+	return (ShmRingSlot *)(header + 1);
+}
+
+class ShmRingWriter
+{
+private:
+	std::string name;
+	ShmRingHeader *header;
+	ShmRingSlot *slots;
+	uint64_t capacity;
+	uint64_t head;
+
+public:
+	ShmRingWriter();
+	~ShmRingWriter();
+	bool open(std::string name, uint64_t capacity);
+	void push(const TcpStateRecord &record);
+	void finish();
+};
+
+inline ShmRingWriter::ShmRingWriter() {
+	this->header = 0;
+	this->slots = 0;
+	this->capacity = 0;
+	this->head = 0;
+}
+
+inline ShmRingWriter::~ShmRingWriter() {
+	if(this->header) {
+		munmap(this->header, shmRingSize(this->capacity));
+		shm_unlink(this->name.c_str());
+	}
+}
+
+//name must start with '/', e.g. "/dumbbell"
+inline bool ShmRingWriter::open(std::string name, uint64_t capacity) {
+	int fd = shm_open(name.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+	if(fd < 0) {
+		perror("shm_open");
+		return false;
+	}
+	size_t size = shmRingSize(capacity);
+	if(ftruncate(fd, size) != 0) {
+		perror("ftruncate");
+		close(fd);
+		return false;
+	}
+	void *mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if(mem == MAP_FAILED) {
+		perror("mmap");
+		return false;
+	}
+	this->name = name;
+	this->capacity = capacity;
+	this->header = (ShmRingHeader *)mem;
+	this->slots = shmRingSlots(this->header);
+	this->header->capacity = capacity;
+	this->header->head.store(0, std::memory_order_relaxed);
+	this->header->finished.store(0, std::memory_order_relaxed);
+	this->header->version = SHM_RING_VERSION;
+	std::atomic_thread_fence(std::memory_order_release);
+	this->header->magic = SHM_RING_MAGIC;
+	return true;
+}
+
+inline void ShmRingWriter::push(const TcpStateRecord &record) {
+	ShmRingSlot &slot = this->slots[this->head % this->capacity];
+	slot.seq.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	slot.record = record;
+	slot.seq.store(this->head + 1, std::memory_order_release);
+	this->head++;
+	this->header->head.store(this->head, std::memory_order_release);
+}
+
+inline void ShmRingWriter::finish() {
+	if(this->header)
+		this->header->finished.store(1, std::memory_order_release);
+}
+
+class ShmRingReader
+{
+private:
+	ShmRingHeader *header;
+	ShmRingSlot *slots;
+	uint64_t capacity;
+	uint64_t tail;
+	uint64_t lost;
+
+public:
+	ShmRingReader();
+	bool open(std::string name);
+	bool next(TcpStateRecord &record);
+	bool finished();
+	uint64_t getLost();
+};
+
+inline ShmRingReader::ShmRingReader() {
+	this->header = 0;
+	this->slots = 0;
+	this->capacity = 0;
+	this->tail = 0;
+	this->lost = 0;
+}
+
+inline bool ShmRingReader::open(std::string name) {
+	int fd = shm_open(name.c_str(), O_RDONLY, 0);
+	if(fd < 0)
+		return false;
+	struct stat st;
+	if(fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ShmRingHeader)) {
+		close(fd);
+		return false;
+	}
+	void *mem = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if(mem == MAP_FAILED)
+		return false;
+	ShmRingHeader *header = (ShmRingHeader *)mem;
+	if(header->magic != SHM_RING_MAGIC || header->version != SHM_RING_VERSION
+		|| shmRingSize(header->capacity) > (size_t)st.st_size) {
+		munmap(mem, st.st_size);
+		return false;
+	}
+	this->header = header;
+	this->slots = shmRingSlots(header);
+	this->capacity = header->capacity;
+	this->tail = 0;
+	return true;
+}
+
+//false when no new record is available yet
+inline bool ShmRingReader::next(TcpStateRecord &record) {
+	uint64_t head = this->header->head.load(std::memory_order_acquire);
+	while(this->tail < head) {
+		if(head - this->tail > this->capacity) {
+			this->lost += head - this->tail - this->capacity;
+			this->tail = head - this->capacity;
+		}
+		const ShmRingSlot &slot = this->slots[this->tail % this->capacity];
+		uint64_t seq = slot.seq.load(std::memory_order_acquire);
+		record = slot.record;
+		std::atomic_thread_fence(std::memory_order_acquire);
+		uint64_t seqAfter = slot.seq.load(std::memory_order_relaxed);
+		this->tail++;
+		if(seq == this->tail && seqAfter == seq)
+			return true;
+		this->lost++;
+	}
+	return false;
+}
+
+inline bool ShmRingReader::finished() {
+	return this->header->finished.load(std::memory_order_acquire) != 0;
+}
+
+inline uint64_t ShmRingReader::getLost() {
+	return this->lost;
+}
+
+#endif
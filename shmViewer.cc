@@ -0,0 +1,56 @@
+/*
+	Live viewer for the TCP state samples of a running simulation
+	(TcpStateSampler, started with --shmName).
+	Usage: shmViewer <shmName> [interval]
+	Prints one line per flow at most every `interval` seconds of simulation
+	time (default 0.1), columns:
+		time  flow  cwnd  ssthresh  bytesInFlight  rtt(ms)  rto(ms)  congState
+	The output can be piped into a live plotter, e.g. feedgnuplot --stream.
+	Build: g++ -O2 -std=c++11 shmViewer.cc -o shmViewer -lrt
+*/
+#include <string>
+#include <vector>
+#include <iostream>
+#include <cstdlib>
+#include <unistd.h>
+#include "shmRing.h"
+
+int main(int argc, char **argv) {
+	if(argc < 2) {
+		std::cerr << "Usage: " << argv[0] << " <shmName> [interval]" << std::endl;
+		return EXIT_FAILURE;
+	}
+	std::string name = argv[1];
+	double interval = argc > 2 ? atof(argv[2]) : 0.1;
+
+	ShmRingReader reader;
+	while(!reader.open(name)) {
+		std::cerr << "Waiting for " << name << "..." << std::endl;
+		sleep(1);
+	}
+
+	std::vector<double> lastPrint;
+	TcpStateRecord record;
+	while(true) {
+		//read before draining: everything pushed before `finished` is then visible
+		bool done = reader.finished();
+		bool got = false;
+		while(reader.next(record)) {
+			got = true;
+			if(record.flow >= lastPrint.size())
+				lastPrint.resize(record.flow + 1, -1e9);
+			if(record.time - lastPrint[record.flow] < interval)
+				continue;
+			lastPrint[record.flow] = record.time;
+			std::cout << record.time << "\t" << record.flow << "\t" << record.cwnd << "\t" << record.ssthresh << "\t"
+				<< record.bytesInFlight << "\t" << record.rtt*1000 << "\t" << record.rto*1000 << "\t" << record.congState << "\n";
+		}
+		std::cout << std::flush;
+		if(done)
+			break;
+		if(!got)
+			usleep(10000);
+	}
+	std::cerr << "Run finished, " << reader.getLost() << " samples lost" << std::endl;
+	return 0;
+}
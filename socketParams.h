@@ -0,0 +1,200 @@
+#ifndef SOCKET_PARAMS_H
+#define SOCKET_PARAMS_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <sstream>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "replicas.h"
+#include "countingSink.h"
+
+using namespace ns3;
+
+/*
+	Per-flow TCP socket parameters.
+	ns-3 defaults to a 536-byte SegmentSize, so each 1.2-1.3KB application
+	write went out as two full segments and a runt: three headers and three
+	sets of events per write. Here the segment size defaults to the write
+	size, and the write size is rounded to a whole number of segments when
+	a segment size is given, so every write fills whole segments.
+	Send and receive buffers are rounded up to whole segments. Left at 0
+	they are memory-aware: autoBuffer bytes, enough for one flow to fill the
+	path (see alignSocketParam's caller), instead of the fixed 128KB, which
+	is below the bandwidth-delay product of the dumbbell.
+	initialCwnd is in segments, 0 keeps the ns-3 default.
+	The sender socket takes the parameters directly; the sink's listening
+	socket takes them just after the sink starts, and the sockets it accepts
+	inherit them (its receive buffer is the window the sender sees).
+*/
+#define MAX_SEGMENT_SIZE 1460		// 1500-byte MTU less the IP and TCP headers
+
+struct SocketParam
+{
+	uint32_t segmentSize;		// bytes, 0: the application write size
+	uint32_t sndBuf;			// bytes, 0: autoBuffer
+	uint32_t rcvBuf;			// bytes, 0: autoBuffer
+	uint32_t initialCwnd;		// segments, 0: ns-3 default
+	uint32_t writeSize;			// bytes per application write, set by alignSocketParam
+};
+
+uint32_t alignToSegments(uint32_t bytes, uint32_t segmentSize) {
+	uint32_t segments = (bytes + segmentSize - 1)/segmentSize;
+	return (segments ? segments : 1)*segmentSize;
+}
+
+void alignSocketParam(SocketParam &param, uint32_t writeSize, uint32_t autoBuffer) {
+	if(param.segmentSize == 0)
+		param.segmentSize = writeSize;
+	if(param.segmentSize > MAX_SEGMENT_SIZE) {
+		fprintf(stderr, "Segment size %u above the %u-byte MSS of the links\n", param.segmentSize, MAX_SEGMENT_SIZE);
+		exit(EXIT_FAILURE);
+	}
+	uint32_t segments = (uint32_t)std::lround((double)writeSize/param.segmentSize);
+	param.writeSize = (segments ? segments : 1)*param.segmentSize;
+	param.sndBuf = alignToSegments(param.sndBuf ? param.sndBuf : autoBuffer, param.segmentSize);
+	param.rcvBuf = alignToSegments(param.rcvBuf ? param.rcvBuf : autoBuffer, param.segmentSize);
+}
+
+//"a,b,c" -> one value per flow, a single value applies to every flow
+std::vector<uint32_t> parseFlowValues(std::string list, uint32_t numFlows, std::string name) {
+	std::vector<uint32_t> values;
+	std::stringstream ss(list);
+	std::string item;
+	while(std::getline(ss, item, ','))
+		values.push_back(item.empty() ? 0 : std::stoul(item));
+	if(values.size() == 1)
+		values.assign(numFlows, values[0]);
+	if(values.size() != numFlows) {
+		fprintf(stderr, "Need one %s per sender (%u) or a single one\n", name.c_str(), numFlows);
+		exit(EXIT_FAILURE);
+	}
+	return values;
+}
+
+std::vector<double> parseBdpMultiples(std::string list) {
+	std::vector<double> values;
+	std::stringstream ss(list);
+	std::string item;
+	while(std::getline(ss, item, ',')) {
+		if(item.empty() || std::stod(item) <= 0) {
+			fprintf(stderr, "Invalid buffer multiple in %s\n", list.c_str());
+			exit(EXIT_FAILURE);
+		}
+		values.push_back(std::stod(item));
+	}
+	return values;
+}
+
+std::vector<SocketParam> parseSocketParams(std::string segmentSizes, std::string sndBufs, std::string rcvBufs, std::string initialCwnds,
+		uint32_t numFlows, uint32_t writeSize, uint32_t autoBuffer) {
+	std::vector<uint32_t> segment = parseFlowValues(segmentSizes, numFlows, "segment size");
+	std::vector<uint32_t> snd = parseFlowValues(sndBufs, numFlows, "send buffer");
+	std::vector<uint32_t> rcv = parseFlowValues(rcvBufs, numFlows, "receive buffer");
+	std::vector<uint32_t> cwnd = parseFlowValues(initialCwnds, numFlows, "initial cwnd");
+	std::vector<SocketParam> params(numFlows);
+	for(uint32_t i = 0; i < numFlows; ++i) {
+		params[i].segmentSize = segment[i];
+		params[i].sndBuf = snd[i];
+		params[i].rcvBuf = rcv[i];
+		params[i].initialCwnd = cwnd[i];
+		alignSocketParam(params[i], writeSize, autoBuffer);
+	}
+	return params;
+}
+
+//Must be called before the socket connects or listens
+void applySocketParam(Ptr<Socket> socket, SocketParam param) {
+	socket->SetAttribute("SegmentSize", UintegerValue(param.segmentSize));
+	socket->SetAttribute("SndBufSize", UintegerValue(param.sndBuf));
+	socket->SetAttribute("RcvBufSize", UintegerValue(param.rcvBuf));
+	if(param.initialCwnd)
+		socket->SetAttribute("InitialCwnd", UintegerValue(param.initialCwnd));
+}
+
+//Scheduled just after the sink starts: its listening socket exists and has not accepted yet
+void applyListenerParam(Ptr<Application> sink, SocketParam param) {
+	Ptr<Socket> socket = sinkListeningSocket(sink);
+	if(socket)
+		applySocketParam(socket, param);
+}
+
+void scheduleListenerParam(Ptr<Application> sink, double startTime, SocketParam param) {
+	Simulator::Schedule(Seconds(startTime) + NanoSeconds(1), &applyListenerParam, sink, param);
+}
+
+/*
+	Throughput against socket memory.
+	Every buffer in `bdpMultiples` (times pathBdp bytes, rounded to whole
+	segments of segmentSize) runs as a child with --sndBuf and --rcvBuf set
+	to it on every flow, into outDir/sockbuf_<bytes>/, through runScenarios
+	(parallel, cached when cacheDir is set). Memory per socket pair is the
+	sender's send buffer plus the receiver's receive buffer.
+	outDir/socket_sweep.csv: per buffer, the total throughput, utilisation of
+	the bottleneck, mean delay and throughput per KB of socket memory; the
+	smallest buffer within 5% of the best throughput is reported as the
+	memory-aware choice.
+*/
+int runSocketSweep(int argc, char **argv, std::vector<double> bdpMultiples, uint32_t pathBdp, uint32_t segmentSize, double bottleneckKbps,
+		uint32_t parallel, std::string outDir, std::string csvName, std::string cacheDir) {
+	std::vector<std::string> args = stripOptions(argc, argv, {"socketSweep", "sndBuf", "rcvBuf", "replicas", "parallel", "outDir", "cacheDir"});
+	std::vector<std::vector<std::string> > points;
+	std::vector<std::string> dirs;
+	std::vector<uint32_t> buffers;
+	for(uint32_t i = 0; i < bdpMultiples.size(); ++i) {
+		uint32_t buffer = alignToSegments((uint32_t)(bdpMultiples[i]*pathBdp), segmentSize);
+		buffers.push_back(buffer);
+		points.push_back({"--replicas=1", "--sndBuf=" + std::to_string(buffer), "--rcvBuf=" + std::to_string(buffer)});
+		dirs.push_back(outDir + "sockbuf_" + std::to_string(buffer) + "/");
+	}
+	SystemPath::MakeDirectories(outDir);
+	uint32_t failed = runScenarios(args, points, dirs, parallel, cacheDir);
+
+	std::vector<double> throughput(buffers.size(), 0), delay(buffers.size(), 0);
+	double best = 0;
+	for(uint32_t i = 0; i < buffers.size(); ++i) {
+		std::vector<std::map<std::string, std::string> > rows = readCsv(dirs[i] + csvName);
+		double packets = 0;
+		for(uint32_t f = 0; f < rows.size(); ++f) {
+			if(rows[f]["found"] != "1")
+				continue;
+			double rx = std::stod(rows[f]["rxPackets"]);
+			throughput[i] += std::stod(rows[f]["throughput_kbps"]);
+			delay[i] += std::stod(rows[f]["delay_ms"])*rx;
+			packets += rx;
+		}
+		delay[i] = packets > 0 ? delay[i]/packets : 0;
+		if(throughput[i] > best)
+			best = throughput[i];
+	}
+
+	std::ofstream out((outDir + "socket_sweep.csv").c_str());
+	out << "buffer_bytes,buffer_bdp,socket_memory_bytes,throughput_kbps,utilization,delay_ms,kbps_per_kb\n";
+	std::cout << std::setw(12) << "buffer" << std::setw(8) << "BDP" << std::setw(14) << "Kbps" << std::setw(8) << "util" << std::setw(12) << "delay(ms)" << std::endl;
+	int32_t choice = -1;
+	for(uint32_t i = 0; i < buffers.size(); ++i) {
+		double memory = 2.0*buffers[i];
+		out << buffers[i] << "," << (double)buffers[i]/pathBdp << "," << (uint64_t)memory << "," << throughput[i] << ","
+			<< throughput[i]/bottleneckKbps << "," << delay[i] << "," << throughput[i]/(memory/1024) << "\n";
+		std::cout << std::setw(12) << buffers[i] << std::setw(8) << std::setprecision(3) << (double)buffers[i]/pathBdp
+			<< std::setw(14) << std::setprecision(6) << throughput[i] << std::setw(8) << std::setprecision(3) << throughput[i]/bottleneckKbps
+			<< std::setw(12) << delay[i] << std::endl;
+		if(best > 0 && throughput[i] >= 0.95*best && (choice < 0 || buffers[i] < buffers[choice]))
+			choice = i;
+	}
+	if(choice >= 0)
+		std::cout << "Smallest buffer within 5% of the best throughput: " << buffers[choice] << " bytes ("
+			<< (double)buffers[choice]/pathBdp << " BDP)" << std::endl;
+	std::cout << "Find the sweep in " << outDir << "socket_sweep.csv" << std::endl;
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+#endif
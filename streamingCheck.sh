@@ -0,0 +1,52 @@
+#!/bin/sh
+# Memory and disk check of the streaming mode: one hour of simulated time
+# through part23 --streaming.
+# - RSS must stay flat after the first snapshot window
+#   (FlowSnapshots::checkRss, --rssTolerance percent); the run fails with a
+#   non-zero exit status when it grows.
+# - Disk use must stay bounded: every rolled trace keeps at most ROLL_KEEP
+#   parts, and no file that is not rolled (reports, the windows CSV) grows
+#   past MAX_FILE_KB.
+# Usage:
+#     streamingCheck.sh [part23 binary] [part23 options...]
+#     ROLL_KEEP=3 streamingCheck.sh ./part23 --rssTolerance=5
+# Exits 0 when every check passed, 1 otherwise. The run's output is in
+# streaming_check/.
+
+binary=${1:-./part23}
+[ $# -gt 0 ] && shift
+rollKeep=${ROLL_KEEP:-2}
+maxFileKB=${MAX_FILE_KB:-1024}
+checkDir=streaming_check/
+outDir=${checkDir}out/
+rm -rf "$outDir"
+mkdir -p "$outDir"
+
+"$binary" --streaming=1 --duration=3600 --rollKeep="$rollKeep" --outDir="$outDir" "$@" > "${checkDir}stdout.txt" 2>&1
+status=$?
+grep "^RSS" "${checkDir}stdout.txt"
+echo "Disk use: $(du -sk "$outDir" | cut -f1) KB"
+
+if [ $status -ne 0 ]; then
+	echo "Streaming check FAILED: exit status $status, see ${checkDir}stdout.txt"
+	exit 1
+fi
+# A run that took fewer than two snapshots compares nothing
+if ! grep -q "^RSS after the first window.*: flat$" "${checkDir}stdout.txt"; then
+	echo "Streaming check FAILED: no RSS comparison in ${checkDir}stdout.txt"
+	exit 1
+fi
+# Rolled parts are <trace>.<index>
+overKept=$(find "$outDir" -type f | grep -E '\.[0-9]+$' | sed -E 's/\.[0-9]+$//' | sort | uniq -c | awk -v keep="$rollKeep" '$1 > keep')
+if [ -n "$overKept" ]; then
+	echo "Streaming check FAILED: traces with more than $rollKeep parts:"
+	echo "$overKept"
+	exit 1
+fi
+grown=$(find "$outDir" -type f -size +"$maxFileKB"k | grep -vE '\.[0-9]+$')
+if [ -n "$grown" ]; then
+	echo "Streaming check FAILED: files that are not rolled and exceed $maxFileKB KB:"
+	echo "$grown"
+	exit 1
+fi
+echo "Streaming check passed"
@@ -0,0 +1,174 @@
+#ifndef STREAMING_MODE_H
+#define STREAMING_MODE_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/flow-monitor-module.h"
+#include "flowTable.h"
+#include "memoryAccounting.h"
+
+using namespace ns3;
+
+/*
+	Long runs with flat memory.
+	FlowMonitor keeps every packet in flight in its tracking table until it
+	is received or CheckForLostPackets expires it, and its per-flow
+	histograms only grow. Every `interval` seconds FlowSnapshots expires the
+	lost packets, adds the window's per-flow stats to running totals, writes
+	one row per flow of the window (throughput, loss, delay and the RSS of
+	the process) to the windows CSV and resets FlowMonitor. getTotals()
+	gives the whole-run stats for FlowExporter; the histograms are not
+	carried over.
+	The RSS recorded at each snapshot backs checkRss: after the first window
+	(setup, slow start and socket buffers filling) the resident set of a
+	streaming run should stay flat, and a growth above `tolerance` percent
+	by the end of the run is reported as a failure.
+*/
+class FlowSnapshots
+{
+private:
+	Ptr<FlowMonitor> flowmon;
+	Ptr<Ipv4FlowClassifier> classifier;
+	const FlowTable *flows;
+	FlowMonitor::FlowStatsContainer totals;
+	std::ofstream windows;
+	double interval;
+	double stopTime;
+	double windowStart;
+	uint32_t window;
+	std::vector<uint64_t> rss;
+
+	void snapshot();
+
+public:
+	FlowSnapshots();
+	void install(Ptr<FlowMonitor> flowmon, Ptr<Ipv4FlowClassifier> classifier, const FlowTable *flows, std::string windowsFile,
+		double interval, double startTime, double stopTime);
+	FlowMonitor::FlowStatsContainer getTotals();
+	bool checkRss(double tolerance, std::ostream &os);
+};
+
+void mergeFlowStats(FlowMonitor::FlowStats &total, const FlowMonitor::FlowStats &window) {
+	if(window.txPackets && (total.txPackets == 0 || window.timeFirstTxPacket < total.timeFirstTxPacket))
+		total.timeFirstTxPacket = window.timeFirstTxPacket;
+	if(window.rxPackets && (total.rxPackets == 0 || window.timeFirstRxPacket < total.timeFirstRxPacket))
+		total.timeFirstRxPacket = window.timeFirstRxPacket;
+	if(window.timeLastTxPacket > total.timeLastTxPacket)
+		total.timeLastTxPacket = window.timeLastTxPacket;
+	if(window.timeLastRxPacket > total.timeLastRxPacket)
+		total.timeLastRxPacket = window.timeLastRxPacket;
+	total.delaySum += window.delaySum;
+	total.jitterSum += window.jitterSum;
+	total.lastDelay = window.lastDelay;
+	total.txBytes += window.txBytes;
+	total.rxBytes += window.rxBytes;
+	total.txPackets += window.txPackets;
+	total.rxPackets += window.rxPackets;
+	total.lostPackets += window.lostPackets;
+	total.timesForwarded += window.timesForwarded;
+	if(total.packetsDropped.size() < window.packetsDropped.size())
+		total.packetsDropped.resize(window.packetsDropped.size(), 0);
+	for(uint32_t i = 0; i < window.packetsDropped.size(); ++i)
+		total.packetsDropped[i] += window.packetsDropped[i];
+	if(total.bytesDropped.size() < window.bytesDropped.size())
+		total.bytesDropped.resize(window.bytesDropped.size(), 0);
+	for(uint32_t i = 0; i < window.bytesDropped.size(); ++i)
+		total.bytesDropped[i] += window.bytesDropped[i];
+}
+
+FlowSnapshots::FlowSnapshots() {
+	this->flows = 0;
+	this->interval = 0;
+	this->stopTime = 0;
+	this->windowStart = 0;
+	this->window = 0;
+}
+
+void FlowSnapshots::install(Ptr<FlowMonitor> flowmon, Ptr<Ipv4FlowClassifier> classifier, const FlowTable *flows, std::string windowsFile,
+		double interval, double startTime, double stopTime) {
+	if(interval <= 0) {
+		fprintf(stderr, "Invalid snapshot interval\n");
+		exit(EXIT_FAILURE);
+	}
+	this->flowmon = flowmon;
+	this->classifier = classifier;
+	this->flows = flows;
+	this->interval = interval;
+	this->stopTime = stopTime;
+	this->windowStart = startTime;
+	this->windows.open(windowsFile.c_str());
+	if(!this->windows) {
+		fprintf(stderr, "Cannot open %s\n", windowsFile.c_str());
+		exit(EXIT_FAILURE);
+	}
+	this->windows << "window,start_s,end_s,flow,label,txPackets,rxPackets,lostPackets,rxBytes,throughput_kbps,delay_ms,rss_kb\n";
+	if(startTime + interval < stopTime)
+		Simulator::Schedule(Seconds(startTime + interval), &FlowSnapshots::snapshot, this);
+}
+
+void FlowSnapshots::snapshot() {
+	double now = Simulator::Now().GetSeconds();
+	this->flowmon->CheckForLostPackets();
+	uint64_t resident = currentRss();
+	this->rss.push_back(resident);
+
+	const FlowMonitor::FlowStatsContainer &stats = this->flowmon->GetFlowStats();
+	for(FlowMonitor::FlowStatsContainerCI i = stats.begin(); i != stats.end(); ++i) {
+		const FlowMonitor::FlowStats &st = i->second;
+		if(this->totals.count(i->first))
+			mergeFlowStats(this->totals[i->first], st);
+		else
+			this->totals[i->first] = st;
+
+		Ipv4FlowClassifier::FiveTuple t = this->classifier->FindFlow(i->first);
+		uint32_t flow;
+		bool reverse;
+		if(!this->flows->lookup(t.sourceAddress.Get(), t.destinationAddress.Get(), flow, reverse) || reverse)
+			continue;
+		this->windows << this->window << "," << this->windowStart << "," << now << "," << flow << "," << this->flows->get(flow).label << ","
+			<< st.txPackets << "," << st.rxPackets << "," << st.lostPackets << "," << st.rxBytes << ","
+			<< ((st.rxBytes * 8.0) / 1024)/(now - this->windowStart) << ","
+			<< (st.rxPackets ? st.delaySum.GetSeconds()*1000/st.rxPackets : 0) << "," << resident/1024 << "\n";
+	}
+	this->windows.flush();
+	this->flowmon->ResetAllStats();
+
+	this->window++;
+	this->windowStart = now;
+	if(now + this->interval < this->stopTime)
+		Simulator::Schedule(Seconds(this->interval), &FlowSnapshots::snapshot, this);
+}
+
+//Whole-run stats: the snapshots so far plus what FlowMonitor holds since the last one
+FlowMonitor::FlowStatsContainer FlowSnapshots::getTotals() {
+	FlowMonitor::FlowStatsContainer all = this->totals;
+	const FlowMonitor::FlowStatsContainer &stats = this->flowmon->GetFlowStats();
+	for(FlowMonitor::FlowStatsContainerCI i = stats.begin(); i != stats.end(); ++i) {
+		if(all.count(i->first))
+			mergeFlowStats(all[i->first], i->second);
+		else
+			all[i->first] = i->second;
+	}
+	return all;
+}
+
+bool FlowSnapshots::checkRss(double tolerance, std::ostream &os) {
+	if(this->rss.size() < 2) {
+		os << "RSS check: fewer than two snapshots, nothing to compare" << std::endl;
+		return true;
+	}
+	double first = this->rss.front(), last = this->rss.back();
+	double growth = (last - first)/first*100;
+	bool ok = growth <= tolerance;
+	os << "RSS after the first window: " << (uint64_t)first/1024 << " KB, after the last (" << this->rss.size() << "): "
+		<< (uint64_t)last/1024 << " KB, growth " << growth << "% (tolerance " << tolerance << "%): " << (ok ? "flat" : "GROWING") << std::endl;
+	return ok;
+}
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef TCP_MODEL_H
+#define TCP_MODEL_H
+
+#include <string>
+#include <vector>
+#include <cmath>
+#include <cstddef>
+
+/*
+	Analytical TCP throughput against the simulated one.
+	Mathis et al. (CCR 1997), periodic loss, no timeouts:
+		B = MSS/RTT * sqrt(3/(2bp))
+	Padhye et al. (SIGCOMM 1998), with timeouts and the receive window:
+		B = min(Wmax/RTT, 1/(RTT*sqrt(2bp/3) + T0*min(1, 3*sqrt(3bp/8))*p*(1 + 32p^2))) segments/s
+	p is the loss (or ECN mark) rate per segment, b the segments acked per
+	ACK (ns-3's TcpSocket::DelAckCount, 2 by default: delayed ACKs), T0 the
+	retransmission timeout and Wmax the receive window in segments. With
+	p = 0 Mathis has no finite prediction (inf) and Padhye is the window
+	limit.
+	Both are reno models; for Hybla, Westwood and YeAH they are a sanity
+	check: a ratio far outside [1/tolerance, tolerance] points at a broken
+	run or a flow limited by something else (application rate, start-up)
+	rather than at the variant.
+	The batch is a structure of arrays and computeModels runs plain
+	branch-free loops over it, which the compiler vectorises (with
+	-fno-math-errno for sqrt), so the check over a whole sweep is one pass.
+	Rates out are in Kbps (1 Kb = 1024 bits) like the flow CSVs.
+*/
+struct ModelBatch
+{
+	//Inputs, one entry per flow
+	std::vector<double> lossRate;
+	std::vector<double> rtt;			// s
+	std::vector<double> mss;			// bytes
+	std::vector<double> wmax;			// segments
+	std::vector<double> rto;			// s
+	std::vector<double> simulated;		// Kbps
+	//Outputs
+	std::vector<double> mathis;			// Kbps
+	std::vector<double> padhye;			// Kbps
+
+	void add(double lossRate, double rtt, double mss, double wmax, double rto, double simulated);
+	size_t size() const;
+};
+
+inline void ModelBatch::add(double lossRate, double rtt, double mss, double wmax, double rto, double simulated) {
+	this->lossRate.push_back(lossRate);
+	this->rtt.push_back(rtt);
+	this->mss.push_back(mss);
+	this->wmax.push_back(wmax);
+	this->rto.push_back(rto);
+	this->simulated.push_back(simulated);
+}
+
+inline size_t ModelBatch::size() const {
+	return this->lossRate.size();
+}
+
+//The loop over raw arrays, so the compiler sees no aliasing and vectorises it
+inline void modelKernel(size_t n, const double *__restrict p, const double *__restrict rtt, const double *__restrict mss,
+		const double *__restrict wmax, const double *__restrict rto, double b, double *__restrict mathis, double *__restrict padhye) {
+	const double toKbps = 8.0/1024;
+	for(size_t i = 0; i < n; ++i) {
+		double bp = b*p[i];
+		//p = 0 gives inf, as the model has it
+		mathis[i] = mss[i]/rtt[i]*std::sqrt(1.5/bp)*toKbps;
+		//min(1, x) written branch-free: std::fmin is a libm call and a ternary against
+		//the constant 1 is kept as a branch, either stops the vectoriser
+		double fastRetransmit = 3*std::sqrt(0.375*bp);
+		double timeoutShare = 0.5*(fastRetransmit + 1 - std::fabs(fastRetransmit - 1));
+		double timeout = rto[i]*timeoutShare*p[i]*(1 + 32*p[i]*p[i]);
+		double segments = 1/(rtt[i]*std::sqrt(bp/1.5) + timeout);
+		double window = wmax[i]/rtt[i];
+		//A ternary between two computed values does vectorise, into a packed min
+		padhye[i] = (window < segments ? window : segments)*mss[i]*toKbps;
+	}
+}
+
+inline void computeModels(ModelBatch &batch, double ackedPerAck) {
+	batch.mathis.resize(batch.size());
+	batch.padhye.resize(batch.size());
+	modelKernel(batch.size(), batch.lossRate.data(), batch.rtt.data(), batch.mss.data(), batch.wmax.data(), batch.rto.data(),
+		ackedPerAck, batch.mathis.data(), batch.padhye.data());
+}
+
+//Simulated over model; 0 when the model has no finite prediction
+inline double modelRatio(double simulated, double model) {
+	return std::isfinite(model) && model > 0 ? simulated/model : 0;
+}
+
+inline bool modelDeparts(double simulated, double model, double tolerance) {
+	double ratio = modelRatio(simulated, model);
+	return ratio > 0 && (ratio > tolerance || ratio < 1/tolerance);
+}
+
+#endif
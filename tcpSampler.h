@@ -0,0 +1,104 @@
+#ifndef TCP_SAMPLER_H
+#define TCP_SAMPLER_H
+
+#include <string>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "shmRing.h"
+
+using namespace ns3;
+
+/*
+	Live TCP state of every sender socket.
+	The CongestionWindow, SlowStartThreshold, RTT, RTO, BytesInFlight and
+	CongState traces of a socket all update one TcpStateRecord; every change
+	pushes the record into the shared-memory ring, where a viewer process
+	(shmViewer) can follow the run while it is going.
+	Pushing is a struct copy and two atomic stores, and never waits on the
+	viewer.
+*/
+class TcpStateSampler
+{
+private:
+	ShmRingWriter ring;
+	std::vector<TcpStateRecord> state;
+
+	void publish(uint32_t flow);
+	static void cwndChange(TcpStateSampler *sampler, uint32_t flow, uint32_t oldValue, uint32_t newValue);
+	static void ssthreshChange(TcpStateSampler *sampler, uint32_t flow, uint32_t oldValue, uint32_t newValue);
+	static void bytesInFlightChange(TcpStateSampler *sampler, uint32_t flow, uint32_t oldValue, uint32_t newValue);
+	static void rttChange(TcpStateSampler *sampler, uint32_t flow, Time oldValue, Time newValue);
+	static void rtoChange(TcpStateSampler *sampler, uint32_t flow, Time oldValue, Time newValue);
+	static void congStateChange(TcpStateSampler *sampler, uint32_t flow, TcpSocketState::TcpCongState_t oldValue, TcpSocketState::TcpCongState_t newValue);
+
+public:
+	bool open(std::string shmName, uint64_t capacity);
+	uint32_t installSocket(Ptr<Socket> socket);
+	void finish();
+};
+
+bool TcpStateSampler::open(std::string shmName, uint64_t capacity) {
+	std::cout << "TCP state samples in shared memory " << shmName << std::endl;
+	return this->ring.open(shmName, capacity);
+}
+
+//Flows are numbered in installation order
+uint32_t TcpStateSampler::installSocket(Ptr<Socket> socket) {
+	uint32_t flow = this->state.size();
+	TcpStateRecord record;
+	memset(&record, 0, sizeof(record));
+	record.flow = flow;
+	this->state.push_back(record);
+
+	socket->TraceConnectWithoutContext("CongestionWindow", MakeBoundCallback(&TcpStateSampler::cwndChange, this, flow));
+	socket->TraceConnectWithoutContext("SlowStartThreshold", MakeBoundCallback(&TcpStateSampler::ssthreshChange, this, flow));
+	socket->TraceConnectWithoutContext("BytesInFlight", MakeBoundCallback(&TcpStateSampler::bytesInFlightChange, this, flow));
+	socket->TraceConnectWithoutContext("RTT", MakeBoundCallback(&TcpStateSampler::rttChange, this, flow));
+	socket->TraceConnectWithoutContext("RTO", MakeBoundCallback(&TcpStateSampler::rtoChange, this, flow));
+	socket->TraceConnectWithoutContext("CongState", MakeBoundCallback(&TcpStateSampler::congStateChange, this, flow));
+	return flow;
+}
+
+void TcpStateSampler::publish(uint32_t flow) {
+	TcpStateRecord &record = this->state[flow];
+	record.time = Simulator::Now().GetSeconds();
+	this->ring.push(record);
+}
+
+void TcpStateSampler::cwndChange(TcpStateSampler *sampler, uint32_t flow, uint32_t oldValue, uint32_t newValue) {
+	sampler->state[flow].cwnd = newValue;
+	sampler->publish(flow);
+}
+
+void TcpStateSampler::ssthreshChange(TcpStateSampler *sampler, uint32_t flow, uint32_t oldValue, uint32_t newValue) {
+	sampler->state[flow].ssthresh = newValue;
+	sampler->publish(flow);
+}
+
+void TcpStateSampler::bytesInFlightChange(TcpStateSampler *sampler, uint32_t flow, uint32_t oldValue, uint32_t newValue) {
+	sampler->state[flow].bytesInFlight = newValue;
+	sampler->publish(flow);
+}
+
+void TcpStateSampler::rttChange(TcpStateSampler *sampler, uint32_t flow, Time oldValue, Time newValue) {
+	sampler->state[flow].rtt = newValue.GetSeconds();
+	sampler->publish(flow);
+}
+
+void TcpStateSampler::rtoChange(TcpStateSampler *sampler, uint32_t flow, Time oldValue, Time newValue) {
+	sampler->state[flow].rto = newValue.GetSeconds();
+	sampler->publish(flow);
+}
+
+void TcpStateSampler::congStateChange(TcpStateSampler *sampler, uint32_t flow, TcpSocketState::TcpCongState_t oldValue, TcpSocketState::TcpCongState_t newValue) {
+	sampler->state[flow].congState = newValue;
+	sampler->publish(flow);
+}
+
+//Tells the viewer that no more samples will come
+void TcpStateSampler::finish() {
+	this->ring.finish();
+}
+
+#endif
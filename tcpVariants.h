@@ -0,0 +1,105 @@
+#ifndef TCP_VARIANTS_H
+#define TCP_VARIANTS_H
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+
+using namespace ns3;
+
+/*
+	TCP variants a flow can run, by the name used on the command line and
+	in the result files. "TcpWestwood" keeps meaning Westwood+, as it always
+	has in uniFlow. A new congestion control algorithm only needs a line here.
+*/
+struct TcpVariantEntry
+{
+	const char *name;
+	TypeId (*typeId)(void);
+};
+
+static const TcpVariantEntry tcpVariantTable[] = {
+	{"TcpNewReno", &TcpNewReno::GetTypeId},
+	{"TcpHybla", &TcpHybla::GetTypeId},
+	{"TcpWestwood", &TcpWestwoodPlus::GetTypeId},
+	{"TcpYeah", &TcpYeah::GetTypeId},
+	{"TcpCubic", &TcpCubic::GetTypeId},
+	{"TcpBic", &TcpBic::GetTypeId},
+	{"TcpHighSpeed", &TcpHighSpeed::GetTypeId},
+	{"TcpHtcp", &TcpHtcp::GetTypeId},
+	{"TcpScalable", &TcpScalable::GetTypeId},
+	{"TcpIllinois", &TcpIllinois::GetTypeId},
+	{"TcpVegas", &TcpVegas::GetTypeId},
+	{"TcpVeno", &TcpVeno::GetTypeId},
+	{"TcpLedbat", &TcpLedbat::GetTypeId},
+	{"TcpLp", &TcpLp::GetTypeId},
+	{"TcpBbr", &TcpBbr::GetTypeId},
+	{"TcpDctcp", &TcpDctcp::GetTypeId},
+};
+
+TypeId tcpVariantTypeId(std::string name) {
+	for(uint32_t i = 0; i < sizeof(tcpVariantTable)/sizeof(tcpVariantTable[0]); ++i) {
+		if(name == tcpVariantTable[i].name)
+			return tcpVariantTable[i].typeId();
+	}
+	fprintf(stderr, "Invalid TCP version %s\n", name.c_str());
+	exit(EXIT_FAILURE);
+}
+
+/*
+	TcpL4Protocol takes SocketType from the defaults once, when the stack is
+	installed, and creates every later socket of the node with it, so a
+	Config::SetDefault after the stack is in place changes nothing. The
+	variant of a flow is set on its node's TcpL4Protocol instead, before the
+	flow's sockets are created.
+*/
+void setTcpVariant(Ptr<Node> node, TypeId variant) {
+	node->GetObject<TcpL4Protocol>()->SetAttribute("SocketType", TypeIdValue(variant));
+}
+
+std::vector<std::string> tcpVariantNames() {
+	std::vector<std::string> names;
+	for(uint32_t i = 0; i < sizeof(tcpVariantTable)/sizeof(tcpVariantTable[0]); ++i)
+		names.push_back(tcpVariantTable[i].name);
+	return names;
+}
+
+/*
+	Stem of the trace file names of sender i: its variant in lower case
+	without "Tcp" ("TcpHybla" -> "hybla"), plus the sender number when
+	other senders run the same variant ("hybla1", "hybla2").
+*/
+std::string variantFileStem(const std::vector<std::string> &variants, uint32_t i) {
+	std::string stem = variants[i];
+	if(stem.compare(0, 3, "Tcp") == 0)
+		stem = stem.substr(3);
+	for(uint32_t c = 0; c < stem.size(); ++c)
+		stem[c] = tolower(stem[c]);
+	if(std::count(variants.begin(), variants.end(), variants[i]) > 1)
+		stem += std::to_string(i + 1);
+	return stem;
+}
+
+//"TcpHybla,TcpCubic" -> {"TcpHybla", "TcpCubic"}, "all" -> every supported variant
+std::vector<std::string> parseVariantList(std::string list) {
+	if(list == "all")
+		return tcpVariantNames();
+	std::vector<std::string> names;
+	std::stringstream ss(list);
+	std::string name;
+	while(std::getline(ss, name, ',')) {
+		if(name.empty())
+			continue;
+		tcpVariantTypeId(name);
+		names.push_back(name);
+	}
+	return names;
+}
+
+#endif
@@ -0,0 +1,353 @@
+#ifndef TRACE_FILES_H
+#define TRACE_FILES_H
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <fstream>
+#include <cstdio>
+#include <streambuf>
+#include <cstdlib>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "gorilla.h"
+#include "traceMux.h"
+
+using namespace ns3;
+
+/*
+	Stream buffer that takes the "time\tvalue\n" lines the trace callbacks
+	print and appends them to a compressed series (gorilla.h) instead of
+	writing text. Lines that are not two numbers are dropped.
+*/
+class GorillaStreambuf: public std::streambuf
+{
+private:
+	GorillaWriter writer;
+	std::string line;
+
+	void endLine();
+
+protected:
+	virtual int overflow(int c);
+	virtual std::streamsize xsputn(const char *s, std::streamsize n);
+
+public:
+	bool open(std::string fileName, double resolution, uint32_t mantissaBits, double deadband);
+	void close();
+};
+
+bool GorillaStreambuf::open(std::string fileName, double resolution, uint32_t mantissaBits, double deadband) {
+	return this->writer.open(fileName, resolution, mantissaBits, deadband);
+}
+
+void GorillaStreambuf::close() {
+	this->writer.close();
+}
+
+void GorillaStreambuf::endLine() {
+	const char *s = this->line.c_str();
+	char *end;
+	double time = strtod(s, &end);
+	if(end != s) {
+		const char *v = end;
+		double value = strtod(v, &end);
+		if(end != v)
+			this->writer.append(time, value);
+	}
+	this->line.clear();
+}
+
+int GorillaStreambuf::overflow(int c) {
+	if(c == '\n')
+		this->endLine();
+	else if(c != traits_type::eof())
+		this->line += (char)c;
+	return c == traits_type::eof() ? 0 : c;
+}
+
+std::streamsize GorillaStreambuf::xsputn(const char *s, std::streamsize n) {
+	for(std::streamsize i = 0; i < n; ++i)
+		this->overflow((unsigned char)s[i]);
+	return n;
+}
+
+//Stream buffer that hands whatever is printed to one stream of a TraceMuxWriter
+class TraceMuxStreambuf: public std::streambuf
+{
+private:
+	TraceMuxWriter *writer;
+	uint32_t stream;
+
+protected:
+	virtual int overflow(int c);
+	virtual std::streamsize xsputn(const char *s, std::streamsize n);
+
+public:
+	TraceMuxStreambuf(TraceMuxWriter *writer, uint32_t stream);
+};
+
+TraceMuxStreambuf::TraceMuxStreambuf(TraceMuxWriter *writer, uint32_t stream) {
+	this->writer = writer;
+	this->stream = stream;
+}
+
+int TraceMuxStreambuf::overflow(int c) {
+	if(c != traits_type::eof()) {
+		char ch = (char)c;
+		this->writer->write(this->stream, &ch, 1);
+	}
+	return c == traits_type::eof() ? 0 : c;
+}
+
+std::streamsize TraceMuxStreambuf::xsputn(const char *s, std::streamsize n) {
+	this->writer->write(this->stream, s, n);
+	return n;
+}
+
+/*
+	Stream buffer for long runs: writes <fileName>.0, <fileName>.1, ...
+	starting the next file at the first line boundary once `interval`
+	seconds of simulated time have passed, and deletes the file `keep`
+	files back (0 keeps them all), so a trace of an hour-long run takes
+	neither one huge file nor unbounded disk.
+*/
+class RollingStreambuf: public std::streambuf
+{
+private:
+	std::string fileName;
+	double interval;
+	uint32_t keep;
+	uint32_t index;
+	double nextRoll;
+	bool lineStart;
+	std::ofstream file;
+
+	std::string partName(uint32_t index);
+	void roll();
+
+protected:
+	virtual int overflow(int c);
+	virtual std::streamsize xsputn(const char *s, std::streamsize n);
+
+public:
+	bool open(std::string fileName, double interval, uint32_t keep);
+	void close();
+};
+
+std::string RollingStreambuf::partName(uint32_t index) {
+	return this->fileName + "." + std::to_string(index);
+}
+
+bool RollingStreambuf::open(std::string fileName, double interval, uint32_t keep) {
+	this->fileName = fileName;
+	this->interval = interval;
+	this->keep = keep;
+	this->index = 0;
+	this->nextRoll = Simulator::Now().GetSeconds() + interval;
+	this->lineStart = true;
+	this->file.open(this->partName(0).c_str());
+	if(!this->file)
+		perror(this->partName(0).c_str());
+	return (bool)this->file;
+}
+
+void RollingStreambuf::close() {
+	this->file.close();
+}
+
+void RollingStreambuf::roll() {
+	double now = Simulator::Now().GetSeconds();
+	if(!this->lineStart || now < this->nextRoll)
+		return;
+	while(this->nextRoll <= now)
+		this->nextRoll += this->interval;
+	this->file.close();
+	this->index++;
+	if(this->keep && this->index >= this->keep)
+		std::remove(this->partName(this->index - this->keep).c_str());
+	this->file.open(this->partName(this->index).c_str());
+}
+
+int RollingStreambuf::overflow(int c) {
+	if(c == traits_type::eof())
+		return 0;
+	this->roll();
+	this->file.put((char)c);
+	this->lineStart = c == '\n';
+	return c;
+}
+
+std::streamsize RollingStreambuf::xsputn(const char *s, std::streamsize n) {
+	if(n <= 0)
+		return 0;
+	this->roll();
+	this->file.write(s, n);
+	this->lineStart = s[n - 1] == '\n';
+	return n;
+}
+
+/*
+	The per-flow series traces (.cw, .tp, .gp) of a run.
+	Plain text by default, as AsciiTraceHelper writes them. With compression
+	on, each file is written as <fileName>.grl instead (see gorilla.h,
+	gorillaCat expands it back to text); the trace callbacks are the same
+	since they still print into an OutputStreamWrapper.
+	With multiplexing on (setMultiplexed), every stream, the text ones from
+	createText included, goes into one file instead (see traceMux.h,
+	traceSplit restores the per-flow files), so the number of open files
+	does not grow with the number of flows. With rolling on (setRolling),
+	each series trace is split into files of `interval` simulated seconds
+	(see RollingStreambuf); reports from createText are not split. None of
+	the three modes combine.
+	close() must be called once everything is written, to finish the
+	compressed or multiplexed files.
+*/
+class TraceFiles
+{
+private:
+	bool compress;
+	double resolution;
+	uint32_t mantissaBits;
+	double deadband;
+	std::vector<GorillaStreambuf *> buffers;
+	std::vector<TraceMuxStreambuf *> muxBuffers;
+	std::vector<RollingStreambuf *> rollingBuffers;
+	double rollInterval;
+	uint32_t rollKeep;
+	std::vector<std::ostream *> streams;
+	TraceMuxWriter *mux;
+
+	Ptr<OutputStreamWrapper> createMuxed(std::string fileName);
+
+public:
+	TraceFiles();
+	~TraceFiles();
+	void setCompression(bool compress, double resolution, uint32_t mantissaBits, double deadband);
+	void setMultiplexed(std::string muxFileName);
+	void setRolling(double interval, uint32_t keep);
+	Ptr<OutputStreamWrapper> create(std::string fileName);
+	Ptr<OutputStreamWrapper> createText(std::string fileName);
+	void close();
+};
+
+TraceFiles::TraceFiles() {
+	this->compress = false;
+	this->resolution = 1e-9;
+	this->mantissaBits = 52;
+	this->deadband = 0;
+	this->mux = 0;
+	this->rollInterval = 0;
+	this->rollKeep = 0;
+}
+
+TraceFiles::~TraceFiles() {
+	this->close();
+}
+
+void TraceFiles::setCompression(bool compress, double resolution, uint32_t mantissaBits, double deadband) {
+	this->compress = compress;
+	this->resolution = resolution;
+	this->mantissaBits = mantissaBits;
+	this->deadband = deadband;
+}
+
+void TraceFiles::setMultiplexed(std::string muxFileName) {
+	this->mux = new TraceMuxWriter();
+	if(!this->mux->open(muxFileName))
+		exit(EXIT_FAILURE);
+}
+
+//interval in simulated seconds, 0 to write each trace to one file
+void TraceFiles::setRolling(double interval, uint32_t keep) {
+	if(interval < 0) {
+		fprintf(stderr, "Invalid trace roll interval\n");
+		exit(EXIT_FAILURE);
+	}
+	this->rollInterval = interval;
+	this->rollKeep = keep;
+}
+
+//Streams are named by their base name, traceSplit writes them next to the mux file
+Ptr<OutputStreamWrapper> TraceFiles::createMuxed(std::string fileName) {
+	size_t slash = fileName.rfind('/');
+	std::string name = slash == std::string::npos ? fileName : fileName.substr(slash + 1);
+	TraceMuxStreambuf *buffer = new TraceMuxStreambuf(this->mux, this->mux->addStream(name));
+	std::ostream *stream = new std::ostream(buffer);
+	this->muxBuffers.push_back(buffer);
+	this->streams.push_back(stream);
+	return Create<OutputStreamWrapper>(stream);
+}
+
+Ptr<OutputStreamWrapper> TraceFiles::create(std::string fileName) {
+	if(this->mux && this->compress) {
+		fprintf(stderr, "Compressed traces cannot be multiplexed\n");
+		exit(EXIT_FAILURE);
+	}
+	if(this->rollInterval > 0 && (this->mux || this->compress)) {
+		fprintf(stderr, "Rolling traces cannot be compressed or multiplexed\n");
+		exit(EXIT_FAILURE);
+	}
+	if(this->rollInterval > 0) {
+		RollingStreambuf *buffer = new RollingStreambuf();
+		if(!buffer->open(fileName, this->rollInterval, this->rollKeep))
+			exit(EXIT_FAILURE);
+		std::ostream *stream = new std::ostream(buffer);
+		this->rollingBuffers.push_back(buffer);
+		this->streams.push_back(stream);
+		return Create<OutputStreamWrapper>(stream);
+	}
+	if(this->mux)
+		return this->createMuxed(fileName);
+	if(!this->compress) {
+		AsciiTraceHelper asciiTraceHelper;
+		return asciiTraceHelper.CreateFileStream(fileName);
+	}
+	GorillaStreambuf *buffer = new GorillaStreambuf();
+	if(!buffer->open(fileName + ".grl", this->resolution, this->mantissaBits, this->deadband))
+		exit(EXIT_FAILURE);
+	std::ostream *stream = new std::ostream(buffer);
+	this->buffers.push_back(buffer);
+	this->streams.push_back(stream);
+	//The wrapper does not own the stream, this object does
+	return Create<OutputStreamWrapper>(stream);
+}
+
+//Reports and other non-series text: never compressed, multiplexed when that is on
+Ptr<OutputStreamWrapper> TraceFiles::createText(std::string fileName) {
+	if(this->mux)
+		return this->createMuxed(fileName);
+	AsciiTraceHelper asciiTraceHelper;
+	return asciiTraceHelper.CreateFileStream(fileName);
+}
+
+void TraceFiles::close() {
+	for(uint32_t i = 0; i < this->streams.size(); ++i) {
+		this->streams[i]->flush();
+	}
+	for(uint32_t i = 0; i < this->buffers.size(); ++i) {
+		this->buffers[i]->close();
+		delete this->buffers[i];
+	}
+	if(this->mux) {
+		this->mux->close();
+		delete this->mux;
+		this->mux = 0;
+	}
+	for(uint32_t i = 0; i < this->streams.size(); ++i) {
+		delete this->streams[i];
+	}
+	for(uint32_t i = 0; i < this->muxBuffers.size(); ++i) {
+		delete this->muxBuffers[i];
+	}
+	for(uint32_t i = 0; i < this->rollingBuffers.size(); ++i) {
+		this->rollingBuffers[i]->close();
+		delete this->rollingBuffers[i];
+	}
+	this->buffers.clear();
+	this->muxBuffers.clear();
+	this->rollingBuffers.clear();
+	this->streams.clear();
+}
+
+#endif
@@ -0,0 +1,293 @@
+#ifndef TRACE_MUX_H
+#define TRACE_MUX_H
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+
+/*
+	Many trace streams multiplexed into one file, so a run keeps a single
+	descriptor open whatever the number of flows.
+	Each stream collects its text in a buffer of TRACE_MUX_CHUNK bytes; a
+	full buffer goes out as one tagged record:
+		type (u8), stream (u32), length (u32), payload
+	TRACE_MUX_NAME records register a stream (payload: its file name),
+	TRACE_MUX_DATA records carry its text. Concatenating the data records
+	of a stream in order gives the file it stands for.
+	close() appends the index: number of streams (u32), then per stream the
+	name length (u32), name, total bytes (u64), number of records (u32) and
+	for each record its payload offset (u64) and length (u32), followed by
+	the trailer (index offset u64, "TIDX"). A file cut short (crashed run)
+	has no index; the reader then rebuilds it by scanning the records.
+	No ns-3 dependency, so traceSplit builds on its own.
+*/
+#define TRACE_MUX_MAGIC "TMUX"
+#define TRACE_MUX_INDEX_MAGIC "TIDX"
+#define TRACE_MUX_VERSION 1
+#define TRACE_MUX_CHUNK 4096
+#define TRACE_MUX_NAME 1
+#define TRACE_MUX_DATA 2
+#define TRACE_MUX_HEADER_SIZE 8
+
+struct TraceMuxStream
+{
+	std::string name;
+	uint64_t bytes;
+	std::vector<uint64_t> offsets;		// of each record's payload
+	std::vector<uint32_t> lengths;
+};
+
+class TraceMuxWriter
+{
+private:
+	FILE *file;
+	std::vector<TraceMuxStream> streams;
+	std::vector<std::string> buffers;
+	uint64_t offset;
+
+	void writeRecord(uint8_t type, uint32_t stream, const char *data, uint32_t length);
+	void flush(uint32_t stream);
+
+public:
+	TraceMuxWriter();
+	~TraceMuxWriter();
+	bool open(std::string fileName);
+	uint32_t addStream(std::string name);
+	void write(uint32_t stream, const char *data, size_t length);
+	void close();
+};
+
+class TraceMuxReader
+{
+private:
+	FILE *file;
+	std::vector<TraceMuxStream> streams;
+	bool indexed;
+
+	bool readIndex();
+	void scan();
+
+public:
+	TraceMuxReader();
+	~TraceMuxReader();
+	bool open(std::string fileName);
+	uint32_t getNumStreams();
+	const TraceMuxStream &getStream(uint32_t stream);
+	bool isIndexed();
+	bool extract(uint32_t stream, FILE *out);
+};
+
+inline TraceMuxWriter::TraceMuxWriter() {
+	this->file = 0;
+	this->offset = 0;
+}
+
+inline TraceMuxWriter::~TraceMuxWriter() {
+	this->close();
+}
+
+inline bool TraceMuxWriter::open(std::string fileName) {
+	this->file = fopen(fileName.c_str(), "wb");
+	if(!this->file) {
+		perror(fileName.c_str());
+		return false;
+	}
+	//Records are small; let stdio gather them into large writes
+	setvbuf(this->file, 0, _IOFBF, 1 << 20);
+	uint32_t version = TRACE_MUX_VERSION;
+	fwrite(TRACE_MUX_MAGIC, 1, 4, this->file);
+	fwrite(&version, sizeof(version), 1, this->file);
+	this->offset = TRACE_MUX_HEADER_SIZE;
+	this->streams.clear();
+	this->buffers.clear();
+	return true;
+}
+
+inline void TraceMuxWriter::writeRecord(uint8_t type, uint32_t stream, const char *data, uint32_t length) {
+	fwrite(&type, sizeof(type), 1, this->file);
+	fwrite(&stream, sizeof(stream), 1, this->file);
+	fwrite(&length, sizeof(length), 1, this->file);
+	fwrite(data, 1, length, this->file);
+	this->offset += sizeof(type) + sizeof(stream) + sizeof(length);
+	if(type == TRACE_MUX_DATA) {
+		this->streams[stream].offsets.push_back(this->offset);
+		this->streams[stream].lengths.push_back(length);
+		this->streams[stream].bytes += length;
+	}
+	this->offset += length;
+}
+
+inline uint32_t TraceMuxWriter::addStream(std::string name) {
+	TraceMuxStream stream;
+	stream.name = name;
+	stream.bytes = 0;
+	this->streams.push_back(stream);
+	this->buffers.push_back(std::string());
+	this->buffers.back().reserve(TRACE_MUX_CHUNK);
+	uint32_t id = this->streams.size() - 1;
+	this->writeRecord(TRACE_MUX_NAME, id, name.c_str(), name.size());
+	return id;
+}
+
+inline void TraceMuxWriter::flush(uint32_t stream) {
+	std::string &buffer = this->buffers[stream];
+	if(buffer.empty())
+		return;
+	this->writeRecord(TRACE_MUX_DATA, stream, buffer.data(), buffer.size());
+	buffer.clear();
+}
+
+inline void TraceMuxWriter::write(uint32_t stream, const char *data, size_t length) {
+	if(!this->file || stream >= this->streams.size())
+		return;
+	this->buffers[stream].append(data, length);
+	if(this->buffers[stream].size() >= TRACE_MUX_CHUNK)
+		this->flush(stream);
+}
+
+inline void TraceMuxWriter::close() {
+	if(!this->file)
+		return;
+	for(uint32_t i = 0; i < this->streams.size(); ++i)
+		this->flush(i);
+
+	uint64_t indexOffset = this->offset;
+	uint32_t numStreams = this->streams.size();
+	fwrite(&numStreams, sizeof(numStreams), 1, this->file);
+	for(uint32_t i = 0; i < numStreams; ++i) {
+		const TraceMuxStream &s = this->streams[i];
+		uint32_t nameLength = s.name.size();
+		uint32_t numRecords = s.offsets.size();
+		fwrite(&nameLength, sizeof(nameLength), 1, this->file);
+		fwrite(s.name.c_str(), 1, nameLength, this->file);
+		fwrite(&s.bytes, sizeof(s.bytes), 1, this->file);
+		fwrite(&numRecords, sizeof(numRecords), 1, this->file);
+		for(uint32_t r = 0; r < numRecords; ++r) {
+			fwrite(&s.offsets[r], sizeof(uint64_t), 1, this->file);
+			fwrite(&s.lengths[r], sizeof(uint32_t), 1, this->file);
+		}
+	}
+	fwrite(&indexOffset, sizeof(indexOffset), 1, this->file);
+	fwrite(TRACE_MUX_INDEX_MAGIC, 1, 4, this->file);
+	fclose(this->file);
+	this->file = 0;
+}
+
+inline TraceMuxReader::TraceMuxReader() {
+	this->file = 0;
+	this->indexed = false;
+}
+
+inline TraceMuxReader::~TraceMuxReader() {
+	if(this->file)
+		fclose(this->file);
+}
+
+inline bool TraceMuxReader::open(std::string fileName) {
+	this->file = fopen(fileName.c_str(), "rb");
+	if(!this->file)
+		return false;
+	char magic[4];
+	uint32_t version;
+	if(fread(magic, 1, 4, this->file) != 4 || memcmp(magic, TRACE_MUX_MAGIC, 4) != 0
+		|| fread(&version, sizeof(version), 1, this->file) != 1 || version != TRACE_MUX_VERSION) {
+		fclose(this->file);
+		this->file = 0;
+		return false;
+	}
+	this->indexed = this->readIndex();
+	if(!this->indexed)
+		this->scan();
+	return true;
+}
+
+inline bool TraceMuxReader::readIndex() {
+	uint64_t indexOffset;
+	char magic[4];
+	if(fseek(this->file, -12, SEEK_END) != 0
+		|| fread(&indexOffset, sizeof(indexOffset), 1, this->file) != 1
+		|| fread(magic, 1, 4, this->file) != 4 || memcmp(magic, TRACE_MUX_INDEX_MAGIC, 4) != 0
+		|| fseek(this->file, indexOffset, SEEK_SET) != 0)
+		return false;
+	uint32_t numStreams;
+	if(fread(&numStreams, sizeof(numStreams), 1, this->file) != 1)
+		return false;
+	this->streams.resize(numStreams);
+	for(uint32_t i = 0; i < numStreams; ++i) {
+		TraceMuxStream &s = this->streams[i];
+		uint32_t nameLength, numRecords;
+		if(fread(&nameLength, sizeof(nameLength), 1, this->file) != 1)
+			return false;
+		s.name.resize(nameLength);
+		if((nameLength > 0 && fread(&s.name[0], 1, nameLength, this->file) != nameLength)
+			|| fread(&s.bytes, sizeof(s.bytes), 1, this->file) != 1
+			|| fread(&numRecords, sizeof(numRecords), 1, this->file) != 1)
+			return false;
+		s.offsets.resize(numRecords);
+		s.lengths.resize(numRecords);
+		for(uint32_t r = 0; r < numRecords; ++r) {
+			if(fread(&s.offsets[r], sizeof(uint64_t), 1, this->file) != 1
+				|| fread(&s.lengths[r], sizeof(uint32_t), 1, this->file) != 1)
+				return false;
+		}
+	}
+	return true;
+}
+
+//Index of a file without one, from the records themselves; a torn last record is dropped
+inline void TraceMuxReader::scan() {
+	this->streams.clear();
+	fseek(this->file, TRACE_MUX_HEADER_SIZE, SEEK_SET);
+	uint64_t offset = TRACE_MUX_HEADER_SIZE;
+	uint8_t type;
+	uint32_t stream, length;
+	while(fread(&type, sizeof(type), 1, this->file) == 1
+		&& fread(&stream, sizeof(stream), 1, this->file) == 1
+		&& fread(&length, sizeof(length), 1, this->file) == 1) {
+		offset += sizeof(type) + sizeof(stream) + sizeof(length);
+		std::string payload(length, '\0');
+		if(length > 0 && fread(&payload[0], 1, length, this->file) != length)
+			break;
+		if(type == TRACE_MUX_NAME && stream == this->streams.size()) {
+			TraceMuxStream s;
+			s.name = payload;
+			s.bytes = 0;
+			this->streams.push_back(s);
+		} else if(type == TRACE_MUX_DATA && stream < this->streams.size()) {
+			this->streams[stream].offsets.push_back(offset);
+			this->streams[stream].lengths.push_back(length);
+			this->streams[stream].bytes += length;
+		} else
+			break;
+		offset += length;
+	}
+}
+
+inline uint32_t TraceMuxReader::getNumStreams() {
+	return this->streams.size();
+}
+
+inline const TraceMuxStream &TraceMuxReader::getStream(uint32_t stream) {
+	return this->streams[stream];
+}
+
+inline bool TraceMuxReader::isIndexed() {
+	return this->indexed;
+}
+
+inline bool TraceMuxReader::extract(uint32_t stream, FILE *out) {
+	const TraceMuxStream &s = this->streams[stream];
+	std::vector<char> payload;
+	for(uint32_t r = 0; r < s.offsets.size(); ++r) {
+		payload.resize(s.lengths[r]);
+		if(fseek(this->file, s.offsets[r], SEEK_SET) != 0
+			|| fread(payload.data(), 1, payload.size(), this->file) != payload.size()
+			|| fwrite(payload.data(), 1, payload.size(), out) != payload.size())
+			return false;
+	}
+	return true;
+}
+
+#endif
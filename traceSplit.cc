@@ -0,0 +1,94 @@
+/*
+	Splits a multiplexed trace file (traceMux.h) back into the per-flow
+	files it stands for.
+	Usage:
+		traceSplit <run.tmux>                 every stream, next to run.tmux
+		traceSplit <run.tmux> <name>...       only the named streams
+		traceSplit -d <dir> <run.tmux> [name...]
+		                                      into <dir> instead
+		traceSplit -l <run.tmux>              list streams, sizes and records
+	The files come out byte for byte as the run would have written them
+	without multiplexing (compressed with gorillaCat if needed afterwards).
+	Build: g++ -O2 -std=c++11 traceSplit.cc -o traceSplit
+*/
+#include <string>
+#include <vector>
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "traceMux.h"
+
+void usage(const char *name) {
+	std::cerr << "Usage: " << name << " [-d <dir>] <run.tmux> [name...]" << std::endl;
+	std::cerr << "       " << name << " -l <run.tmux>" << std::endl;
+}
+
+int main(int argc, char **argv) {
+	bool list = false;
+	std::string dir;
+	int i = 1;
+	for(; i < argc && argv[i][0] == '-'; ++i) {
+		if(strcmp(argv[i], "-l") == 0)
+			list = true;
+		else if(strcmp(argv[i], "-d") == 0 && i + 1 < argc)
+			dir = argv[++i];
+		else {
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if(i >= argc) {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	std::string muxFile = argv[i++];
+	std::vector<std::string> names(argv + i, argv + argc);
+
+	TraceMuxReader reader;
+	if(!reader.open(muxFile)) {
+		std::cerr << "Not a multiplexed trace file: " << muxFile << std::endl;
+		return EXIT_FAILURE;
+	}
+	if(!reader.isIndexed())
+		std::cerr << muxFile << ": no index (run cut short), recovered from the records" << std::endl;
+
+	if(list) {
+		for(uint32_t s = 0; s < reader.getNumStreams(); ++s) {
+			const TraceMuxStream &stream = reader.getStream(s);
+			std::cout << stream.name << "\t" << stream.bytes << " bytes\t" << stream.offsets.size() << " records" << std::endl;
+		}
+		return 0;
+	}
+
+	if(dir.empty()) {
+		size_t slash = muxFile.rfind('/');
+		dir = slash == std::string::npos ? "." : muxFile.substr(0, slash);
+	}
+	uint32_t written = 0;
+	for(uint32_t s = 0; s < reader.getNumStreams(); ++s) {
+		const TraceMuxStream &stream = reader.getStream(s);
+		bool wanted = names.empty();
+		for(uint32_t n = 0; n < names.size(); ++n)
+			wanted = wanted || names[n] == stream.name;
+		if(!wanted)
+			continue;
+		std::string path = dir + "/" + stream.name;
+		FILE *out = fopen(path.c_str(), "wb");
+		if(!out) {
+			perror(path.c_str());
+			return EXIT_FAILURE;
+		}
+		bool ok = reader.extract(s, out);
+		fclose(out);
+		if(!ok) {
+			std::cerr << "Cannot read " << stream.name << " from " << muxFile << std::endl;
+			return EXIT_FAILURE;
+		}
+		written++;
+	}
+	if(written < names.size())
+		std::cerr << names.size() - written << " of the named streams are not in " << muxFile << std::endl;
+	std::cerr << written << " files written to " << dir << std::endl;
+	return 0;
+}
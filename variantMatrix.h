@@ -0,0 +1,141 @@
+#ifndef VARIANT_MATRIX_H
+#define VARIANT_MATRIX_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include "tcpVariants.h"
+#include "replicas.h"
+
+/*
+	Jain's fairness index of a set of throughputs,
+	(sum x)^2 / (n * sum x^2): 1 for an equal share, 1/n when one flow
+	takes everything.
+*/
+double jainIndex(const std::vector<double> &x) {
+	double sum = 0, sumSq = 0;
+	for(uint32_t i = 0; i < x.size(); ++i) {
+		sum += x[i];
+		sumSq += x[i]*x[i];
+	}
+	if(sumSq == 0)
+		return 0;
+	return sum*sum/(x.size()*sumSq);
+}
+
+/*
+	Pairwise fairness of TCP variants on the dumbbell.
+	Every ordered assignment of `variants` to the `numSenders` senders
+	(with repetition, so k^numSenders runs) is run as a separate child with
+	--variants=..., into outDir/<H1 variant>_<H2 variant>_.../, through
+	runScenarios (parallel, and cached when cacheDir is set). Since the
+	senders start staggered, running every order evens out the advantage of
+	the flow that starts first.
+	From the per-flow CSV of each run (csvName, see flowExport.h):
+	- outDir/matrix_runs.csv: per run, the throughput and share of each
+	  sender and the Jain index over all flows,
+	- outDir/fairness_matrix.csv: for each ordered pair (A, B), over every
+	  run and every two senders running A and B, the mean share A gets of
+	  the pair's throughput and the mean two-flow Jain index. A == B is the
+	  baseline of a variant against itself.
+*/
+int runVariantMatrix(int argc, char **argv, std::vector<std::string> variants, uint32_t numSenders, uint32_t parallel, std::string outDir, std::string csvName, std::string cacheDir) {
+	std::vector<std::string> args = stripOptions(argc, argv, {"matrix", "variants", "replicas", "parallel", "outDir", "cacheDir"});
+	uint32_t k = variants.size();
+	uint32_t numRuns = 1;
+	for(uint32_t i = 0; i < numSenders; ++i)
+		numRuns *= k;
+
+	std::vector<std::vector<uint32_t> > assignments;
+	std::vector<std::vector<std::string> > points;
+	std::vector<std::string> dirs;
+	for(uint32_t r = 0; r < numRuns; ++r) {
+		std::vector<uint32_t> assignment(numSenders);
+		std::string list, name;
+		for(uint32_t i = 0, rest = r; i < numSenders; ++i, rest /= k) {
+			assignment[numSenders-1-i] = rest % k;
+		}
+		for(uint32_t i = 0; i < numSenders; ++i) {
+			list += (i ? "," : "") + variants[assignment[i]];
+			name += (i ? "_" : "") + variants[assignment[i]];
+		}
+		assignments.push_back(assignment);
+		points.push_back({"--replicas=1", "--variants=" + list});
+		dirs.push_back(outDir + name + "/");
+	}
+	SystemPath::MakeDirectories(outDir);
+	uint32_t failed = runScenarios(args, points, dirs, parallel, cacheDir);
+
+	//share[a][b]: sum of the share A got against B, pairs[a][b]: number of such pairs
+	std::vector<std::vector<double> > share(k, std::vector<double>(k, 0)), jain(k, std::vector<double>(k, 0));
+	std::vector<std::vector<uint32_t> > pairs(k, std::vector<uint32_t>(k, 0));
+
+	std::ofstream runs((outDir + "matrix_runs.csv").c_str());
+	runs << "run";
+	for(uint32_t i = 0; i < numSenders; ++i)
+		runs << ",variant_h" << i+1;
+	for(uint32_t i = 0; i < numSenders; ++i)
+		runs << ",throughput_h" << i+1;
+	for(uint32_t i = 0; i < numSenders; ++i)
+		runs << ",share_h" << i+1;
+	runs << ",jain\n";
+
+	for(uint32_t r = 0; r < numRuns; ++r) {
+		std::vector<std::map<std::string, std::string> > rows = readCsv(dirs[r] + csvName);
+		if(rows.size() != numSenders)
+			continue;
+		std::vector<double> tp(numSenders, 0);
+		double total = 0;
+		for(uint32_t i = 0; i < numSenders; ++i) {
+			if(rows[i]["found"] == "1")
+				tp[i] = std::stod(rows[i]["throughput_kbps"]);
+			total += tp[i];
+		}
+
+		runs << r;
+		for(uint32_t i = 0; i < numSenders; ++i)
+			runs << "," << variants[assignments[r][i]];
+		for(uint32_t i = 0; i < numSenders; ++i)
+			runs << "," << tp[i];
+		for(uint32_t i = 0; i < numSenders; ++i)
+			runs << "," << (total > 0 ? tp[i]/total : 0);
+		runs << "," << jainIndex(tp) << "\n";
+
+		for(uint32_t i = 0; i < numSenders; ++i) {
+			for(uint32_t j = 0; j < numSenders; ++j) {
+				if(i == j || tp[i] + tp[j] <= 0)
+					continue;
+				uint32_t a = assignments[r][i], b = assignments[r][j];
+				share[a][b] += tp[i]/(tp[i] + tp[j]);
+				jain[a][b] += jainIndex({tp[i], tp[j]});
+				pairs[a][b]++;
+			}
+		}
+	}
+	runs.close();
+
+	std::ofstream matrix((outDir + "fairness_matrix.csv").c_str());
+	matrix << "variant,against,pairs,share,jain\n";
+	std::cout << "Throughput share of the row variant against the column variant" << std::endl;
+	std::cout << std::setw(14) << "";
+	for(uint32_t b = 0; b < k; ++b)
+		std::cout << std::setw(14) << variants[b];
+	std::cout << std::endl;
+	for(uint32_t a = 0; a < k; ++a) {
+		std::cout << std::setw(14) << variants[a];
+		for(uint32_t b = 0; b < k; ++b) {
+			double s = pairs[a][b] ? share[a][b]/pairs[a][b] : 0;
+			double j = pairs[a][b] ? jain[a][b]/pairs[a][b] : 0;
+			matrix << variants[a] << "," << variants[b] << "," << pairs[a][b] << "," << s << "," << j << "\n";
+			std::cout << std::setw(14) << std::setprecision(3) << s;
+		}
+		std::cout << std::endl;
+	}
+	std::cout << "Find the matrix in " << outDir << "fairness_matrix.csv" << std::endl;
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+#endif